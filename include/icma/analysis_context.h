@@ -0,0 +1,120 @@
+/** \file analysis_context.h
+ * \brief AnalysisContext holds the scratch buffers used by one analysis call.
+ * \date Oct 17, 2026
+ */
+
+#ifndef CMA_ANALYSIS_CONTEXT_H
+#define CMA_ANALYSIS_CONTEXT_H
+
+#include <memory>
+#include <string>
+
+#include <icma/util/VGenericArray.h>
+#include <icma/util/StringArray.h>
+#include <icma/sentence.h>
+#include <icma/token_sink.h>
+
+namespace cma
+{
+
+class Analyzer;
+class CMA_ME_Analyzer;
+struct POCBest;
+struct POCLattice;
+struct POSBeam;
+class VTrieDAG;
+class WorkStealingPool;
+
+/**
+ * \brief AnalysisContext holds the scratch buffers used by one analysis call.
+ *
+ * The analyzer keeps no per-call state in itself, everything is written into
+ * the context passed to it. So one Analyzer (and one Knowledge) can be shared
+ * by many threads as long as each thread uses its own context. The buffers
+ * are kept between calls, so once they are large enough no more memory is
+ * allocated.
+ *
+ * Typically, the usage is like below:
+ *
+ * // in each worker thread
+ * AnalysisContext context;
+ * const char* result = analyzer->runWithString("...", context);
+ * ...
+ * analyzer->runWithSentence(sentence, context);
+ *
+ * If no context is given, \e AnalysisContext::local() is used, which is
+ * owned by the calling thread.
+ */
+class AnalysisContext
+{
+public:
+    friend class Analyzer;
+    friend class CMA_ME_Analyzer;
+
+    AnalysisContext();
+
+    ~AnalysisContext();
+
+    /**
+     * Get the context owned by the calling thread.
+     * \return the thread-local context
+     */
+    static AnalysisContext& local();
+
+    /**
+     * Release the memory kept by the scratch buffers.
+     */
+    void release();
+
+private:
+    /** not copyable */
+    AnalysisContext( const AnalysisContext& );
+    AnalysisContext& operator=( const AnalysisContext& );
+
+private:
+    /** the characters of the input string */
+    StringArray chars_;
+
+    /** the raw memory of the character types, one for each character */
+    PGenericArray< unsigned char > typeBuf_;
+
+    /** the segment sequence, pairs of ( begin, end ) character indices */
+    PGenericArray< size_t > segment_;
+
+    /** the begin index in segment_ of each candidate */
+    PGenericArray< size_t > offsets_;
+
+    /** string buffer stores result for \e runWithString */
+    std::string strBuf_;
+
+    /** the sentence used by \e runWithString and \e runWithStream */
+    Sentence sentence_;
+
+    /** the tokens for \e runWithCallback */
+    PGenericArray< Token > tokens_;
+
+    /** the buffers of the one-best segmentation, created on the first use */
+    std::unique_ptr< POCBest > pocBest_;
+
+    /** the buffers of the N-best segmentation, created on the first use */
+    std::unique_ptr< POCLattice > pocLattice_;
+
+    /** the buffers of the beam search of the POS tags, created on the first use */
+    std::unique_ptr< POSBeam > posBeam_;
+
+    /** the dictionary words of the characters, created on the first use */
+    std::unique_ptr< VTrieDAG > trieDAG_;
+
+    /** the number of threads to analyze the current input */
+    unsigned int threadNum_;
+
+    /** whether the context is used by a worker of \e Analyzer::runWithSentences(), which analyzes each input in its own thread */
+    bool batch_;
+
+    /** the threads to analyze a long input, created on the first use */
+    std::unique_ptr< WorkStealingPool > pool_;
+};
+
+} // namespace cma
+
+#endif // CMA_ANALYSIS_CONTEXT_H
@@ -8,9 +8,14 @@
 #ifndef CMA_ANALYZER_H
 #define CMA_ANALYZER_H
 
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <string>
 
+#include <icma/analysis_context.h>
+#include <icma/token_sink.h>
+
 namespace cma
 {
 
@@ -47,6 +52,10 @@ class Sentence;
  * const char* result = analyzer->runWithString("...");
  * ...
  *
+ * // get the tokens of a paragraph one by one
+ * analyzer->runWithCallback(str, len, sink);
+ * ...
+ *
  * // analyze a file
  * analyzer->runWithStream("...", "...");
  *
@@ -74,6 +83,48 @@ public:
      */
     virtual int runWithSentence(Sentence& sentence) = 0;
 
+    /**
+     * Execute the morphological analysis based on a sentence, using the scratch buffers in \e context.
+     * \param sentence the instance containing the raw sentence string and also to save the analysis result
+     * \param context the scratch buffers, which should not be used by other threads at the same time
+     * \return 0 for fail, 1 for success
+     * \attention this method could be invoked by many threads on the same instance, see \e AnalysisContext.
+     */
+    virtual int runWithSentence(Sentence& sentence, AnalysisContext& context) = 0;
+
+    /**
+     * Tag the POS of the words already segmented, without running the segmentation.
+     * \param tokens the words of a sentence in order, the empty ones are ignored
+     * \param sentence set as the concatenation of \e tokens, and to save the result
+     * \return 0 for fail, 1 for success
+     * \pre each token should be made of whole characters in the encoding of the knowledge.
+     * \post on successful return, the result has a single list of the words in \e tokens,
+     * whose POS could be got by \e sentence.getPOS(0, i), etc.
+     */
+    virtual int tagTokens(const std::vector<std::string>& tokens, Sentence& sentence) = 0;
+
+    /**
+     * Tag the POS of the words already segmented, using the scratch buffers in \e context.
+     * \param tokens the words of a sentence in order, the empty ones are ignored
+     * \param sentence set as the concatenation of \e tokens, and to save the result
+     * \param context the scratch buffers, which should not be used by other threads at the same time
+     * \return 0 for fail, 1 for success
+     * \attention this method could be invoked by many threads on the same instance, see \e AnalysisContext.
+     */
+    virtual int tagTokens(const std::vector<std::string>& tokens, Sentence& sentence,
+            AnalysisContext& context) = 0;
+
+    /**
+     * Execute the morphological analysis on a batch of sentences with several threads.
+     * The sentences are balanced among the threads by their string length, and each thread uses its own \e AnalysisContext.
+     * The threads are kept by the analyzer for the next calls, and each sentence is analyzed in one thread,
+     * that is, a long input is not split as in \e runWithSentence() (see \e OPTION_TYPE_SPLIT_LENGTH).
+     * \param sentences the sentences to analyze, each one gets the same result as \e runWithSentence()
+     * \param threadNum the number of threads, 0 for the number of cores
+     * \return 0 if any sentence fails, 1 for success
+     */
+    virtual int runWithSentences(std::vector<Sentence>& sentences, unsigned int threadNum = 0);
+
     /**
      * Execute the morphological analysis based on a paragraph string.
      * \param inStr paragraph string
@@ -81,6 +132,62 @@ public:
      */
     virtual const char* runWithString(const char* inStr) = 0;
 
+    /**
+     * Execute the morphological analysis based on a paragraph string, using the scratch buffers in \e context.
+     * \param inStr paragraph string
+     * \param context the scratch buffers, which should not be used by other threads at the same time
+     * \return 0 for fail, otherwise a non-zero string pointer for the one-best result, which is kept in \e context until its next use
+     */
+    virtual const char* runWithString(const char* inStr, AnalysisContext& context) = 0;
+
+    /**
+     * Execute the morphological analysis based on a part of a larger buffer, like a line of a mapped file, without copying it.
+     * \param inStr paragraph string, which needs not be terminated by '\\0'
+     * \param len the byte count of the paragraph, the analysis also stops at '\\0' if it comes first
+     * \return 0 for fail, otherwise a non-zero string pointer for the one-best result
+     */
+    virtual const char* runWithString(const char* inStr, size_t len) = 0;
+
+    /**
+     * Execute the morphological analysis based on a part of a larger buffer, using the scratch buffers in \e context.
+     * \param inStr paragraph string, which needs not be terminated by '\\0'
+     * \param len the byte count of the paragraph, the analysis also stops at '\\0' if it comes first
+     * \param context the scratch buffers, which should not be used by other threads at the same time
+     * \return 0 for fail, otherwise a non-zero string pointer for the one-best result, which is kept in \e context until its next use
+     */
+    virtual const char* runWithString(const char* inStr, size_t len, AnalysisContext& context) = 0;
+
+    /**
+     * Execute the morphological analysis based on the first \e len bytes of a paragraph string, and pass each token of the one-best result to \e sink in order.
+     * No \e Sentence is created, the tokens refer to \e inStr by their byte spans.
+     * \param inStr paragraph string, which needs not be terminated by '\\0'
+     * \param len the byte count of the paragraph
+     * \param sink the \e TokenSink, or any functor callable as \e sink(inStr, token)
+     * \param context the scratch buffers, which should not be used by other threads at the same time
+     * \return 0 for fail, 1 for success
+     */
+    template< typename SinkT >
+    int runWithCallback(const char* inStr, size_t len, SinkT& sink, AnalysisContext& context)
+    {
+        if( analyzeTokens( inStr, len, context ) == 0 )
+            return 0;
+
+        const PGenericArray< Token >& tokens = context.tokens_;
+        size_t size = tokens.size();
+        for( size_t i = 0; i < size; ++i )
+            sink( inStr, tokens[ i ] );
+        return 1;
+    }
+
+    /**
+     * Same as above, using the scratch buffers of the calling thread.
+     */
+    template< typename SinkT >
+    int runWithCallback(const char* inStr, size_t len, SinkT& sink)
+    {
+        return runWithCallback( inStr, len, sink, AnalysisContext::local() );
+    }
+
     /**
      * Execute the morphological analysis based on a file.
      * \param inFileName input file name
@@ -160,6 +267,11 @@ public:
 	OPTION_ANALYSIS_TYPE, ///< set the segmentation approach see the definition of specific Analyzer
 	OPTION_TYPE_POS_TAGGING, ///< the value zero for not to tag part-of-speech tags in the result of \e runWithSentence(), \e runWithString() and \e runWithStream(), which value is 1 defaultly.
 	OPTION_TYPE_NBEST, ///< a positive value to set the number of candidate results of \e runWithSentence(), which value is 1 defaultly.
+	OPTION_TYPE_THREAD_NUM, ///< the number of threads to analyze the lines in \e runWithStream(), or the pieces of a long input in \e runWithSentence() and \e runWithString() (see \e OPTION_TYPE_SPLIT_LENGTH), zero for the number of cores, which value is 1 defaultly.
+	OPTION_TYPE_SPAN_ONLY, ///< a non-zero value to keep only the byte spans of the morphemes in the result of \e runWithSentence() when POS tagging is disabled, the morpheme strings are created on the first \e Sentence::getLexicon(), which value is 0 defaultly.
+	OPTION_TYPE_CACHE_SIZE, ///< the most results kept in the cache of \e runWithSentence(), \e runWithString() and \e runWithStream(), so that a repeated input is not analyzed again, zero to disable the cache, which value is 0 defaultly.
+	OPTION_TYPE_SPLIT_LENGTH, ///< a positive value to split the input of at least this many bytes at the sentence separators in \e runWithSentence() and \e runWithString(), and analyze the pieces with \e OPTION_TYPE_THREAD_NUM threads, the result is the same as analyzing the whole input in one thread, only the one-best analysis with the statistical model is split, zero to disable the splitting, which value is 0 defaultly.
+	OPTION_TYPE_POS_BEAM_WIDTH, ///< a value greater than 1 to tag part-of-speech tags by a beam search keeping this many tag sequences after each word, instead of choosing the best tag of each word in turn, which may give better tag sequences at the cost of tagging speed, the words of a long input are then tagged in one thread, which value is 1 defaultly.
 	OPTION_TYPE_NUM ///< the count of option types
     };
 
@@ -174,6 +286,8 @@ public:
      * \param nOption the option type
      * \param nValue the option value
      * \attention when \e nOption is \e OPTION_TYPE_NBEST, the invalid \e nValue less than 1 will take no effect.
+     * \attention when \e nOption is \e OPTION_TYPE_THREAD_NUM, the invalid \e nValue less than 0 will take no effect.
+     * \attention when \e nOption is \e OPTION_TYPE_CACHE_SIZE, the cached results are removed, it should not be set during the analysis.
      */
     virtual void setOption(OptionType nOption, double nValue);
 
@@ -186,6 +300,19 @@ public:
      */
     double getOption(OptionType nOption) const;
 
+    /**
+     * Get the counters of the result cache, see \e OPTION_TYPE_CACHE_SIZE.
+     * \param hits set as the number of inputs found in the cache
+     * \param misses set as the number of inputs not found in the cache
+     * \param size set as the number of results in the cache
+     */
+    virtual void getCacheStatistics(size_t& hits, size_t& misses, size_t& size) const;
+
+    /**
+     * Remove all the results in the cache, the counters are kept.
+     */
+    virtual void clearCache() {}
+
     /**
      * Set the delimiter between word and POS tag in the output result of \e runWithString() and \e runWithStream(), which delimiter is "/" defaultly so that the result would be "word/pos  word/pos  ...".
      * \param delimiter the delimiter between word and POS tag in the output result
@@ -222,6 +349,14 @@ public:
      */
     const char* getSentenceDelimiter() const;
 
+protected:
+    /**
+     * Analyze the first \e len bytes of \e inStr and keep the tokens of the
+     * one-best result in \e context, used by \e runWithCallback().
+     * \return 0 for fail, 1 for success
+     */
+    virtual int analyzeTokens(const char* inStr, size_t len, AnalysisContext& context) = 0;
+
 protected:
     /** option values */
     std::vector<double> options_;
@@ -234,6 +369,13 @@ protected:
 
     /** the delimiter between sentences */
     const char* sentenceDelimiter_;
+
+private:
+    /** the threads of \e runWithSentences(), kept for the next batches */
+    std::unique_ptr<WorkStealingPool> batchPool_;
+
+    /** the lock of \e batchPool_, so only one batch runs at a time */
+    std::mutex batchLock_;
 };
 
 } // namespace cma
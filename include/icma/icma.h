@@ -9,6 +9,7 @@
 #define ICMA_H_
 
 #include <icma/analyzer.h>
+#include <icma/analysis_context.h>
 #include <icma/cma_factory.h>
 #include <icma/knowledge.h>
 #include <icma/sentence.h>
@@ -10,6 +10,7 @@
 
 #include <vector>
 #include <string>
+#include <atomic>
 
 namespace cma
 {
@@ -114,6 +115,42 @@ public:
      */
     static Knowledge::EncodeType decodeEncodeType(const char* encType);
 
+    /**
+     * Storage type of the weights of the statistical models.
+     */
+    enum ModelWeightType
+    {
+    MODEL_WEIGHT_DOUBLE, ///< the exact weights in 8 bytes
+    MODEL_WEIGHT_FLOAT16, ///< the weights in 2 bytes, with the relative error below 2^-11
+    MODEL_WEIGHT_INT8, ///< the weights in 1 byte, scaled by the largest weight of each block of 64
+    MODEL_WEIGHT_TYPE_NUM ///< the count of weight types
+    };
+
+    /**
+     * Set the storage type of the weights of the statistical models, which
+     * takes effect on the models loaded afterwards, so it should be called
+     * before \e loadStatModel(), \e loadPOSModel() and \e loadModel().
+     * The quantized weights save 4 (float16) or 8 (int8) times memory with
+     * a little loss of accuracy.
+     * If this function is not called, the default value returned by \e getModelWeightType() is \e MODEL_WEIGHT_DOUBLE.
+     * \param type the weight type
+     */
+    void setModelWeightType(ModelWeightType type);
+
+    /**
+     * Get the storage type of the weights of the statistical models.
+     * \return the weight type
+     */
+    ModelWeightType getModelWeightType() const;
+
+    /**
+     * Get the weight type by the weight type string
+     *
+     * \param weightType weight type string, "double", "float16" or "int8"
+     * \return assicated Knowledge::ModelWeightType, or \e MODEL_WEIGHT_TYPE_NUM if unknown
+     */
+    static Knowledge::ModelWeightType decodeModelWeightType(const char* weightType);
+
     /**
      * Auto load POS model, Stat Model and System Dictionaries.
      * Encoding must be set here.
@@ -162,9 +199,30 @@ public:
      */
     virtual void enableWords( const std::vector< std::string >& words ) = 0;
 
+    /**
+     * Get the version of the knowledge, which is increased whenever the
+     * dictionary or the models are changed, like by \e loadUserDict() and
+     * \e disableWords(). The cached analysis results of an older version are
+     * no longer valid.
+     * \return the version number
+     */
+    unsigned long getVersion() const;
+
+protected:
+    /**
+     * Increase the version after the dictionary or the models are changed.
+     */
+    void increaseVersion();
+
 private:
     /** character encode type */
     EncodeType encodeType_;
+
+    /** storage type of the model weights */
+    ModelWeightType modelWeightType_;
+
+    /** the version of the knowledge */
+    std::atomic< unsigned long > version_;
 };
 
 }
@@ -20,6 +20,7 @@ namespace cma
 
 class CMA_ME_Analyzer;
 class StringArray;
+class POSTable;
 
 /**
  * \brief a pair of lexicon string and its part-of-speech tag.
@@ -120,6 +121,14 @@ public:
      */
     void setString(const char* pString);
 
+    /**
+     * Set the raw sentence string from the first \e len bytes of \e pString.
+     * \param pString value of the raw string, which needs not be terminated by '\\0'
+     * \param len the byte count of the raw string
+     * \attention the previous analysis results will be removed.
+     */
+    void setString(const char* pString, size_t len);
+
     /**
      * Get the raw sentence string.
      * \return value of the raw string
@@ -144,9 +153,29 @@ public:
      * \param nPos candidate result index
      * \param nIdx morpheme index
      * \return morpheme string
+     * \attention if only the byte spans are kept in the result, the strings
+     * of all the morphemes are created on the first call, under a lock so
+     * that a const sentence can still be read by several threads.
      */
     const char* getLexicon(int nPos, int nIdx) const;
 
+    /**
+     * Get the byte offset of morpheme \e nIdx in candidate result \e nPos
+     * in the raw string.
+     * \param nPos candidate result index
+     * \param nIdx morpheme index
+     * \return byte offset in the raw string
+     */
+    size_t getByteOffset(int nPos, int nIdx) const;
+
+    /**
+     * Get the byte count of morpheme \e nIdx in candidate result \e nPos.
+     * \param nPos candidate result index
+     * \param nIdx morpheme index
+     * \return byte count of the morpheme
+     */
+    size_t getByteLength(int nPos, int nIdx) const;
+
     /**
 	 * Get the string of morpheme \e nIdx in candidate result \e nPos.
 	 * \param nPos candidate result index
@@ -168,6 +197,8 @@ public:
      * \param nPos candidate result index
      * \param nIdx morpheme index
      * \return POS string, null pointer for non POS available
+     * \attention the string is kept in the POS table, it is valid until a new
+     * POS is added into the table.
      */
     const char* getStrPOS(int nPos, int nIdx) const;
 
@@ -222,15 +253,37 @@ public:
      */
     bool isIncrementedWordOffset();
 
+private:
+    /**
+     * Create the strings of all the morphemes from their byte spans.
+     */
+    void createLexicons() const;
+
 private:
     /** the raw sentence string */
     std::string raw_;
 
-    /** segmentation and score vector */
-    StringArray segment_;
+    /**
+     * segmentation and score vector, it may be empty until \e getLexicon()
+     * if only the byte spans are kept
+     */
+    mutable StringArray segment_;
+
+    /** pairs of ( begin, end ) byte offsets of the morphemes in the raw string */
+    PGenericArray< size_t > spans_;
+
+    /**
+     * whether to keep only the byte spans in the next analysis, it is also
+     * set if the result is taken from the cache, whose morpheme strings are
+     * created by \e getLexicon()
+     */
+    bool spanOnly_;
+
+    /** POS index code list */
+    PGenericArray< int > pos_;
 
-    /** POS list */
-    PGenericArray< const char* > pos_;
+    /** the table to get the POS strings from the codes */
+    const POSTable* posTable_;
 
     /** the candidates list of morphological analysis result */
     VGenericArray< MorphemeList > candidates_;
@@ -0,0 +1,75 @@
+/** \file token_sink.h
+ * \brief TokenSink receives the tokens of the one-best result one by one.
+ * \date Oct 17, 2026
+ */
+
+#ifndef CMA_TOKEN_SINK_H
+#define CMA_TOKEN_SINK_H
+
+#include <cstddef>
+
+namespace cma
+{
+
+/**
+ * \brief A token in the one-best result, which refers to the input by its
+ * byte span.
+ */
+struct Token
+{
+    /** the byte offset of the token in the input */
+    size_t begin_;
+
+    /** the byte count of the token */
+    size_t length_;
+
+    /** the index code of part-of-speech tag, -1 if POS tagging is disabled */
+    int posCode_;
+
+    /** the word offset of the token in the input */
+    size_t wordOffset_;
+
+    /** whether the token is an indexed word, false if POS tagging is disabled */
+    bool isIndexed_;
+};
+
+/**
+ * \brief TokenSink receives the tokens of the one-best result one by one.
+ *
+ * Typically, the usage is like below:
+ *
+ * class MySink : public TokenSink
+ * {
+ *     virtual void onToken( const char* input, const Token& token )
+ *     {
+ *         index( input + token.begin_, token.length_ );
+ *     }
+ * };
+ *
+ * MySink sink;
+ * analyzer->runWithCallback(str, len, sink);
+ *
+ * Any functor with the same call signature can be passed to
+ * \e Analyzer::runWithCallback() as well, so that the call is inlined.
+ */
+class TokenSink
+{
+public:
+    virtual ~TokenSink() {}
+
+    /**
+     * Receive a token.
+     * \param input the input string
+     * \param token the token
+     */
+    virtual void onToken( const char* input, const Token& token ) = 0;
+
+    void operator()( const char* input, const Token& token )
+    {
+        onToken( input, token );
+    }
+};
+
+} // namespace cma
+
+#endif // CMA_TOKEN_SINK_H
@@ -0,0 +1,179 @@
+/**
+ * \file dict_bench.cpp
+ * \brief Compare the lookup throughput and the memory of the dictionary
+ * tries, the VTrie and the DATrie built from it.
+ * \date Oct 17, 2026
+ */
+
+#include "icma/icma.h"
+#include "icma/me/CMA_ME_Knowledge.h"
+#include "icma/type/cma_ctype.h"
+#include "icma/util/DATrie.h"
+
+#include <sys/time.h>
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace cma;
+
+/**
+ * Print the usage.
+ */
+void printUsage()
+{
+    cerr << "Usages:\t" << "./dict_bench MODEL_PATH TEXT_FILE [rounds]" << endl;
+    cerr << "\tMODEL_PATH is the directory of the models whose last directory is the encoding, "
+            "like db/icwb/utf8/." << endl;
+    cerr << "\tTEXT_FILE is searched for the dictionary words starting at each character, "
+            "rounds times (default 10)." << endl;
+}
+
+/**
+ * Get the current time in seconds.
+ */
+double now()
+{
+    timeval tv;
+    gettimeofday( &tv, 0 );
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/**
+ * The result of searching the text in a trie.
+ */
+struct Result
+{
+    size_t lookups;
+    size_t words;
+    long checksum;
+    double seconds;
+};
+
+/**
+ * Search the dictionary words starting at each character of the lines, as
+ * VTrieDAG does.
+ */
+Result search( const DictTrie* trie, const vector< vector< string > >& lines, int rounds )
+{
+    Result result = { 0, 0, 0, 0 };
+    double start = now();
+    for( int r = 0; r < rounds; ++r )
+    {
+        for( size_t l = 0; l < lines.size(); ++l )
+        {
+            const vector< string >& chars = lines[ l ];
+            for( size_t begin = 0; begin < chars.size(); ++begin )
+            {
+                VTrieNode node;
+                for( size_t i = begin; i < chars.size() && node.moreLong; ++i )
+                {
+                    ++result.lookups;
+                    const string& ch = chars[ i ];
+                    if( trie->walk( ch.data(), ch.size(), &node ) < ch.size() )
+                        break;
+                    if( node.data != 0 )
+                    {
+                        ++result.words;
+                        result.checksum += node.data * (long)( i - begin + 1 );
+                    }
+                }
+            }
+        }
+    }
+    result.seconds = now() - start;
+    return result;
+}
+
+/**
+ * Print the result of a trie.
+ */
+void printResult( const char* name, const Result& result, size_t memory )
+{
+    printf( "%-7s memory %10zu bytes  %8.1f M lookups/s  %10zu words  checksum %ld\n",
+            name, memory, result.lookups / result.seconds / 1e6, result.words, result.checksum );
+}
+
+/**
+ * Main function.
+ */
+int main(int argc, char* argv[])
+{
+    if( argc < 3 )
+    {
+        printUsage();
+        exit(1);
+    }
+
+    int rounds = argc > 3 ? atoi( argv[ 3 ] ) : 10;
+    if( rounds <= 0 )
+        rounds = 1;
+
+    CMA_Factory* factory = CMA_Factory::instance();
+    Knowledge* loaded = factory->createKnowledge();
+    CMA_ME_Knowledge* knowledge = dynamic_cast< CMA_ME_Knowledge* >( loaded );
+    if( !knowledge || !loaded->loadModel( argv[ 1 ] ) )
+    {
+        cerr << "Fail to load the models in " << argv[ 1 ] << endl;
+        exit(1);
+    }
+    CMA_CType* ctype = CMA_CType::instance( knowledge->getEncodeType() );
+
+    ifstream in( argv[ 2 ] );
+    if( !in )
+    {
+        cerr << "Fail to open the text: " << argv[ 2 ] << endl;
+        exit(1);
+    }
+    vector< vector< string > > lines;
+    string line;
+    size_t charCount = 0;
+    while( getline( in, line ) )
+    {
+        vector< string > chars;
+        const char* p = line.c_str();
+        size_t len = line.size();
+        size_t i = 0;
+        while( i < len )
+        {
+            unsigned int bytes = ctype->getByteCount( p + i, len - i );
+            if( bytes == 0 )
+                break;
+            chars.push_back( line.substr( i, bytes ) );
+            i += bytes;
+        }
+        charCount += chars.size();
+        lines.push_back( chars );
+    }
+
+    VTrieDict vtrie( knowledge->getTrie() );
+    double start = now();
+    DATrie datrie;
+    datrie.build( *knowledge->getTrie(), ctype );
+    printf( "DATrie built in %.1f ms, %zu characters in the alphabet\n",
+            ( now() - start ) * 1e3, datrie.alphabetSize() );
+    printf( "Search %zu characters in %zu lines, %d rounds\n", charCount, lines.size(), rounds );
+
+    // warm up the caches
+    search( &vtrie, lines, 1 );
+    search( &datrie, lines, 1 );
+    Result vtrieResult = search( &vtrie, lines, rounds );
+    Result datrieResult = search( &datrie, lines, rounds );
+    printResult( "VTrie", vtrieResult, vtrie.memorySize() );
+    printResult( "DATrie", datrieResult, datrie.memorySize() );
+
+    bool same = vtrieResult.words == datrieResult.words &&
+            vtrieResult.checksum == datrieResult.checksum;
+    if( !same )
+        cerr << "The words found in the tries are different" << endl;
+    printf( "Speedup %.2fx, memory %.2fx\n", vtrieResult.seconds / datrieResult.seconds,
+            (double)datrie.memorySize() / vtrie.memorySize() );
+
+    delete knowledge;
+    return same ? 0 : 1;
+}
@@ -0,0 +1,66 @@
+/**
+ * \file model_flat.cpp
+ * \brief Convert a MaxEnt model, such as poc.model or pos.model, into the
+ * flat model file which is mapped when it is loaded.
+ * \date Oct 17, 2026
+ */
+
+#include "maxentmodel.hpp"
+
+#include <iostream>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+/**
+ * Print the usage.
+ */
+void printUsage()
+{
+    cerr << "Usages:\t" << "./model_flat INPUT_MODEL OUTPUT_MODEL" << endl;
+    cerr << "\tINPUT_MODEL is a model file in any format, OUTPUT_MODEL could "
+            "replace it, as the format is detected when it is loaded." << endl;
+}
+
+/**
+ * Main function.
+ */
+int main(int argc, char* argv[])
+{
+    if( argc < 3 )
+    {
+        printUsage();
+        exit(1);
+    }
+
+    const string inFile = argv[ 1 ];
+    const string outFile = argv[ 2 ];
+
+    try
+    {
+        maxent::MaxentModel model;
+        model.load( inFile );
+        model.save_flat( outFile );
+
+        // check the saved file by loading it back
+        maxent::MaxentModel flat;
+        flat.load( outFile );
+        if( flat.pred_size() != model.pred_size() ||
+                flat.outcome_size() != model.outcome_size() )
+        {
+            cerr << "The saved model differs from " << inFile << endl;
+            exit(1);
+        }
+        cout << "Saved " << flat.pred_size() << " predicates and "
+                << flat.outcome_size() << " outcomes into " << outFile << endl;
+    }
+    catch( const exception& e )
+    {
+        cerr << "Fail to convert " << inFile << ": " << e.what() << endl;
+        exit(1);
+    }
+
+    return 0;
+}
@@ -0,0 +1,298 @@
+/**
+ * \file model_quant.cpp
+ * \brief Report the accuracy of the quantized model weights on a held-out
+ * corpus, compared with the exact weights.
+ * \date Oct 17, 2026
+ */
+
+#include "icma/icma.h"
+#include "maxentmodel.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace cma;
+
+/**
+ * A word of the corpus or the analysis, [begin, end) bytes of the raw
+ * sentence with its POS.
+ */
+struct Word
+{
+    size_t begin;
+    size_t end;
+    string pos;
+
+    bool operator<( const Word& other ) const
+    {
+        if( begin != other.begin )
+            return begin < other.begin;
+        if( end != other.end )
+            return end < other.end;
+        return pos < other.pos;
+    }
+
+    bool operator==( const Word& other ) const
+    {
+        return begin == other.begin && end == other.end && pos == other.pos;
+    }
+};
+
+/**
+ * The counts of one weight type over the corpus.
+ */
+struct Score
+{
+    size_t goldWords;
+    size_t goldPOSWords;
+    size_t wordsFound;
+    size_t wordsCorrect;
+    size_t posCorrect;
+    size_t sentencesSame;
+
+    Score() : goldWords( 0 ), goldPOSWords( 0 ), wordsFound( 0 ), wordsCorrect( 0 ),
+            posCorrect( 0 ), sentencesSame( 0 ) {}
+};
+
+/**
+ * Print the usage.
+ */
+void printUsage()
+{
+    cerr << "Usages:\t" << "./model_quant MODEL_PATH HELDOUT_CORPUS [float16 | int8] [posDelimiter]" << endl;
+    cerr << "\tMODEL_PATH is the directory of the models whose last directory is the encoding, "
+            "like db/icwb/utf8/." << endl;
+    cerr << "\tHELDOUT_CORPUS has a sentence per line, and the words separated by spaces "
+            "with their POS, like word1/pos1 word2/pos2 ..., or without POS." << endl;
+    cerr << "\tThe quantized weight types are both evaluated if not specified." << endl;
+}
+
+/**
+ * Split a line of the corpus into the raw sentence and the gold words.
+ */
+void parseLine( const string& line, const string& posDelimiter, string& raw, vector< Word >& words )
+{
+    raw.clear();
+    words.clear();
+    size_t i = 0;
+    while( i < line.size() )
+    {
+        if( line[ i ] == ' ' || line[ i ] == '\t' || line[ i ] == '\r' )
+        {
+            ++i;
+            continue;
+        }
+        size_t end = line.find_first_of( " \t\r", i );
+        if( end == string::npos )
+            end = line.size();
+        string token = line.substr( i, end - i );
+        i = end;
+
+        Word word;
+        size_t delimiter = token.rfind( posDelimiter );
+        if( delimiter != string::npos && delimiter > 0 )
+        {
+            word.pos = token.substr( delimiter + posDelimiter.size() );
+            token.erase( delimiter );
+        }
+        word.begin = raw.size();
+        raw += token;
+        word.end = raw.size();
+        words.push_back( word );
+    }
+}
+
+/**
+ * Load the models with the weight type, and analyze the corpus.
+ * \param results the analysis of each sentence, compared with it if not empty,
+ * or set as the analysis
+ * \return false if the model could not be loaded
+ */
+bool evaluate( const char* modelPath, const char* corpus, const string& posDelimiter,
+        Knowledge::ModelWeightType type, vector< vector< Word > >& results, Score& score )
+{
+    CMA_Factory* factory = CMA_Factory::instance();
+    Knowledge* knowledge = factory->createKnowledge();
+    knowledge->setModelWeightType( type );
+    if( !knowledge->loadModel( modelPath ) )
+    {
+        delete knowledge;
+        return false;
+    }
+    Analyzer* analyzer = factory->createAnalyzer();
+    analyzer->setKnowledge( knowledge );
+    analyzer->setOption( Analyzer::OPTION_ANALYSIS_TYPE, 1 );
+    analyzer->setOption( Analyzer::OPTION_TYPE_POS_TAGGING, knowledge->isSupportPOS() ? 1 : 0 );
+
+    bool compare = !results.empty();
+    ifstream in( corpus );
+    string line, raw;
+    vector< Word > gold;
+    Sentence sentence;
+    size_t lineNo = 0;
+    while( getline( in, line ) )
+    {
+        parseLine( line, posDelimiter, raw, gold );
+        if( raw.empty() )
+            continue;
+
+        sentence.setString( raw.c_str() );
+        analyzer->runWithSentence( sentence );
+        vector< Word > found;
+        int best = sentence.getOneBestIndex();
+        for( int j = 0; best >= 0 && j < sentence.getCount( best ); ++j )
+        {
+            Word word;
+            word.begin = sentence.getByteOffset( best, j );
+            word.end = word.begin + sentence.getByteLength( best, j );
+            const char* pos = sentence.getStrPOS( best, j );
+            word.pos = pos ? pos : "";
+            found.push_back( word );
+        }
+
+        set< pair< size_t, size_t > > foundSpans;
+        set< Word > foundWords( found.begin(), found.end() );
+        for( size_t j = 0; j < found.size(); ++j )
+            foundSpans.insert( make_pair( found[ j ].begin, found[ j ].end ) );
+        score.goldWords += gold.size();
+        score.wordsFound += found.size();
+        for( size_t j = 0; j < gold.size(); ++j )
+        {
+            if( foundSpans.count( make_pair( gold[ j ].begin, gold[ j ].end ) ) )
+                ++score.wordsCorrect;
+            if( gold[ j ].pos.empty() )
+                continue;
+            ++score.goldPOSWords;
+            if( foundWords.count( gold[ j ] ) )
+                ++score.posCorrect;
+        }
+
+        if( !compare )
+            results.push_back( found );
+        else if( lineNo < results.size() && results[ lineNo ].size() == found.size() &&
+                set< Word >( results[ lineNo ].begin(), results[ lineNo ].end() ) == foundWords )
+            ++score.sentencesSame;
+        ++lineNo;
+    }
+    if( !compare )
+        score.sentencesSame = lineNo;
+
+    delete analyzer;
+    delete knowledge;
+    return true;
+}
+
+/**
+ * Get the bytes of the weights of a model with the weight type.
+ */
+size_t weightBytes( const string& model, maxent::me::WeightType type )
+{
+    ifstream in( model.c_str() );
+    if( !in )
+        return 0;
+    in.close();
+    maxent::MaxentModel me;
+    me.load( model );
+    me.quantize( type );
+    return me.weight_bytes();
+}
+
+/**
+ * Print the scores of a weight type.
+ */
+void printScore( const char* name, const Score& score, size_t sentences, size_t bytes,
+        const Score* base )
+{
+    double precision = score.wordsFound ? (double)score.wordsCorrect / score.wordsFound : 0;
+    double recall = score.goldWords ? (double)score.wordsCorrect / score.goldWords : 0;
+    double f1 = precision + recall > 0 ? 2 * precision * recall / ( precision + recall ) : 0;
+    double posAccuracy = score.goldPOSWords ? (double)score.posCorrect / score.goldPOSWords : 0;
+    printf( "%-8s weights %10zu bytes  seg P %.4f R %.4f F1 %.4f  POS %.4f  same %zu/%zu",
+            name, bytes, precision, recall, f1, posAccuracy, score.sentencesSame, sentences );
+    if( base )
+    {
+        double baseP = base->wordsFound ? (double)base->wordsCorrect / base->wordsFound : 0;
+        double baseR = base->goldWords ? (double)base->wordsCorrect / base->goldWords : 0;
+        double baseF1 = baseP + baseR > 0 ? 2 * baseP * baseR / ( baseP + baseR ) : 0;
+        double basePOS = base->goldPOSWords ? (double)base->posCorrect / base->goldPOSWords : 0;
+        printf( "  delta F1 %+.4f POS %+.4f", f1 - baseF1, posAccuracy - basePOS );
+    }
+    printf( "\n" );
+}
+
+/**
+ * Main function.
+ */
+int main(int argc, char* argv[])
+{
+    if( argc < 3 )
+    {
+        printUsage();
+        exit(1);
+    }
+
+    string modelPath = argv[ 1 ];
+    if( modelPath[ modelPath.size() - 1 ] != '/' )
+        modelPath += "/";
+    const char* corpus = argv[ 2 ];
+    vector< Knowledge::ModelWeightType > types;
+    if( argc > 3 )
+    {
+        Knowledge::ModelWeightType type = Knowledge::decodeModelWeightType( argv[ 3 ] );
+        if( type == Knowledge::MODEL_WEIGHT_TYPE_NUM || type == Knowledge::MODEL_WEIGHT_DOUBLE )
+        {
+            cerr << "Unknown quantized weight type " << argv[ 3 ] << endl;
+            exit(1);
+        }
+        types.push_back( type );
+    }
+    else
+    {
+        types.push_back( Knowledge::MODEL_WEIGHT_FLOAT16 );
+        types.push_back( Knowledge::MODEL_WEIGHT_INT8 );
+    }
+    string posDelimiter = argc > 4 ? argv[ 4 ] : "/";
+
+    ifstream in( corpus );
+    if( !in )
+    {
+        cerr << "Fail to open the corpus: " << corpus << endl;
+        exit(1);
+    }
+    in.close();
+
+    const char* names[] = { "double", "float16", "int8" };
+    const maxent::me::WeightType meTypes[] = {
+        maxent::me::WEIGHT_DOUBLE, maxent::me::WEIGHT_FLOAT16, maxent::me::WEIGHT_INT8 };
+
+    vector< vector< Word > > results;
+    Score base;
+    if( !evaluate( modelPath.c_str(), corpus, posDelimiter, Knowledge::MODEL_WEIGHT_DOUBLE,
+            results, base ) )
+    {
+        cerr << "Fail to load the models in " << modelPath << endl;
+        exit(1);
+    }
+    size_t bytes = weightBytes( modelPath + "poc.model", meTypes[ 0 ] ) +
+            weightBytes( modelPath + "pos.model", meTypes[ 0 ] );
+    printScore( names[ 0 ], base, results.size(), bytes, 0 );
+
+    for( size_t i = 0; i < types.size(); ++i )
+    {
+        Score score;
+        evaluate( modelPath.c_str(), corpus, posDelimiter, types[ i ], results, score );
+        bytes = weightBytes( modelPath + "poc.model", meTypes[ types[ i ] ] ) +
+                weightBytes( modelPath + "pos.model", meTypes[ types[ i ] ] );
+        printScore( names[ types[ i ] ], score, results.size(), bytes, &base );
+    }
+
+    return 0;
+}
@@ -6,10 +6,12 @@
  */
 
 #include "icma/icma.h"
+#include "icma/util/LineReader.h"
 
 #include <iostream>
 #include <fstream>
 #include <cassert>
+#include <cstring>
 #include <string>
 
 using namespace std;
@@ -37,8 +39,9 @@ int main(int argc, char* argv[])
     const char* inFile = argv[ 1 ];
     const char* outFile = argv[ 2 ];
 
-    ifstream fin( inFile );
-    if( fin == NULL || fin.fail() == true )
+    // the input is mapped into memory if it is a regular file
+    LineReader fin;
+    if( fin.open( inFile ) == false )
     {
         cerr << "Fail to open input: " << inFile << endl;
         exit(1);
@@ -60,44 +63,46 @@ int main(int argc, char* argv[])
     cout << "Begin segment SCD file ... " << endl;
 
     ofstream fout( outFile );
-    string line;
+    const char* line;
+    size_t len;
+    bool remains;
     bool toSeg = false;
-    while( fin.eof() == false )
+    while( fin.next( line, len, remains ) )
     {
-        getline( fin, line );
-        if( line.empty() == true )
+        if( len == 0 )
         {
-            fout << endl;
+            fout << '\n';
             continue;
         }
 
         if( line[ 0 ] == '<' )
         {
-            size_t endPOS = line.find( '>', 1 );
-            if( endPOS != line.npos )
+            const char* endPOS = (const char*)memchr( line + 1, '>', len - 1 );
+            if( endPOS != NULL )
             {
-                string tagName = line.substr( 1, endPOS - 1 );
+                string tagName( line + 1, endPOS - line - 1 );
                 //cout << "tagName " << tagName << endl;
                 if( tagName != "Title" && tagName != "Content" )
                 {
-                    fout << line << endl;
+                    fout.write( line, len ) << '\n';
                     toSeg = false;
                     continue;
                 }
                 fout << "<" << tagName << ">";
                 toSeg = true;
-                line = line.substr( endPOS + 1 );
+                len -= endPOS + 1 - line;
+                line = endPOS + 1;
             }
 
         }
 
         if( toSeg == false )
         {
-            fout << line << endl;
+            fout.write( line, len ) << '\n';
             continue;
         }
 
-        fout << analyzer->runWithString( line.c_str() ) << endl;
+        fout << analyzer->runWithString( line, len ) << '\n';
 
     }
 
@@ -8,7 +8,15 @@
 #include <boost/test/unit_test.hpp>
 
 #include "icma/icma.h"
+#include "icma/pos_table.h"
+#include "icma/util/LinePipeline.h"
+#include "icma/util/LineReader.h"
+#include "icma/util/StrBasedVTrie.h"
 
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -38,6 +46,37 @@ void createKnowledgeAndAnalyzer(
     (*analyzer)->setOption( Analyzer::OPTION_ANALYSIS_TYPE, analysisType );
 }
 
+/** the knowledge of the CTB model, which has the POC and POS models */
+Knowledge* ctbKnowledge = NULL;
+
+/** create an analyzer of the CTB model, whose texts are in GB2312 */
+Analyzer* createCTBAnalyzer( int analysisType = 1 )
+{
+    CMA_Factory* factory = CMA_Factory::instance();
+
+    if( ctbKnowledge == NULL )
+    {
+        Knowledge* knowledge = factory->createKnowledge();
+        BOOST_REQUIRE( knowledge->loadModel( "../db/ctb/gb2312/", true ) == 1 );
+        ctbKnowledge = knowledge;
+    }
+
+    Analyzer* analyzer = factory->createAnalyzer();
+    analyzer->setKnowledge( ctbKnowledge );
+    analyzer->setOption( Analyzer::OPTION_ANALYSIS_TYPE, analysisType );
+    return analyzer;
+}
+
+// the GB2312 texts of the CTB analyzers
+#define GB_YI "\xD2\xC2"                                   // 衣
+#define GB_YIFU "\xD2\xC2\xB7\xFE"                         // 衣服
+#define GB_GUSHI "\xB5\xC4\xB9\xCA\xCA\xC2"                // 的故事
+#define GB_STORY "\xCE\xD2\xBA\xCD" GB_YIFU GB_GUSHI        // 我和衣服的故事
+#define GB_COMMA "\xA3\xAC"                                // ，
+#define GB_PERIOD "\xA1\xA3"                               // 。
+#define GB_QUESTION "\xA3\xBF"                             // ？
+#define GB_EXCLAMATION "\xA3\xA1"                          // ！
+
 BOOST_AUTO_TEST_SUITE(icma_core_test)
 
 BOOST_AUTO_TEST_CASE(icma_basicapi)
@@ -300,5 +339,963 @@ BOOST_AUTO_TEST_CASE(icma_maxprefix)
     delete knowledge;
 }
 
+// analyze a batch of sentences with several threads
+BOOST_AUTO_TEST_CASE(icma_batch_sentences)
+{
+    Analyzer* analyzer = createCTBAnalyzer( 3 );
+
+    const char* inputs[] = {
+        GB_STORY,
+        GB_YIFU,
+        "",
+        GB_STORY GB_COMMA GB_STORY GB_COMMA GB_STORY GB_PERIOD,
+        "abc 123 " GB_YIFU
+    };
+    size_t inputNum = sizeof( inputs ) / sizeof( inputs[ 0 ] );
+
+    // the threads of the first batch analyze the second one, whose long
+    // sentences are not split by more threads
+    for( int round = 0; round < 2; ++round )
+    {
+        if( round == 1 )
+        {
+            analyzer->setOption( Analyzer::OPTION_TYPE_SPLIT_LENGTH, 8 );
+            analyzer->setOption( Analyzer::OPTION_TYPE_THREAD_NUM, 4 );
+        }
+        vector< Sentence > batch;
+        for( size_t r = 0; r < 20; ++r )
+        {
+            for( size_t i = 0; i < inputNum; ++i )
+                batch.push_back( Sentence( inputs[ i ] ) );
+        }
+        BOOST_CHECK( analyzer->runWithSentences( batch, 4 ) == 1 );
+
+        // each sentence has the same result as runWithSentence()
+        for( size_t i = 0; i < batch.size(); ++i )
+        {
+            Sentence sent;
+            sent.setString( batch[ i ].getString() );
+            BOOST_CHECK( analyzer->runWithSentence( sent ) == 1 );
+            BOOST_CHECK( sent.getListSize() == batch[ i ].getListSize() );
+            if( sent.getListSize() != batch[ i ].getListSize() )
+                continue;
+            for( int j = 0; j < sent.getListSize(); ++j )
+            {
+                BOOST_CHECK( sent.getCount( j ) == batch[ i ].getCount( j ) );
+                if( sent.getCount( j ) != batch[ i ].getCount( j ) )
+                    continue;
+                for( int k = 0; k < sent.getCount( j ); ++k )
+                {
+                    BOOST_CHECK( strcmp( sent.getLexicon( j, k ), batch[ i ].getLexicon( j, k ) ) == 0 );
+                    BOOST_CHECK( strcmp( sent.getStrPOS( j, k ), batch[ i ].getStrPOS( j, k ) ) == 0 );
+                }
+            }
+        }
+    }
+
+    delete analyzer;
+}
+
+// analyze the slices of a buffer without the terminating '\0'
+BOOST_AUTO_TEST_CASE(icma_string_slice)
+{
+    Analyzer* analyzer = createCTBAnalyzer( 3 );
+
+    const char* inputs[] = {
+        GB_STORY,
+        "abc 123 " GB_YIFU,
+        GB_YIFU
+    };
+    size_t inputNum = sizeof( inputs ) / sizeof( inputs[ 0 ] );
+
+    string buffer;
+    for( size_t i = 0; i < inputNum; ++i )
+        buffer.append( inputs[ i ] ).append( "\n" );
+
+    const char* p = buffer.data();
+    for( size_t i = 0; i < inputNum; ++i )
+    {
+        size_t len = strlen( inputs[ i ] );
+        string expected = analyzer->runWithString( inputs[ i ] );
+        BOOST_CHECK( expected == analyzer->runWithString( p, len ) );
+
+        Sentence sent;
+        sent.setString( p, len );
+        BOOST_CHECK( strcmp( sent.getString(), inputs[ i ] ) == 0 );
+        p += len + 1;
+    }
+
+    // the truncated character is kept as it is
+    string half( inputs[ 2 ], strlen( inputs[ 2 ] ) - 1 );
+    BOOST_CHECK( analyzer->runWithString( half.data(), half.size() ) != NULL );
+
+    delete analyzer;
+}
+
+// keep only the byte spans of the morphemes
+BOOST_AUTO_TEST_CASE(icma_lexicon_span)
+{
+    Analyzer* analyzer = createCTBAnalyzer( 3 );
+    analyzer->setOption( Analyzer::OPTION_TYPE_POS_TAGGING, 0 );
+
+    const char* inputs[] = {
+        GB_STORY,
+        "abc 123 " GB_YIFU,
+        GB_YIFU GB_GUSHI GB_QUESTION
+    };
+    size_t inputNum = sizeof( inputs ) / sizeof( inputs[ 0 ] );
+
+    for( size_t i = 0; i < inputNum; ++i )
+    {
+        analyzer->setOption( Analyzer::OPTION_TYPE_SPAN_ONLY, 0 );
+        Sentence expected( inputs[ i ] );
+        BOOST_CHECK( analyzer->runWithSentence( expected ) == 1 );
+
+        analyzer->setOption( Analyzer::OPTION_TYPE_SPAN_ONLY, 1 );
+        Sentence sent( inputs[ i ] );
+        BOOST_CHECK( analyzer->runWithSentence( sent ) == 1 );
+
+        BOOST_CHECK( sent.getListSize() == expected.getListSize() );
+        if( sent.getListSize() != expected.getListSize() )
+            continue;
+        for( int j = 0; j < sent.getListSize(); ++j )
+        {
+            BOOST_CHECK( sent.getCount( j ) == expected.getCount( j ) );
+            if( sent.getCount( j ) != expected.getCount( j ) )
+                continue;
+            for( int k = 0; k < sent.getCount( j ); ++k )
+            {
+                string span( inputs[ i ] + sent.getByteOffset( j, k ), sent.getByteLength( j, k ) );
+                BOOST_CHECK( span == expected.getLexicon( j, k ) );
+                BOOST_CHECK( span == sent.getLexicon( j, k ) );
+            }
+        }
+    }
+
+    delete analyzer;
+}
+
+
+namespace
+{
+
+/** collect the tokens with a functor */
+struct TokenCollector
+{
+    vector< Token > tokens;
+
+    void operator()( const char* input, const Token& token )
+    {
+        tokens.push_back( token );
+    }
+};
+
+/** collect the tokens with a TokenSink */
+class CollectSink : public TokenSink
+{
+public:
+    vector< Token > tokens;
+
+    virtual void onToken( const char* input, const Token& token )
+    {
+        tokens.push_back( token );
+    }
+};
+
+}
+
+BOOST_AUTO_TEST_CASE(icma_token_callback)
+{
+    Analyzer* analyzer = createCTBAnalyzer( 3 );
+
+    const char* inputs[] = {
+        GB_STORY,
+        "abc 123 " GB_YIFU,
+        ""
+    };
+    size_t inputNum = sizeof( inputs ) / sizeof( inputs[ 0 ] );
+
+    for( int pos = 0; pos <= 1; ++pos )
+    {
+        analyzer->setOption( Analyzer::OPTION_TYPE_POS_TAGGING, pos );
+        for( size_t i = 0; i < inputNum; ++i )
+        {
+            Sentence expected( inputs[ i ] );
+            BOOST_CHECK( analyzer->runWithSentence( expected ) == 1 );
+            size_t count = expected.getListSize() > 0 ? expected.getCount( 0 ) : 0;
+
+            size_t len = strlen( inputs[ i ] );
+            TokenCollector collector;
+            BOOST_CHECK( analyzer->runWithCallback( inputs[ i ], len, collector ) == 1 );
+            CollectSink sink;
+            BOOST_CHECK( analyzer->runWithCallback( inputs[ i ], len, sink ) == 1 );
+
+            BOOST_CHECK( collector.tokens.size() == count );
+            BOOST_CHECK( sink.tokens.size() == count );
+            if( collector.tokens.size() != count || sink.tokens.size() != count )
+                continue;
+            for( size_t k = 0; k < count; ++k )
+            {
+                const Token& token = collector.tokens[ k ];
+                string lexicon( inputs[ i ] + token.begin_, token.length_ );
+                BOOST_CHECK( lexicon == expected.getLexicon( 0, k ) );
+                BOOST_CHECK( token.wordOffset_ == expected.getOffset( 0, k ) );
+                BOOST_CHECK( token.posCode_ == ( pos ? expected.getPOS( 0, k ) : -1 ) );
+                BOOST_CHECK( token.isIndexed_ == ( pos ? expected.isIndexWord( 0, k ) : false ) );
+                BOOST_CHECK( sink.tokens[ k ].begin_ == token.begin_ );
+                BOOST_CHECK( sink.tokens[ k ].length_ == token.length_ );
+            }
+        }
+    }
+
+    delete analyzer;
+}
+
+// the word offsets of the forwards minimum cover are not left to the next
+// analysis of other types in the same thread
+BOOST_AUTO_TEST_CASE(icma_word_offset_reset)
+{
+    Analyzer* fmincover = createCTBAnalyzer( 3 );
+    Analyzer* analyzer = createCTBAnalyzer( 1 );
+    Analyzer* cachedAnalyzer = createCTBAnalyzer( 1 );
+    cachedAnalyzer->setOption( Analyzer::OPTION_TYPE_CACHE_SIZE, 16 );
+
+    const char* cover = GB_STORY;
+    const char* input = GB_STORY GB_COMMA "abc 123 " GB_YIFU GB_GUSHI;
+    Analyzer* analyzers[] = { analyzer, cachedAnalyzer, cachedAnalyzer };
+    for( size_t a = 0; a < sizeof( analyzers ) / sizeof( analyzers[ 0 ] ); ++a )
+    {
+        // the forwards minimum cover has word offsets for fewer words
+        TokenCollector coverTokens;
+        BOOST_CHECK( fmincover->runWithCallback( cover, strlen( cover ), coverTokens ) == 1 );
+        BOOST_CHECK( coverTokens.tokens.size() > 1 );
+
+        TokenCollector collector;
+        BOOST_CHECK( analyzers[ a ]->runWithCallback( input, strlen( input ), collector ) == 1 );
+        BOOST_CHECK( collector.tokens.size() > coverTokens.tokens.size() );
+        for( size_t k = 0; k < collector.tokens.size(); ++k )
+            BOOST_CHECK( collector.tokens[ k ].wordOffset_ == k );
+    }
+
+    // a sentence given a new string
+    Sentence sent( cover );
+    BOOST_CHECK( fmincover->runWithSentence( sent ) == 1 );
+    BOOST_CHECK( sent.isIncrementedWordOffset() == false );
+    sent.setString( input );
+    BOOST_CHECK( analyzer->runWithSentence( sent ) == 1 );
+    BOOST_CHECK( sent.getListSize() > 0 );
+    for( int k = 0; sent.getListSize() > 0 && k < sent.getCount( 0 ); ++k )
+        BOOST_CHECK( sent.getOffset( 0, k ) == (size_t)k );
+
+    delete fmincover;
+    delete analyzer;
+    delete cachedAnalyzer;
+}
+
+// the cached results are the same as the analyzed ones
+BOOST_AUTO_TEST_CASE(icma_result_cache)
+{
+    Analyzer* analyzer = createCTBAnalyzer( 3 );
+    Analyzer* cachedAnalyzer = createCTBAnalyzer( 3 );
+    analyzer->setOption( Analyzer::OPTION_TYPE_NBEST, 3 );
+    cachedAnalyzer->setOption( Analyzer::OPTION_TYPE_NBEST, 3 );
+    cachedAnalyzer->setOption( Analyzer::OPTION_TYPE_CACHE_SIZE, 16 );
+
+    const char* inputs[] = {
+        GB_STORY,
+        "abc 123 " GB_YIFU,
+        GB_STORY
+    };
+    size_t inputNum = sizeof( inputs ) / sizeof( inputs[ 0 ] );
+
+    size_t hits, misses, size;
+    for( int round = 0; round < 3; ++round )
+    {
+        // the dictionary is changed in the last round
+        vector< string > words( 1, GB_YIFU );
+        if( round == 2 )
+            ctbKnowledge->disableWords( words );
+
+        for( size_t i = 0; i < inputNum; ++i )
+        {
+            Sentence expected( inputs[ i ] );
+            BOOST_CHECK( analyzer->runWithSentence( expected ) == 1 );
+            Sentence sent( inputs[ i ] );
+            BOOST_CHECK( cachedAnalyzer->runWithSentence( sent ) == 1 );
+
+            BOOST_CHECK( sent.getListSize() == expected.getListSize() );
+            if( sent.getListSize() != expected.getListSize() )
+                continue;
+            for( int j = 0; j < sent.getListSize(); ++j )
+            {
+                BOOST_CHECK( sent.getScore( j ) == expected.getScore( j ) );
+                BOOST_CHECK( sent.getCount( j ) == expected.getCount( j ) );
+                if( sent.getCount( j ) != expected.getCount( j ) )
+                    continue;
+                for( int k = 0; k < sent.getCount( j ); ++k )
+                {
+                    BOOST_CHECK( strcmp( sent.getLexicon( j, k ), expected.getLexicon( j, k ) ) == 0 );
+                    BOOST_CHECK( strcmp( sent.getStrPOS( j, k ), expected.getStrPOS( j, k ) ) == 0 );
+                    BOOST_CHECK( sent.getPOS( j, k ) == expected.getPOS( j, k ) );
+                    BOOST_CHECK( sent.getOffset( j, k ) == expected.getOffset( j, k ) );
+                }
+            }
+
+            // runWithString uses the one-best result, which is another key
+            string str = analyzer->runWithString( inputs[ i ] );
+            BOOST_CHECK( str == cachedAnalyzer->runWithString( inputs[ i ] ) );
+        }
+
+        if( round == 2 )
+            ctbKnowledge->enableWords( words );
+
+        cachedAnalyzer->getCacheStatistics( hits, misses, size );
+        if( round == 0 )
+        {
+            BOOST_CHECK( hits == 2 );
+            BOOST_CHECK( misses == 4 );
+            BOOST_CHECK( size == 4 );
+        }
+        else if( round == 1 )
+        {
+            BOOST_CHECK( hits == 8 );
+            BOOST_CHECK( misses == 4 );
+        }
+        else
+        {
+            // the results before the change are not used
+            BOOST_CHECK( hits == 10 );
+            BOOST_CHECK( misses == 8 );
+        }
+    }
+
+    cachedAnalyzer->clearCache();
+    cachedAnalyzer->getCacheStatistics( hits, misses, size );
+    BOOST_CHECK( size == 0 );
+
+    delete analyzer;
+    delete cachedAnalyzer;
+}
+
+// split a long input at the sentence separators and analyze the pieces
+// with several threads
+BOOST_AUTO_TEST_CASE(icma_split_long_input)
+{
+    Analyzer* analyzer = createCTBAnalyzer( 1 );
+
+    const char* sentences[] = {
+        GB_STORY GB_PERIOD,
+        "abc 123 " GB_YIFU GB_EXCLAMATION,
+        GB_STORY GB_COMMA GB_YIFU GB_GUSHI GB_QUESTION,
+        GB_YIFU
+    };
+    size_t sentenceNum = sizeof( sentences ) / sizeof( sentences[ 0 ] );
+    string doc;
+    for( size_t i = 0; i < 500; ++i )
+        doc += sentences[ ( i * 7 ) % sentenceNum ];
+
+    for( int pos = 0; pos <= 1; ++pos )
+    {
+        analyzer->setOption( Analyzer::OPTION_TYPE_POS_TAGGING, pos );
+        analyzer->setOption( Analyzer::OPTION_TYPE_SPLIT_LENGTH, 0 );
+        string expectedStr = analyzer->runWithString( doc.c_str() );
+        Sentence expected( doc.c_str() );
+        BOOST_CHECK( analyzer->runWithSentence( expected ) == 1 );
+
+        analyzer->setOption( Analyzer::OPTION_TYPE_THREAD_NUM, 4 );
+        analyzer->setOption( Analyzer::OPTION_TYPE_SPLIT_LENGTH, 1 );
+        BOOST_CHECK( expectedStr == analyzer->runWithString( doc.c_str() ) );
+        Sentence sent( doc.c_str() );
+        BOOST_CHECK( analyzer->runWithSentence( sent ) == 1 );
+        analyzer->setOption( Analyzer::OPTION_TYPE_THREAD_NUM, 1 );
+
+        BOOST_CHECK( sent.getListSize() == 1 );
+        BOOST_CHECK( sent.getListSize() == expected.getListSize() );
+        if( sent.getListSize() != expected.getListSize() )
+            continue;
+        BOOST_CHECK( sent.getCount( 0 ) == expected.getCount( 0 ) );
+        if( sent.getCount( 0 ) != expected.getCount( 0 ) )
+            continue;
+        for( int k = 0; k < sent.getCount( 0 ); ++k )
+        {
+            BOOST_CHECK( strcmp( sent.getLexicon( 0, k ), expected.getLexicon( 0, k ) ) == 0 );
+            BOOST_CHECK( sent.getOffset( 0, k ) == expected.getOffset( 0, k ) );
+            if( pos )
+                BOOST_CHECK( strcmp( sent.getStrPOS( 0, k ), expected.getStrPOS( 0, k ) ) == 0 );
+        }
+    }
+
+    delete analyzer;
+}
+
+
+BOOST_AUTO_TEST_CASE(icma_ascii_run)
+{
+    Analyzer* analyzer = createCTBAnalyzer( 1 );
+    analyzer->setOption( Analyzer::OPTION_TYPE_POS_TAGGING, 0 );
+
+    const char* str = "iPhone13\xCA\xD6\xBB\xFA\xBF\xC7" "256GB" GB_COMMA "USB-C\xCA\xFD\xBE\xDD\xCF\xDF";
+    const char* asciiWords[] = { "iPhone13", "256GB", "USB-C" };
+    size_t asciiNum = sizeof( asciiWords ) / sizeof( asciiWords[ 0 ] );
+
+    // the first run evaluates the model for the ASCII characters, the second
+    // one uses the known tags
+    string expectedStr = analyzer->runWithString( str );
+    BOOST_CHECK( expectedStr == analyzer->runWithString( str ) );
+
+    Sentence sent( str );
+    BOOST_CHECK( analyzer->runWithSentence( sent ) == 1 );
+    for( size_t i = 0; i < asciiNum; ++i )
+    {
+        bool found = false;
+        for( int k = 0; k < sent.getCount( 0 ); ++k )
+        {
+            if( strcmp( sent.getLexicon( 0, k ), asciiWords[ i ] ) == 0 )
+                found = true;
+        }
+        BOOST_CHECK( found );
+    }
+
+    delete analyzer;
+}
+
+// tag the words of the one-best result again, without segmenting them
+BOOST_AUTO_TEST_CASE(icma_tag_tokens)
+{
+    Analyzer* analyzer = createCTBAnalyzer( 1 );
+    analyzer->setOption( Analyzer::OPTION_TYPE_POS_TAGGING, 1 );
+
+    const char* inputs[] = {
+        GB_STORY,
+        "abc123" GB_YIFU,
+        GB_STORY GB_COMMA GB_STORY GB_PERIOD
+    };
+    size_t inputNum = sizeof( inputs ) / sizeof( inputs[ 0 ] );
+
+    for( size_t i = 0; i < inputNum; ++i )
+    {
+        Sentence expected( inputs[ i ] );
+        BOOST_CHECK( analyzer->runWithSentence( expected ) == 1 );
+        vector< string > tokens;
+        for( int k = 0; k < expected.getCount( 0 ); ++k )
+        {
+            tokens.push_back( expected.getLexicon( 0, k ) );
+            tokens.push_back( "" );
+        }
+
+        Sentence sent;
+        BOOST_CHECK( analyzer->tagTokens( tokens, sent ) == 1 );
+        BOOST_CHECK( strcmp( sent.getString(), inputs[ i ] ) == 0 );
+        BOOST_CHECK( sent.getListSize() == 1 );
+        BOOST_CHECK( sent.getCount( 0 ) == expected.getCount( 0 ) );
+        if( sent.getCount( 0 ) != expected.getCount( 0 ) )
+            continue;
+        for( int k = 0; k < sent.getCount( 0 ); ++k )
+        {
+            BOOST_CHECK( strcmp( sent.getLexicon( 0, k ), expected.getLexicon( 0, k ) ) == 0 );
+            BOOST_CHECK( sent.getByteOffset( 0, k ) == expected.getByteOffset( 0, k ) );
+            BOOST_CHECK( sent.getPOS( 0, k ) == expected.getPOS( 0, k ) );
+        }
+    }
+
+    Sentence empty;
+    BOOST_CHECK( analyzer->tagTokens( vector< string >(), empty ) == 1 );
+    BOOST_CHECK( empty.getListSize() == 0 );
+
+    delete analyzer;
+}
+
+
+// the double-array trie of cma.config gives the same results as the VTrie
+BOOST_AUTO_TEST_CASE(icma_datrie)
+{
+    Analyzer* analyzer = createCTBAnalyzer( 3 );
+    analyzer->setOption( Analyzer::OPTION_TYPE_NBEST, 3 );
+
+    const char* inputs[] = {
+        GB_STORY,
+        "abc 123 " GB_YIFU GB_GUSHI GB_COMMA GB_YI,
+        GB_YI
+    };
+    size_t inputNum = sizeof( inputs ) / sizeof( inputs[ 0 ] );
+    int types[] = { 1, 2, 3, 5 };
+    size_t typeNum = sizeof( types ) / sizeof( types[ 0 ] );
+    vector< string > words( 1, GB_YIFU );
+
+    // the results with the VTrie and the DATrie, the word is disabled in
+    // the second round
+    vector< string > results[ 2 ];
+    string configFiles[ 2 ] = { "icma_vtrie.config", "icma_datrie.config" };
+    for( int trie = 0; trie < 2; ++trie )
+    {
+        ofstream config( configFiles[ trie ].c_str() );
+        config << "dictionary_trie = " << ( trie ? "datrie" : "vtrie" ) << endl;
+        config.close();
+        BOOST_CHECK( ctbKnowledge->loadConfig( configFiles[ trie ].c_str() ) == 1 );
+
+        for( int round = 0; round < 2; ++round )
+        {
+            if( round == 1 )
+                ctbKnowledge->disableWords( words );
+            BOOST_CHECK( ctbKnowledge->isExistWord( words[ 0 ].c_str() ) == ( round == 0 ) );
+            for( size_t t = 0; t < typeNum; ++t )
+            {
+                analyzer->setOption( Analyzer::OPTION_ANALYSIS_TYPE, types[ t ] );
+                for( size_t i = 0; i < inputNum; ++i )
+                    results[ trie ].push_back( analyzer->runWithString( inputs[ i ] ) );
+            }
+            if( round == 1 )
+                ctbKnowledge->enableWords( words );
+        }
+    }
+    BOOST_CHECK( results[ 0 ] == results[ 1 ] );
+
+    // the other tests use the VTrie
+    BOOST_CHECK( ctbKnowledge->loadConfig( configFiles[ 0 ].c_str() ) == 1 );
+    remove( configFiles[ 0 ].c_str() );
+    remove( configFiles[ 1 ].c_str() );
+
+    delete analyzer;
+}
+
+namespace
+{
+
+/** write the content into the file */
+void writeFile( const char* fileName, const string& content )
+{
+    ofstream out( fileName, ios::binary );
+    out << content;
+}
+
+/** read the whole content of the file */
+string readFile( const char* fileName )
+{
+    ifstream in( fileName, ios::binary );
+    ostringstream content;
+    content << in.rdbuf();
+    return content.str();
+}
+
+/** run the pipeline on the file, the lines are copied with a '|' after them */
+string runPipeline( const char* fileName, unsigned int workerNum )
+{
+    LineReader in;
+    BOOST_CHECK( in.open( fileName ) );
+    ostringstream out;
+    LinePipeline pipeline( workerNum, 3 );
+    pipeline.run( in, out, []( LineBatch& batch ) {
+        for( size_t i = 0; i < batch.size; ++i )
+        {
+            batch.output.append( batch.lines[ i ], batch.lengths[ i ] );
+            batch.output.append( batch.remains[ i ] ? "|\n" : "|" );
+        }
+    } );
+    return out.str();
+}
+
+}
+
+// the lines are processed in order with several threads
+BOOST_AUTO_TEST_CASE(icma_line_pipeline)
+{
+    string lines;
+    for( size_t i = 0; i < 1000; ++i )
+    {
+        lines.append( i % 7, (char)( 'a' + i % 26 ) );
+        lines.push_back( '\n' );
+    }
+    string contents[] = { lines, lines + "xyz", "" };
+    const char* fileName = "icma_line_pipeline.txt";
+    for( size_t c = 0; c < sizeof( contents ) / sizeof( contents[ 0 ] ); ++c )
+    {
+        const string& content = contents[ c ];
+        string expected;
+        for( size_t i = 0; i < content.size(); ++i )
+        {
+            if( content[ i ] == '\n' )
+                expected.push_back( '|' );
+            expected.push_back( content[ i ] );
+        }
+        expected.push_back( '|' );
+
+        writeFile( fileName, content );
+        string single = runPipeline( fileName, 1 );
+        BOOST_CHECK( single == expected );
+        BOOST_CHECK( runPipeline( fileName, 4 ) == single );
+    }
+    remove( fileName );
+}
+
+// the stream is analyzed with several threads as with one thread
+BOOST_AUTO_TEST_CASE(icma_stream_threads)
+{
+    Analyzer* analyzer = createCTBAnalyzer( 1 );
+
+    const char* sentences[] = {
+        GB_STORY,
+        "abc 123 " GB_YIFU,
+        "",
+        GB_STORY GB_COMMA GB_YIFU GB_GUSHI GB_QUESTION
+    };
+    size_t sentenceNum = sizeof( sentences ) / sizeof( sentences[ 0 ] );
+    string doc;
+    for( size_t i = 0; i < 2000; ++i )
+        doc.append( sentences[ ( i * 7 ) % sentenceNum ] ).push_back( '\n' );
+    string contents[] = { doc, doc + sentences[ 0 ], "" };
+    const char* inFile = "icma_stream_in.txt";
+    const char* outFile = "icma_stream_out.txt";
+    for( size_t c = 0; c < sizeof( contents ) / sizeof( contents[ 0 ] ); ++c )
+    {
+        writeFile( inFile, contents[ c ] );
+        for( int pos = 0; pos <= 1; ++pos )
+        {
+            analyzer->setOption( Analyzer::OPTION_TYPE_POS_TAGGING, pos );
+            analyzer->setOption( Analyzer::OPTION_TYPE_THREAD_NUM, 1 );
+            BOOST_CHECK( analyzer->runWithStream( inFile, outFile ) == 1 );
+            string expected = readFile( outFile );
+            BOOST_CHECK( expected.size() >= contents[ c ].size() );
+
+            analyzer->setOption( Analyzer::OPTION_TYPE_THREAD_NUM, 4 );
+            BOOST_CHECK( analyzer->runWithStream( inFile, outFile ) == 1 );
+            BOOST_CHECK( readFile( outFile ) == expected );
+        }
+    }
+    remove( inFile );
+    remove( outFile );
+
+    delete analyzer;
+}
+
+namespace
+{
+
+/** a line read by LineReader */
+struct ReadLine
+{
+    string line;
+    bool remains;
+};
+
+/** read all the lines of the file */
+vector< ReadLine > readLines( const char* fileName, bool& mapped )
+{
+    vector< ReadLine > lines;
+    LineReader in;
+    BOOST_CHECK( in.open( fileName ) );
+    mapped = in.isMapped();
+    const char* line;
+    size_t len;
+    bool remains;
+    while( in.next( line, len, remains ) )
+    {
+        // the slice is followed by a readable character
+        BOOST_CHECK( line[ len ] == '\n' || line[ len ] == '\0' );
+        ReadLine read = { string( line, len ), remains };
+        lines.push_back( read );
+    }
+    return lines;
+}
+
+}
+
+// the lines are split like std::getline(), the regular file is mapped
+BOOST_AUTO_TEST_CASE(icma_line_reader)
+{
+    struct Case
+    {
+        const char* content;
+        bool mapped;
+        const char* lines[ 4 ];
+    };
+    // the lines end with NULL, all but the last one have more content
+    // after them
+    Case cases[] = {
+        { "ab\n\ncd\n", true, { "ab", "", "cd", "" } },
+        { "ab\ncd", true, { "ab", "cd", NULL } },
+        { "ab\r\ncd\r\n", true, { "ab\r", "cd\r", "", NULL } },
+        { "\n", true, { "", "", NULL } },
+        { "", false, { "", NULL } }
+    };
+    const char* fileName = "icma_line_reader.txt";
+    for( size_t c = 0; c < sizeof( cases ) / sizeof( cases[ 0 ] ); ++c )
+    {
+        writeFile( fileName, cases[ c ].content );
+        bool mapped;
+        vector< ReadLine > lines = readLines( fileName, mapped );
+        BOOST_CHECK( mapped == cases[ c ].mapped );
+
+        size_t lineNum = 0;
+        while( lineNum < 4 && cases[ c ].lines[ lineNum ] )
+            ++lineNum;
+        BOOST_CHECK( lines.size() == lineNum );
+        for( size_t i = 0; i < lines.size() && i < lineNum; ++i )
+        {
+            BOOST_CHECK( lines[ i ].line == cases[ c ].lines[ i ] );
+            BOOST_CHECK( lines[ i ].remains == ( i + 1 < lineNum ) );
+        }
+    }
+    remove( fileName );
+
+    LineReader in;
+    BOOST_CHECK( in.open( "icma_line_reader_missing.txt" ) == false );
+}
+
+
+// the beam search of the POS tags gives a valid tag for each word
+BOOST_AUTO_TEST_CASE(icma_pos_beam)
+{
+    Analyzer* analyzer = createCTBAnalyzer( 1 );
+    analyzer->setOption( Analyzer::OPTION_TYPE_POS_TAGGING, 1 );
+
+    const char* inputs[] = {
+        GB_STORY GB_COMMA GB_YIFU GB_GUSHI GB_QUESTION,
+        "abc 123 " GB_YIFU,
+        GB_YI
+    };
+    size_t inputNum = sizeof( inputs ) / sizeof( inputs[ 0 ] );
+
+    for( size_t i = 0; i < inputNum; ++i )
+    {
+        analyzer->setOption( Analyzer::OPTION_TYPE_POS_BEAM_WIDTH, 1 );
+        Sentence greedy( inputs[ i ] );
+        BOOST_CHECK( analyzer->runWithSentence( greedy ) == 1 );
+        BOOST_CHECK( greedy.getListSize() == 1 );
+        if( greedy.getListSize() != 1 )
+            continue;
+
+        int widths[] = { 1, 2, 8 };
+        for( size_t w = 0; w < sizeof( widths ) / sizeof( widths[ 0 ] ); ++w )
+        {
+            analyzer->setOption( Analyzer::OPTION_TYPE_POS_BEAM_WIDTH, widths[ w ] );
+            Sentence sent( inputs[ i ] );
+            BOOST_CHECK( analyzer->runWithSentence( sent ) == 1 );
+
+            // the words are the same, only the tags may be different
+            BOOST_CHECK( sent.getListSize() == 1 );
+            BOOST_CHECK( sent.getCount( 0 ) == greedy.getCount( 0 ) );
+            if( sent.getListSize() != 1 || sent.getCount( 0 ) != greedy.getCount( 0 ) )
+                continue;
+            for( int k = 0; k < sent.getCount( 0 ); ++k )
+            {
+                BOOST_CHECK( strcmp( sent.getLexicon( 0, k ), greedy.getLexicon( 0, k ) ) == 0 );
+                int code = sent.getPOS( 0, k );
+                BOOST_CHECK( code >= 0 );
+                BOOST_CHECK( strlen( sent.getStrPOS( 0, k ) ) > 0 );
+                BOOST_CHECK( analyzer->getCodeFromStr( sent.getStrPOS( 0, k ) ) == code );
+                if( widths[ w ] == 1 )
+                    BOOST_CHECK( code == greedy.getPOS( 0, k ) );
+            }
+
+            // runWithString prints the same tags
+            string expected;
+            for( int k = 0; k < sent.getCount( 0 ); ++k )
+                expected.append( sent.getLexicon( 0, k ) ).append( "/" )
+                        .append( sent.getStrPOS( 0, k ) ).append( "  " );
+            BOOST_CHECK( expected == analyzer->runWithString( inputs[ i ] ) );
+        }
+    }
+
+    delete analyzer;
+}
+
+
+// the dictionary words which are the prefixes of a text
+BOOST_AUTO_TEST_CASE(icma_prefix_search)
+{
+    const char* words[] = { "中", "中国", "中国人", "国人", "北京" };
+    VTrie trie;
+    VTrieNode node;
+    for( size_t i = 0; i < sizeof( words ) / sizeof( words[ 0 ] ); ++i )
+    {
+        node.init();
+        node.data = (int)i + 1;
+        trie.insert( words[ i ], &node );
+    }
+
+    // the ( byte count, value ) of each prefix found
+    typedef vector< pair< size_t, int > > PrefixList;
+    struct PrefixCase
+    {
+        const char* text;
+        size_t walked;
+        PrefixList prefixes;
+    };
+    PrefixCase cases[] = {
+        // none matches
+        { "美国", 0, PrefixList() },
+        { "", 0, PrefixList() },
+        // only the prefix of a word
+        { "北", 3, PrefixList() },
+        // the word is the whole text
+        { "北京", 6, PrefixList( 1, make_pair( (size_t)6, 5 ) ) },
+        // the nested words, the walk stops after the longest one
+        { "中国人民", 9, PrefixList() },
+        { "中文", 3, PrefixList( 1, make_pair( (size_t)3, 1 ) ) }
+    };
+    cases[ 4 ].prefixes.push_back( make_pair( (size_t)3, 1 ) );
+    cases[ 4 ].prefixes.push_back( make_pair( (size_t)6, 2 ) );
+    cases[ 4 ].prefixes.push_back( make_pair( (size_t)9, 3 ) );
+
+    for( size_t i = 0; i < sizeof( cases ) / sizeof( cases[ 0 ] ); ++i )
+    {
+        PrefixList found;
+        size_t walked = trie.commonPrefixSearch( cases[ i ].text, strlen( cases[ i ].text ),
+                [&found]( size_t len, int value ) { found.push_back( make_pair( len, value ) ); } );
+        BOOST_CHECK_EQUAL( walked, cases[ i ].walked );
+        BOOST_CHECK( found == cases[ i ].prefixes );
+    }
+
+    // the text searched piece by piece finds the same words
+    PrefixList found;
+    size_t pieceBegin = 0;
+    VTrieNode walkNode;
+    const char* pieces[] = { "中", "国", "人" };
+    for( size_t i = 0; i < 3; ++i )
+    {
+        BOOST_CHECK_EQUAL( trie.commonPrefixSearch( pieces[ i ], 3, &walkNode,
+                [&]( size_t len, int value ) {
+                    found.push_back( make_pair( pieceBegin + len, value ) );
+                } ), 3u );
+        pieceBegin += 3;
+    }
+    BOOST_CHECK( found == cases[ 4 ].prefixes );
+    BOOST_CHECK( walkNode.moreLong == false );
+
+    // the words starting at each character
+    StringVectorType chars;
+    const char* text[] = { "中", "国", "人", "民", "北" };
+    for( size_t i = 0; i < sizeof( text ) / sizeof( text[ 0 ] ); ++i )
+        chars.push_back( text[ i ] );
+    VTrieDict dict( &trie );
+    VTrieDAG dag;
+    dag.build( &dict, chars, 0, chars.size() );
+
+    size_t matchEnds[][ 4 ] = { { 1, 2, 3, 0 }, { 3, 0 }, { 0 }, { 0 }, { 0 } };
+    size_t reaches[] = { 3, 3, 2, 3, 5 };
+    for( size_t start = 0; start < chars.size(); ++start )
+    {
+        BOOST_CHECK( dag.contains( start ) );
+        vector< size_t > ends;
+        for( const VTrieDAG::Match* m = dag.matchBegin( start ); m != dag.matchEnd( start ); ++m )
+            ends.push_back( m->end );
+        vector< size_t > expected;
+        for( size_t k = 0; matchEnds[ start ][ k ]; ++k )
+            expected.push_back( matchEnds[ start ][ k ] );
+        BOOST_CHECK( ends == expected );
+        BOOST_CHECK_EQUAL( dag.reach( start ), reaches[ start ] );
+    }
+    BOOST_CHECK( dag.matchBegin( 0 )[ 1 ].value == 2 );
+    BOOST_CHECK( dag.matchBegin( 0 )[ 1 ].moreLong == true );
+    BOOST_CHECK( dag.matchBegin( 0 )[ 2 ].moreLong == false );
+
+    // the words beyond the range are not found
+    dag.build( &dict, chars, 1, 2 );
+    BOOST_CHECK( !dag.contains( 0 ) && dag.contains( 1 ) && !dag.contains( 2 ) );
+    BOOST_CHECK( dag.matchBegin( 1 ) == dag.matchEnd( 1 ) );
+    BOOST_CHECK_EQUAL( dag.reach( 1 ), 2u );
+
+    // a word covering all the characters
+    chars.clear();
+    chars.push_back( "北" );
+    chars.push_back( "京" );
+    dag.build( &dict, chars, 0, chars.size() );
+    BOOST_CHECK( dag.matchEnd( 0 ) - dag.matchBegin( 0 ) == 1 );
+    BOOST_CHECK_EQUAL( dag.matchBegin( 0 )->end, chars.size() );
+    BOOST_CHECK_EQUAL( dag.matchBegin( 0 )->value, 5 );
+    BOOST_CHECK( dag.matchBegin( 1 ) == dag.matchEnd( 1 ) );
+
+    // no character
+    dag.build( &dict, chars, 0, 0 );
+    BOOST_CHECK( !dag.contains( 0 ) );
+}
+
+
+// the greedy tagger gives each word its most probable candidate tag
+BOOST_AUTO_TEST_CASE(icma_greedy_pos)
+{
+    Analyzer* analyzer = createCTBAnalyzer( 1 );
+    analyzer->setOption( Analyzer::OPTION_TYPE_POS_TAGGING, 1 );
+
+    // 今天天气很好，我们一起去公园散步吧！
+    Sentence sent( "\xBD\xF1\xCC\xEC\xCC\xEC\xC6\xF8\xBA\xDC\xBA\xC3\xA3\xAC\xCE\xD2\xC3\xC7"
+            "\xD2\xBB\xC6\xF0\xC8\xA5\xB9\xAB\xD4\xB0\xC9\xA2\xB2\xBD\xB0\xC9\xA3\xA1" );
+    BOOST_CHECK( analyzer->runWithSentence( sent ) == 1 );
+
+    // 很, 好, 起 and 去 have several candidate tags
+    const char* tags[] = { "NT", "NN", "AD", "VA", "W", "PN", "M", "VV", "VV", "NN", "VV", "SP", "W" };
+    int count = sizeof( tags ) / sizeof( tags[ 0 ] );
+    BOOST_CHECK_EQUAL( sent.getCount( 0 ), count );
+    for( int k = 0; k < sent.getCount( 0 ) && k < count; ++k )
+        BOOST_CHECK_EQUAL( string( sent.getStrPOS( 0, k ) ), tags[ k ] );
+
+    delete analyzer;
+}
+
+
+// the tags of 的, 得 and 地 keep their own POS codes
+BOOST_AUTO_TEST_CASE(icma_pos_codes)
+{
+    Analyzer* analyzer = createCTBAnalyzer( 1 );
+    analyzer->setOption( Analyzer::OPTION_TYPE_POS_TAGGING, 1 );
+
+    // the codes follow the order of pos.pos, the tags sharing the first
+    // two letters are not mixed up
+    const char* tags[] = { "AD", "DEC", "DEG", "DER", "DEV", "NN", "NN-SHORT", "PN", "VV" };
+    int codes[] = { 1, 7, 8, 9, 10, 20, 21, 28, 35 };
+    for( size_t i = 0; i < sizeof( tags ) / sizeof( tags[ 0 ] ); ++i )
+    {
+        BOOST_CHECK_EQUAL( analyzer->getCodeFromStr( tags[ i ] ), codes[ i ] );
+        BOOST_CHECK_EQUAL( string( analyzer->getStrFromCode( codes[ i ] ) ), tags[ i ] );
+    }
+
+    struct TaggedSentence
+    {
+        const char* input;
+        const char* tags[ 5 ];
+    };
+    TaggedSentence sents[] = {
+        // 我们/PN 看/VV 的/DEC 电影/NN
+        { "\xCE\xD2\xC3\xC7\xBF\xB4\xB5\xC4\xB5\xE7\xD3\xB0", { "PN", "VV", "DEC", "NN", 0 } },
+        // 经济/NN 发展/NN 的/DEG 速度/NN
+        { "\xBE\xAD\xBC\xC3\xB7\xA2\xD5\xB9\xB5\xC4\xCB\xD9\xB6\xC8", { "NN", "NN", "DEG", "NN", 0 } },
+        // 跑/VV 得/DER 很/AD 快/VA
+        { "\xC5\xDC\xB5\xC3\xBA\xDC\xBF\xEC", { "VV", "DER", "AD", "VA", 0 } },
+        // 慢慢/AD 地/DEV 走/VV
+        { "\xC2\xFD\xC2\xFD\xB5\xD8\xD7\xDF", { "AD", "DEV", "VV", 0, 0 } }
+    };
+    for( size_t i = 0; i < sizeof( sents ) / sizeof( sents[ 0 ] ); ++i )
+    {
+        Sentence sent( sents[ i ].input );
+        BOOST_CHECK( analyzer->runWithSentence( sent ) == 1 );
+        BOOST_CHECK( sent.getListSize() == 1 );
+        int count = 0;
+        while( count < 5 && sents[ i ].tags[ count ] )
+            ++count;
+        BOOST_CHECK_EQUAL( sent.getCount( 0 ), count );
+        for( int k = 0; k < sent.getCount( 0 ) && k < count; ++k )
+        {
+            BOOST_CHECK_EQUAL( string( sent.getStrPOS( 0, k ) ), sents[ i ].tags[ k ] );
+            BOOST_CHECK_EQUAL( sent.getPOS( 0, k ), analyzer->getCodeFromStr( sents[ i ].tags[ k ] ) );
+        }
+    }
+
+    delete analyzer;
+}
+
+
+// a POS code out of the table is taken as an index POS
+BOOST_AUTO_TEST_CASE(icma_index_pos)
+{
+    POSTable table;
+    int code = table.addPOS( "NN" );
+    table.setIndexPOS( code, false );
+    BOOST_CHECK( table.isIndexPOS( code ) == false );
+
+    BOOST_CHECK( table.isIndexPOS( -1 ) );
+    BOOST_CHECK( table.isIndexPOS( table.size() ) );
+    BOOST_CHECK( table.setIndexPOS( table.size(), true ) == false );
+}
+
 
 BOOST_AUTO_TEST_SUITE_END()
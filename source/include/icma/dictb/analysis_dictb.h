@@ -13,7 +13,7 @@
 #include <iostream>
 
 #include "icma/type/cma_ctype.h"
-#include "VTrie.h"
+#include "icma/util/DictTrie.h"
 
 namespace cma
 {
@@ -48,7 +48,7 @@ void parseDictBString(
         vector< DictBString >& out,
         vector<string>& words,
         CharType* types,
-        VTrie* trie,
+        const DictTrie* trie,
         size_t beginIdx,
         size_t endIdx
         );
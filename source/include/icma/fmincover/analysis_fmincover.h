@@ -16,6 +16,7 @@
 #include "icma/type/cma_ctype.h"
 #include "icma/cmacconfig.h"
 #include "VTrie.h"
+#include "icma/util/StrBasedVTrie.h"
 
 
 namespace cma
@@ -29,7 +30,8 @@ void parseFMinCoverString(
         FMinCOutType& out,
         StringVectorType& words,
         CharType* types,
-        VTrie* trie,
+        const DictTrie* trie,
+        VTrieDAG& dag,
         size_t beginIdx,
         size_t endIdx,
         AnalOption& analOption
@@ -14,11 +14,15 @@
 #include "types.h"
 #include "VTrie.h"
 #include "icma/sentence.h"
+#include "icma/util/StrBasedVTrie.h"
 
 #include <algorithm>
+#include <atomic>
 #include <math.h>
+#include <memory>
 #include <set>
 #include <map>
+#include <unordered_map>
 using namespace maxent::me;
 
 /** max word length that combined by probability but not dictionary */
@@ -87,6 +91,244 @@ struct POCTagUnit{
     int previous;
 };
 
+struct SegContextBatch;
+
+/**
+ * \brief Map the context of the POC segmentation to the predicate ids
+ *
+ * The segmentation context is made of the features like
+ * "C-1,0=" + c_1 + "," + c0. Instead of building and hashing these strings
+ * for each character, each character gets a dense id once, and each feature
+ * is found by the ids of its characters in a table built from the
+ * predicates of the model. So the predicates are the same as the ones of
+ * the strings.
+ */
+class SegContextMap{
+public:
+    typedef MaxentModel::pred_id_type pred_id_type;
+
+    /** the most predicates in a context */
+    enum { MAX_CONTEXT_SIZE = 8 };
+
+    /** the id of a character not in any predicate */
+    static const uint32_t UNKNOWN_CHAR = 0xFFFFFFFF;
+
+    /**
+     * Build the tables from the predicates of the model
+     * \param me the POC model
+     */
+    void build(const MaxentModel& me);
+
+    /**
+     * Get the ids of the characters [ beginIdx, endIdx )
+     * \param words the word list
+     * \param charIds to store the id of each character, indexed like \e words
+     */
+    void getCharIds(
+            StringVectorType& words,
+            size_t beginIdx,
+            size_t endIdx,
+            uint32_t* charIds
+            ) const;
+
+    /**
+     * Get the predicate ids of the context of the character \e index, which
+     * is the same as \e get_poc_zh_context_seg() in CMAPOCTagger.cc.
+     * \param charIds the ids of the characters [ index - 2, index + 1 ]
+     * \param types the types of the characters
+     * \param n the number of the characters
+     * \param pids to store the predicate ids, MaxentModel::null_pred_id if
+     * the predicate is not in the model
+     * \return the number of the predicate ids
+     */
+    size_t getContext(
+            const uint32_t* charIds,
+            CharType* types,
+            size_t n,
+            size_t index,
+            CMA_CType* ctype,
+            pred_id_type* pids
+            ) const;
+
+    /**
+     * Append the predicate ids of the context of the character \e index to
+     * the batch, see \e getContext().
+     */
+    void appendContext(
+            const uint32_t* charIds,
+            CharType* types,
+            size_t n,
+            size_t index,
+            CMA_CType* ctype,
+            SegContextBatch& batch
+            ) const;
+
+private:
+    /** the character features C-2, C-1, C0 and C1 */
+    enum { UNIGRAM_NUM = 4 };
+
+    /** the character features C-2,-1, C-1,0, C0,1 and C-1,1 */
+    enum { BIGRAM_NUM = 4 };
+
+    /** Get the id of the character, UNKNOWN_CHAR if not in any predicate */
+    uint32_t findChar(const char* str, size_t len) const;
+
+    /** Get the id of the character, it is added if not exists */
+    uint32_t addChar(const char* str, size_t len);
+
+    pred_id_type getUnigram(int feature, uint32_t c) const
+    {
+        const std::vector< pred_id_type >& preds = unigrams_[ feature ];
+        return c < preds.size() ? preds[ c ] : MaxentModel::null_pred_id;
+    }
+
+    pred_id_type getBigram(int feature, uint32_t c1, uint32_t c2) const;
+
+private:
+    /** the ids of the characters by their bytes, the id of "" is 0 */
+    std::unordered_map< uint64_t, uint32_t > charIds_;
+
+    /** the predicates of the character features by the character id */
+    std::vector< pred_id_type > unigrams_[ UNIGRAM_NUM ];
+
+    /** the predicates of the two-character features by the feature and ids */
+    std::unordered_map< uint64_t, pred_id_type > bigrams_;
+
+    /** the predicate "afEnt" */
+    pred_id_type afEnt_;
+
+    /** the predicates T-1, T0 and T+1 by the character type */
+    pred_id_type typePreds_[ 3 ][ CHAR_TYPE_NUM ];
+};
+
+/**
+ * \brief The segmentation contexts of several characters in flat buffers,
+ * so that the model evaluates them in one pass
+ */
+struct SegContextBatch{
+    /** the predicate ids of all the contexts one after another */
+    std::vector< SegContextMap::pred_id_type > pids;
+
+    /** the context k is [ offsets[k], offsets[k + 1] ) of \e pids */
+    std::vector< size_t > offsets;
+
+    /** the character index of each context */
+    std::vector< size_t > indices;
+
+    /** the scores of the contexts set by the model */
+    std::vector< double > scores;
+
+    SegContextBatch() : offsets( 1, 0 ) {}
+
+    /** the number of the contexts */
+    size_t size() const{
+        return indices.size();
+    }
+
+    /** Remove the contexts, the memory is kept */
+    void clear(){
+        pids.clear();
+        offsets.assign( 1, 0 );
+        indices.clear();
+    }
+};
+
+/**
+ * \brief The reusable buffers of tagging the best POC tags of a range of
+ * characters, each thread tagging a range needs its own one
+ */
+struct POCBestBuffer{
+    /** the ids of the characters in the SegContextMap */
+    std::vector< uint32_t > charIds;
+
+    /** the contexts to evaluate */
+    SegContextBatch batch;
+
+    /** the first character of each unknown type context */
+    std::unordered_map< int, size_t > slotIndices;
+
+    /** the characters taking the tag of another one of the same type context */
+    std::vector< std::pair< size_t, size_t > > copies;
+
+    /** the probabilities of the outcomes of a context */
+    std::vector< double > probs;
+};
+
+/**
+ * \brief The reusable buffers of the one-best POC segmentation
+ */
+struct POCBest{
+    /** the POC tag of each character */
+    std::vector< uint8_t > tags;
+
+    /** the buffers of each thread tagging the characters */
+    std::vector< POCBestBuffer > buffers;
+
+    /** the bounds of the pieces tagged by several threads */
+    std::vector< size_t > bounds;
+
+    /** the character count of each piece */
+    std::vector< size_t > weights;
+};
+
+/**
+ * \brief The reusable buffers of the N-best POC decoder
+ *
+ * Each step of the decoder adds a node for each of its hypotheses, which
+ * points to the node of its previous step. So the tags of a hypothesis are
+ * collected only once at the end, instead of copying the whole history at
+ * every step. The buffers are kept between the calls, once they are large
+ * enough nothing is allocated.
+ */
+struct POCLattice{
+    /** a POC tag of a hypothesis */
+    struct Node{
+        /** the node of the previous step, -1 for the first step */
+        int parent;
+
+        /** the poc code (B/E) */
+        uint8_t pocCode;
+    };
+
+    /** the nodes of all the steps */
+    std::vector< Node > nodes;
+
+    /** the last nodes of the hypotheses, the best first */
+    std::vector< int > heads;
+    std::vector< int > nextHeads;
+
+    /** the scores of the hypotheses */
+    std::vector< double > scores;
+    std::vector< double > nextScores;
+
+    /**
+     * the contexts of the steps, which are evaluated before the decoding,
+     * the character index of the step k is batch.indices[k]
+     */
+    SegContextBatch batch;
+
+    /** the candidates of the next step */
+    std::vector< POCTagUnit > candidates;
+
+    /** the ids of the characters in the SegContextMap */
+    std::vector< uint32_t > charIds;
+
+    /** the tags of the pre-processing */
+    std::vector< uint8_t > initTags;
+
+    /** the tags of a hypothesis */
+    std::vector< uint8_t > tags;
+
+    /** the dictionary words of the sentence, found by the pre-processing */
+    VTrieDAG dag;
+
+    /** Remove the nodes of the last call, the memory is kept */
+    void clear(){
+        nodes.clear();
+        batch.clear();
+    }
+};
+
 /**
  * \brief segment the string
  * segment the string using maxent model
@@ -99,14 +341,27 @@ public:
      * \param cateName the poc category name, the model file(cateName + ".model")
      *     should exists.
      * \param posTrie the VTrie to hold the POS Information
+     * \param weightType how the weights of the model are stored, the
+     * quantized weights take less memory, see MaxentModel::quantize().
      * \param eScore is a double value between 0.5 and 1.0, if the POC tag B has
      * possiblity more the eScore, it will be tagged with E. EScore's default
      * value is 0.7.
      */
-    SegTagger(const string& cateName, VTrie* posTrie, double eScore = 0.7);
+    SegTagger(const string& cateName, VTrie* posTrie,
+            WeightType weightType = WEIGHT_DOUBLE, double eScore = 0.7);
 
     ~SegTagger();
 
+    /**
+     * Search the dictionary words in another trie, like the DATrie built
+     * from the posTrie.
+     * \param dict the trie, which is not destroyed by SegTagger
+     */
+    void setDictTrie( const DictTrie* dict )
+    {
+        trie_ = dict;
+    }
+
     void tag_file(const char* inFile, const char *outFile, 
             string encType = "gb2312");
 
@@ -115,6 +370,8 @@ public:
      * \param words the given words list
      * \param N return N best
      * \param retSize retSize &lt;= N, the size of segment
+     * \param lattice the buffers of the decoder, which could be reused by
+     * the calls of the same thread
      */
     void seg_sentence(
             StringVectorType& words,
@@ -122,7 +379,8 @@ public:
             size_t N,
             size_t retSize,
             PGenericArray<size_t>& segment,
-            VGenericArray< CandidateMeta >& candMeta
+            VGenericArray< CandidateMeta >& candMeta,
+            POCLattice& lattice
             );
 
     /**
@@ -140,10 +398,45 @@ public:
      * only return the best segment result only using Maximum Entropy
      * \param words the word list
      * \param segment to store the segmented words
+     * \param best the buffers of the tagging, which could be reused by the
+     * calls of the same thread
      */
     void seg_sentence_best_with_me(
             StringVectorType& words,
             CharType *types,
+            PGenericArray<size_t>& segment,
+            POCBest& best
+            );
+
+    /**
+     * Tag the POC of the characters [ beginIdx, endIdx ) only using Maximum
+     * Entropy, as \e seg_sentence_best_with_me() does. The context of each
+     * character is taken from the whole word list, so the disjoint ranges
+     * could be tagged by several threads with the same result.
+     * \param words the word list
+     * \param pocRet to store the POC tag of each character
+     * \param buffer the buffers of the tagging, which could be reused by
+     * the calls of the same thread
+     */
+    void tag_poc_best_with_me(
+            StringVectorType& words,
+            CharType* types,
+            size_t beginIdx,
+            size_t endIdx,
+            uint8_t* pocRet,
+            POCBestBuffer& buffer
+            );
+
+    /**
+     * Combine the POC tags of all the characters into the segmented words
+     * \param words the word list
+     * \param pocRet the POC tag of each character
+     * \param segment to store the segmented words
+     */
+    void combine_poc_to_word(
+            StringVectorType& words,
+            CharType* types,
+            uint8_t* pocRet,
             PGenericArray<size_t>& segment
             );
 
@@ -184,17 +477,17 @@ public:
 private:
 
     /**
-     * tag word words[i] under given tag history hist
+     * tag the current word under given tag history, all the histories share
+     * the same probabilities as the context doesn't contain the tags
+     * \param probs the outcome probabilities of the current word
      * \param lastIndex the last index of candidates
      * \param canSize the used size in the candidates
-     * \return a list of (tag, score) pair sorted
+     * \param initScore the score of the tag history
+     * \param candidateNum the index of the tag history
      */
     void tag_word(
-            StringVectorType& words,
-            CharType* types,
-            int index,
+            const double* probs,
             size_t N,
-            uint8_t* tags,
             POCTagUnit* candidates,
             int& lastIndex,
             size_t& canSize,
@@ -202,28 +495,85 @@ private:
             int candidateNum
             );
 
-    /** Find out the words contains at least 4 characters */
+    /**
+     * Whether the best POC tag of the context is E, that is, its probability
+     * is more than 0.5. Only used if \e logitDecision_ is true.
+     * \param diff the logit_diff() of the context
+     * \param probs the buffer of the outcome probabilities
+     */
+    bool isTagE(
+            double diff,
+            const SegContextMap::pred_id_type* context,
+            size_t contextSize,
+            double* probs
+            ) const;
+
+    /**
+     * Append the contexts of the characters [ beginIdx, endIdx ) whose POC
+     * tags are POC_TAG_INIT to the batch
+     * \param charIds the ids of the characters in \e contextMap_
+     * \param tags the POC tag of each character
+     */
+    void gather_contexts(
+            const uint32_t* charIds,
+            CharType* types,
+            size_t n,
+            size_t beginIdx,
+            size_t endIdx,
+            const uint8_t* tags,
+            SegContextBatch& batch
+            ) const;
+
+    /**
+     * Find out the words contains at least 4 characters
+     * \param dag set as the dictionary words of the whole \e words
+     */
     void preProcess(
             StringVectorType& words,
             CharType* types,
-            uint8_t* tags
+            uint8_t* tags,
+            VTrieDAG& dag
             );
 
 private:
     /** The MaxEnt model Object */
     MaxentModel me;
 
+    /** The predicate ids of the segmentation context */
+    SegContextMap contextMap_;
+
+    /** The outcome ids of the POC tags B and E in the model */
+    MaxentModel::outcome_id_type bOutcome_;
+    MaxentModel::outcome_id_type eOutcome_;
+
+    /**
+     * Whether the POC tag could be decided by the sign of the score
+     * difference of B and E, see \e isTagE()
+     */
+    bool logitDecision_;
+
     /** The encoding type */
     CMA_CType *ctype_;
 
-    /** Store the data to the POS tags */
-    VTrie* trie_;
+    /** The posTrie as a DictTrie */
+    VTrieDict trieDict_;
+
+    /** Store the data to the POS tags, trieDict_ if not set by setDictTrie() */
+    const DictTrie* trie_;
 
     /**
      * EScore is a double value between 0.5 and 1.0, if the POC tag B has
      * possiblity more the eScore, it will be tagged with E. <BR>
      */
     double eScore_;
+
+    /**
+     * The best POC tags of the contexts made of the character types and an
+     * ASCII next character, such as the ones of the letters and digits. As
+     * there are only a few such contexts, the model is evaluated once for
+     * each of them. 0 for unknown.
+     */
+    std::unique_ptr< std::atomic< uint8_t >[] > typeContextTags_;
 };
 
 }
@@ -11,13 +11,16 @@
 
 #include "icma/me/CMABasicTrainer.h"
 #include "VTrie.h"
+#include "icma/util/DictTrie.h"
 #include "strutil.h"
 #include "icma/util/CPPStringUtils.h"
 #include "icma/type/cma_ctype.h"
 #include "icma/type/cma_wtype.h"
 #include "icma/util/StringArray.h"
+#include "icma/pos_table.h"
 
 #include <algorithm>
+#include <bitset>
 #include <math.h>
 #include <vector>
 #include <set>
@@ -86,20 +89,132 @@ struct POSTagUnit{
     int previous;
 };
 
+/**
+ * \brief the candidate POS tags of a word, as a bitset of their codes in
+ * the POSTable
+ */
+class POSCodeSet{
+public:
+    /** the codes kept in the bitset are in [ 0, MAX_CODE ) */
+    enum { MAX_CODE = 128 };
+
+    POSCodeSet() : first_( -1 ), size_( 0 ) {}
+
+    /**
+     * Add a tag code
+     * \return false if the code is out of [ 0, MAX_CODE )
+     */
+    bool insert( int code )
+    {
+        if( code < 0 || code >= MAX_CODE )
+            return false;
+        if( codes_.test( code ) )
+            return true;
+        codes_.set( code );
+        if( first_ < 0 )
+            first_ = code;
+        ++size_;
+        return true;
+    }
+
+    bool contains( int code ) const
+    {
+        return code >= 0 && code < MAX_CODE && codes_.test( code );
+    }
+
+    /** the code of the first tag added, -1 if it is empty */
+    int first() const
+    {
+        return first_;
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+    bool empty() const
+    {
+        return size_ == 0;
+    }
+
+private:
+    std::bitset< MAX_CODE > codes_;
+
+    /** the first tag of the word in the dictionary */
+    int first_;
+
+    int size_;
+};
+
+/**
+ * \brief the buffers of the beam search in \e POSTagger::tag_sentence_beam()
+ *
+ * They are kept between the sentences, so once they are large enough no
+ * memory is allocated to decode a sentence.
+ */
+struct POSBeam{
+    /**
+     * \brief a tag sequence in the beam, linked to the one of the previous
+     * word
+     */
+    struct Node{
+        /** the tag code of the last word */
+        int pos;
+
+        /** the index of the previous node in \e nodes, -1 for the root */
+        int previous;
+
+        /** the sum of the log probabilities of the tags */
+        double score;
+    };
+
+    /** all the nodes created for the sentence */
+    vector< Node > nodes;
+
+    /** the indices in \e nodes of the tag sequences of the current word */
+    vector< int > hyps;
+
+    /** the indices in \e nodes of the tag sequences of the next word */
+    vector< int > nextHyps;
+
+    /** the buffer to build a predicate name */
+    string pred;
+
+    /** the ids of the predicates of the current word */
+    vector< MaxentModel::pred_id_type > pids;
+
+    /** the scores of the predicates not depending on the tags */
+    vector< double > wordScores;
+
+    /** the probabilities of the outcomes under a tag history */
+    vector< double > probs;
+
+    /** the allowed tags of the current word, ( outcome id, tag code ) */
+    vector< pair< size_t, int > > cands;
+
+    /** the tag codes of the best sequence, backward */
+    vector< int > path;
+};
+
 /**
  * \brief Tagging the POS Information
  * Tagging the POS using the maxent model.
  */
 class POSTagger{
 public:
-    typedef StringArray POSUnitType;
+    typedef POSCodeSet POSUnitType;
 
     /**
      * Construct the POSTagger with outer VTrie
      * \param model POS model name
+     * \param posTable the table of the tag codes
      * \param loadModel whether loadModel, default is true
+     * \param weightType how the weights of the model are stored, the
+     * quantized weights take less memory, see MaxentModel::quantize().
      */
-    POSTagger(const string& model, VTrie* pTrie, bool loadModel = true );
+    POSTagger(const string& model, VTrie* pTrie, POSTable* posTable,
+            bool loadModel = true, WeightType weightType = WEIGHT_DOUBLE );
 
     /**
      * Construct the POSTagger with inner VTrie (read from dictFile)
@@ -109,6 +224,16 @@ public:
 
     ~POSTagger();
 
+    /**
+     * Search the dictionary words in another trie, like the DATrie built
+     * from the VTrie, while the words are still added into the VTrie.
+     * \param dict the trie, which is not destroyed by POSTagger
+     */
+    void setDictTrie( const DictTrie* dict )
+    {
+        dict_ = dict;
+    }
+
     /**
      * Tag the segmented file with pos (In UTF8 Encoding)
      * \param inFile the input file
@@ -136,7 +261,7 @@ public:
      * \param wordBeginIdx word begin index for the parameter words.
      * \param wordEndIdx word end index ( exclusive ) for the parameter words.
      * \param seqStartIdx the begin index (include) in the parameter segSeq.
-     * \param posRet to hold the result value
+     * \param posRet to hold the tag codes
      */
     void tag_sentence_best(
             StringVectorType& words,
@@ -145,9 +270,79 @@ public:
             size_t wordBeginIdx,
             size_t wordEngIdx,
             size_t seqStartIdx,
-            PGenericArray< const char* >& posRet
+            PGenericArray< int >& posRet
             );
 
+    /**
+     * Tag the words [ beginIdx, endIdx ) in the sentence [ wordBeginIdx,
+     * wordEndIdx ) as \e tag_sentence_best() does, the tags of the two
+     * words before beginIdx are given, so that the pieces of a long sentence
+     * could be tagged by several threads.
+     * \param beginIdx the first word to tag
+     * \param endIdx the word end index ( exclusive ) to tag
+     * \param prevTag_2 the tag of the word ( beginIdx - 2 ), or the boundary
+     *        tag if it is out of the sentence
+     * \param prevTag_1 the tag of the word ( beginIdx - 1 ), or the boundary
+     *        tag if it is out of the sentence
+     * \param posRet to append the tags of the words
+     * \return the index after the last tagged word, less than \e endIdx if
+     *        an empty word is met
+     */
+    size_t tag_words_best(
+            StringVectorType& words,
+            PGenericArray<size_t>& segSeq,
+            CharType* types,
+            size_t wordBeginIdx,
+            size_t wordEngIdx,
+            size_t seqStartIdx,
+            size_t beginIdx,
+            size_t endIdx,
+            int prevTag_2,
+            int prevTag_1,
+            PGenericArray< int >& posRet
+            );
+
+    /**
+     * Tag the words as \e tag_sentence_best() does, but search the tag
+     * sequence of the highest probability over the candidate tags of the
+     * words, keeping the best \e beamWidth sequences after each word
+     * instead of only the best one. The sequences with the same tags of the
+     * last two words are merged as they score the following words the same.
+     * \param beamWidth the number of the tag sequences kept
+     * \param beam the buffers of the search
+     * \param posRet to append the tags of the words
+     */
+    void tag_sentence_beam(
+            StringVectorType& words,
+            PGenericArray<size_t>& segSeq,
+            CharType* types,
+            size_t wordBeginIdx,
+            size_t wordEngIdx,
+            size_t seqStartIdx,
+            size_t beamWidth,
+            POSBeam& beam,
+            PGenericArray< int >& posRet
+            );
+
+    /**
+     * Get the tag code for the boundary of the sentence, which is not a code
+     * of the POSTable
+     */
+    static int getBoundaryTag();
+
+    /**
+     * Map the special tags ( \e defaultPOS and so on ) to the codes of the
+     * POSTable, it should be called once the special tags are set.
+     */
+    void updatePOSCodes();
+
+    /**
+     * Add a candidate tag to a word
+     * \param posSet the candidate tags of the word in \e posVec_
+     * \param pos the tag
+     */
+    void addWordPOS( POSUnitType& posSet, const char* pos );
+
     /**
      * Quick Tag sentence best, no statistical model is used
      * \param words words string vector, values in [ beginIdx, endIdx ) will
@@ -167,7 +362,7 @@ public:
             size_t wordBeginIdx,
             size_t wordEngIdx,
             size_t seqStartIdx,
-            PGenericArray< const char* >& posRet,
+            PGenericArray< int >& posRet,
             bool tagLetterNumber = false
             );
 
@@ -189,6 +384,54 @@ public:
 
 private:
 
+    /**
+     * Get the tag of a word which needs no statistical model, that is, the
+     * tag of its character types, or the only tag of it in the dictionary,
+     * or the default tag.
+     * \param pos set as the tag code if NULL is returned
+     * \return the candidate tags if the word has several ones, or NULL
+     */
+    const POSUnitType* get_fixed_pos(
+            StringVectorType& words,
+            CharType* types,
+            CMA_WType& wtype,
+            size_t index,
+            size_t seqWordBeginIdx,
+            size_t seqWordEndIdx,
+            int& pos
+            );
+
+    /**
+     * Map each outcome of the loaded model to its code in the POSTable, so
+     * that the best candidate tag of a word is chosen without comparing the
+     * strings.
+     */
+    void map_outcome_codes();
+
+    /**
+     * Get the code of a special tag, -1 if it is empty
+     */
+    int getSpecialCode( const string& pos );
+
+    /**
+     * Get the tag string of a code in the context predicates, the boundary
+     * tag included
+     */
+    const char* getTagName( int code ) const;
+
+    /**
+     * Add a tag sequence into \e beam.nextHyps, which keeps the best
+     * \e beamWidth sequences, and only the best one of those ending with the
+     * same two tags.
+     */
+    void insert_beam_node(
+            POSBeam& beam,
+            size_t beamWidth,
+            int pos,
+            int previous,
+            double score
+            );
+
     /**
      * tag word words[i] under given tag history hist
      * \param lastIndex the last index of candidates
@@ -222,6 +465,23 @@ public:
     string datePOS;
 
 private:
+    /** the codes of the special tags, set by \e updatePOSCodes() */
+    int defaultCode_;
+    int numberCode_;
+    int letterCode_;
+    int mixedNumberLetterCode_;
+    int puncCode_;
+    int dateCode_;
+
+    /** the tag code of each outcome of the model, -1 if it is not a tag */
+    vector< int > outcomeCodes_;
+
+    /** the table of the tag codes */
+    POSTable* posTable_;
+
+    /** Whether the POSTable is created by the constructor */
+    bool isInnerPOSTable_;
+
     /**
      * The maxent model
      */
@@ -236,6 +496,12 @@ private:
     /** Whether the trie is created by the constructor */
     bool isInnerTrie_;
 
+    /** The trie_ as a DictTrie */
+    VTrieDict trieDict_;
+
+    /** Search the words, trieDict_ if not set by setDictTrie() */
+    const DictTrie* dict_;
+
     /** the encoding type */
     CMA_CType *ctype_;
 };
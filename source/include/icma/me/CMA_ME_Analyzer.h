@@ -9,13 +9,16 @@
 #define	_CMA_ME_ANALYZER_H
 
 #include "icma/analyzer.h"
+#include "icma/analysis_context.h"
 #include "icma/sentence.h"
 
 #include "icma/cmacconfig.h"
 #include "icma/me/CMA_ME_Knowledge.h"
 #include "icma/type/cma_ctype.h"
+#include "icma/util/ResultCache.h"
 
 #include <string>
+#include <vector>
 
 using namespace std;
 
@@ -42,6 +45,23 @@ typedef struct Option {
 	}
 } AnalOption;
 
+/**
+ * The analysis result of a sentence kept in the result cache, only the byte
+ * spans are kept instead of the morpheme strings.
+ */
+struct CachedSentence
+{
+    std::vector< size_t > spans;
+
+    std::vector< int > pos;
+
+    std::vector< size_t > wordOffsets;
+
+    std::vector< CandidateMeta > candMetas;
+
+    bool incrementedWordOffset;
+};
+
 /**
  * \brief Analyzer for the CMAC
  *
@@ -73,6 +93,19 @@ public:
      */
     virtual void setKnowledge(Knowledge* pKnowledge);
 
+    /**
+     * Get the counters of the result cache.
+     * \param hits set as the number of inputs found in the cache
+     * \param misses set as the number of inputs not found in the cache
+     * \param size set as the number of results in the cache
+     */
+    virtual void getCacheStatistics(size_t& hits, size_t& misses, size_t& size) const;
+
+    /**
+     * Remove all the results in the cache, the counters are kept.
+     */
+    virtual void clearCache();
+
     /**
      * Execute the morphological analysis based on a sentence.
      * \param sentence an instance of \e Sentence
@@ -85,6 +118,37 @@ public:
      */
     virtual int runWithSentence(Sentence& sentence);
 
+    /**
+     * Execute the morphological analysis based on a sentence, all the
+     * temporary data are kept in \e context.
+     * \param sentence an instance of \e Sentence
+     * \param context the scratch buffers owned by the calling thread
+     * \return 0 for fail, 1 for success
+     */
+    virtual int runWithSentence(Sentence& sentence, AnalysisContext& context);
+
+    /**
+     * Tag the POS of the words already segmented, the segmentation model is
+     * not used, but the POS of each word is still looked up in the dictionary.
+     * \param tokens the words of a sentence in order, the empty ones are ignored
+     * \param sentence set as the concatenation of \e tokens, and to save the
+     *      result
+     * \return 0 for fail, 1 for success
+     */
+    virtual int tagTokens(const std::vector<std::string>& tokens, Sentence& sentence);
+
+    /**
+     * Tag the POS of the words already segmented, all the temporary data are
+     * kept in \e context.
+     * \param tokens the words of a sentence in order, the empty ones are ignored
+     * \param sentence set as the concatenation of \e tokens, and to save the
+     *      result
+     * \param context the scratch buffers owned by the calling thread
+     * \return 0 for fail, 1 for success
+     */
+    virtual int tagTokens(const std::vector<std::string>& tokens, Sentence& sentence,
+            AnalysisContext& context);
+
     /**
      * Execute the morphological analysis based on a paragraph string.
      * \param inStr paragraph string
@@ -93,6 +157,43 @@ public:
      */
     virtual const char* runWithString(const char* inStr);
 
+    /**
+     * Execute the morphological analysis based on a paragraph string, all the
+     * temporary data are kept in \e context.
+     * \param inStr paragraph string
+     * \param context the scratch buffers owned by the calling thread
+     * \return 0 for fail, otherwise a non-zero string pointer for the one-best
+     *      result, which is valid until the next use of \e context
+     */
+    virtual const char* runWithString(const char* inStr, AnalysisContext& context);
+
+    /**
+     * Execute the morphological analysis based on the first \e len bytes of
+     * a paragraph string, which needs not be terminated by '\\0'.
+     * \param inStr paragraph string
+     * \param len the byte count of the paragraph
+     * \return 0 for fail, otherwise a non-zero string pointer for the one-best
+     *      result
+     */
+    virtual const char* runWithString(const char* inStr, size_t len);
+
+    /**
+     * Execute the morphological analysis based on the first \e len bytes of
+     * a paragraph string, all the temporary data are kept in \e context.
+     * \param inStr paragraph string, which needs not be terminated by '\\0'
+     * \param len the byte count of the paragraph
+     * \param context the scratch buffers owned by the calling thread
+     * \return 0 for fail, otherwise a non-zero string pointer for the one-best
+     *      result, which is valid until the next use of \e context
+     */
+    virtual const char* runWithString(const char* inStr, size_t len, AnalysisContext& context);
+
+    /**
+     * Analyze the first \e len bytes of \e inStr and keep the tokens of the
+     * one-best result in \e context.
+     */
+    virtual int analyzeTokens(const char* inStr, size_t len, AnalysisContext& context);
+
     /**
      * Execute the morphological analysis based on a file.
      * \param inFileName input file name
@@ -175,7 +276,9 @@ public:
 
     typedef void(CMA_ME_Analyzer::*analysis_t)(
     		AnalOption& analOption,
+            AnalysisContext& context,
             const char*,
+            size_t,
             int,
             Sentence&,
             bool
@@ -187,7 +290,9 @@ private:
      */
     void analysis_mmmodel(
     		AnalOption& analOption,
+            AnalysisContext& context,
             const char* sentence,
+            size_t len,
             int N,
             Sentence& ret,
             bool tagPOS = true
@@ -198,7 +303,9 @@ private:
      */
     void analysis_pure_mmmodel(
     	AnalOption& analOption,
+        AnalysisContext& context,
         const char* sentence,
+        size_t len,
         int N,
         Sentence& ret,
         bool tagPOS = true
@@ -209,7 +316,9 @@ private:
      */
     void analysis_fmm(
     		AnalOption& analOption,
+            AnalysisContext& context,
             const char* sentence,
+            size_t len,
             int N,
             Sentence& ret,
             bool tagPOS = true
@@ -220,7 +329,9 @@ private:
      */
     void analysis_dictb(
     		AnalOption& analOption,
+            AnalysisContext& context,
             const char* sentence,
+            size_t len,
             int N,
             Sentence& ret,
             bool tagPOS = true
@@ -231,7 +342,9 @@ private:
      */
     void analysis_fmincover(
     		AnalOption& analOption,
+            AnalysisContext& context,
             const char* sentence,
+            size_t len,
             int N,
             Sentence& ret,
             bool tagPOS = true
@@ -241,12 +354,62 @@ private:
      */
     void analysis_maxprefix(
     		AnalOption& analOption,
+            AnalysisContext& context,
             const char* sentence,
+            size_t len,
             int N,
             Sentence& ret,
             bool tagPOS = false
             );
 
+    /**
+     * Run the analysis approach on the first \e len bytes of \e sentence,
+     * or copy the result from the cache if it is enabled and the same input
+     * is analyzed with the same options before.
+     * \param split whether a long input could be split and analyzed by
+     *        several threads, see \e OPTION_TYPE_SPLIT_LENGTH
+     */
+    void analyze(
+            AnalysisContext& context,
+            const char* sentence,
+            size_t len,
+            int N,
+            Sentence& ret,
+            bool tagPOS,
+            bool split
+            );
+
+    /**
+     * Get the best segmentation only using Maximum Entropy, the characters
+     * are split at the sentence separators and tagged by
+     * \e context.threadNum_ threads.
+     */
+    void segBestWithME(
+            AnalysisContext& context,
+            StringVectorType& words,
+            CharType* types,
+            PGenericArray<size_t>& segment
+            );
+
+    /**
+     * Tag the POS of the best candidate in \e ret, the words are split at the
+     * sentence separators and tagged by \e context.threadNum_ threads, unless
+     * they are tagged by the beam search.
+     * \param segment the segment sequence of the characters in
+     *        \e context.chars_, for the words in \e ret
+     */
+    void tagBest(
+            AnalysisContext& context,
+            CharType* types,
+            PGenericArray<size_t>& segment,
+            Sentence& ret
+            );
+
+    /**
+     * Pack the options affecting the analysis result into the cache tag.
+     */
+    unsigned long long getCacheTag( int N, bool tagPOS ) const;
+
     /**
      * Simply combine sequential letters, digits and letters+digits together
      * \param sentence the input string
@@ -259,17 +422,29 @@ private:
      */
     void getNGramResultImpl( const vector<vector<OneGramType> >& oneGram, const int n, vector<string>& output );
 
-    void extractCharacter( const char* sentence, StringVectorType& charOut );
+    /**
+     * Split the first \e len bytes of \e sentence into characters, stop
+     * at '\\0' if it comes first.
+     * \return the byte offset of the first character, which is not 0 if
+     *      the BOM is skipped
+     */
+    size_t extractCharacter( const char* sentence, size_t len, StringVectorType& charOut );
 
     /**
      * \param types should be allocated enough memory before invoking
      */
     void setCharType( StringVectorType& charIn, CharType* types );
 
+    /**
+     * Append the byte spans of the words in segSeq[ beginIdx, endIdx ) to
+     * \e ret, and their strings too unless \e ret keeps only the spans.
+     * \param charBase the byte offset of the first character in the input
+     */
     void createStringLexicon(
             StringVectorType& words,
             PGenericArray<size_t>& segSeq,
-            StringVectorType& out,
+            size_t charBase,
+            Sentence& ret,
             size_t beginIdx,
             size_t endIdx
             );
@@ -281,12 +456,76 @@ private:
             PGenericArray<size_t>& out
             );
 
+    /**
+     * Get the character types buffer in \e context with at least \e size
+     * elements.
+     */
+    CharType* getTypeBuffer( AnalysisContext& context, size_t size );
+
+    /**
+     * Get the buffers of the one-best segmentation in \e context.
+     */
+    POCBest& getPOCBest( AnalysisContext& context );
+
+    /**
+     * Get the buffers of the N-best segmentation in \e context.
+     */
+    POCLattice& getPOCLattice( AnalysisContext& context );
+
+    /**
+     * Get the buffers of the beam search of the POS tags in \e context.
+     */
+    POSBeam& getPOSBeam( AnalysisContext& context );
+
+    /**
+     * Get the buffers of the dictionary words in \e context.
+     */
+    VTrieDAG& getTrieDAG( AnalysisContext& context );
+
+    /**
+     * Get the threads in \e context to analyze the pieces of a long input,
+     * with \e context.threadNum_ workers.
+     */
+    WorkStealingPool& getPool( AnalysisContext& context );
+
+    /**
+     * Tag the POS of the words [ wordBeginIdx, wordEndIdx ) of \e ret by
+     * the greedy tagging, or by the beam search if \e OPTION_TYPE_POS_BEAM_WIDTH
+     * is greater than 1.
+     */
+    void tagSentence(
+            AnalysisContext& context,
+            CharType* types,
+            PGenericArray<size_t>& segment,
+            Sentence& ret,
+            size_t wordBeginIdx,
+            size_t wordEndIdx,
+            size_t seqStartIdx
+            );
+
+    /**
+     * Append the one-best result of \e sent to \e out, the morphemes are
+     * copied from \e input by their byte spans.
+     */
+    void printOneBest( Sentence& sent, const char* input, bool printPOS, string& out );
+
+    /**
+     * Analyze one line of \e runWithStream() and append the result to
+     * \e out, \e remains is whether the stream has more content after
+     * the line.
+     */
+    void printStreamLine(
+            const char* line,
+            size_t len,
+            bool remains,
+            bool printPOS,
+            AnalysisContext& context,
+            string& out
+            );
+
 private:
     CMA_ME_Knowledge *knowledge_;
 
-    /** string buffer stores result for \e runWithString */
-    string strBuf_;
-
     /**
      * The CMA_CType object to keep the encoding
      */
@@ -308,6 +547,11 @@ private:
      * options for Analyzer
      */
     AnalOption analOption_;
+
+    /**
+     * the analysis results of the recent inputs
+     */
+    ResultCache< CachedSentence > cache_;
 };
 
 
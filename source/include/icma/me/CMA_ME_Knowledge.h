@@ -13,6 +13,7 @@
 #include "icma/me/CMAPOCTagger.h"
 #include "icma/me/CMAPOSTagger.h"
 #include "icma/pos_table.h"
+#include "icma/util/DATrie.h"
 
 #include "VSynonym.h"
 
@@ -181,6 +182,20 @@ public:
      */
     VTrie* getTrie();
 
+    /**
+     * Get the trie to search the dictionary words, which is selected by
+     * the property "dictionary_trie" in cma.config, "vtrie" (default) for
+     * the VTrie, or "datrie" for the DATrie built from the VTrie
+     *
+     * \return the trie to search the dictionary words
+     */
+    const DictTrie* getDictTrie() const
+    {
+        if( datrie_ )
+            return datrie_;
+        return &trieDict_;
+    }
+
     /**
      * Get POSTable
      */
@@ -232,6 +247,18 @@ private:
 	 */
 	bool loadConfig0(const char *filename, map<string, string>& map, bool required = true);
 
+    /**
+     * Build the DATrie again from the VTrie if it is selected, or destroy it
+     * if not, and let the taggers search the selected trie.
+     */
+    void updateDictTrie();
+
+    /**
+     * Get the storage of the MaxEnt model weights by \e getModelWeightType()
+     * \return the weight type of the MaxEnt models
+     */
+    WeightType getWeightType() const;
+
 private:
     /** tagger for segment */
     SegTagger *segT_;
@@ -245,6 +272,15 @@ private:
     /** The Trie to hold system and */
     VTrie* trie_;
 
+    /** The trie_ as a DictTrie */
+    VTrieDict trieDict_;
+
+    /** The DATrie built from trie_, 0 if the VTrie is searched */
+    DATrie* datrie_;
+
+    /** Whether the DATrie is selected in cma.config */
+    bool useDATrie_;
+
     /** POS Table */
     POSTable* posTable_;
 
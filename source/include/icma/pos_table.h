@@ -11,7 +11,6 @@
 #include <string>
 #include <vector>
 #include <map>
-#include <icma/util/DCTrie.h>
 #include <icma/util/StringArray.h>
 #include <icma/util/VGenericArray.h>
 
@@ -64,20 +63,12 @@ public:
      */
     inline int getCodeFromStr(const std::string& pos)
     {
-        int ret = posMap_.search( pos.c_str() );
-        if( ret > 0 )
-            return ret;
-        else
-            return addPOS( pos );
+        return addPOS( pos );
     }
 
     inline int getCodeFromStr( const char* pos )
     {
-        int ret = posMap_.search( pos );
-        if( ret > 0 )
-            return ret;
-        else
-            return addPOS( pos );
+        return addPOS( pos );
     }
 
     /**
@@ -162,7 +153,7 @@ private:
     PGenericArray<bool> indexedFlags_;
 
     /** the POS tag map type from case-insensitive string to index code */
-    typedef DCTrie POSMap;
+    typedef std::map<std::string, int, Nocase> POSMap;
 
     /** the POS tag map */
     POSMap posMap_;
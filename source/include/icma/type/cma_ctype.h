@@ -8,6 +8,8 @@
 #ifndef CMA_CTYPE_H
 #define CMA_CTYPE_H
 
+#include <atomic>
+#include <memory>
 #include <string>
 
 using std::string;
@@ -41,11 +43,21 @@ public:
         const unsigned char*
         );
 
+    /**
+     * Like \e getByteCount_t, but reads at most \e len bytes and the result
+     * is never greater than \e len.
+     */
+    typedef unsigned int(*getByteCountN_t)(
+        const unsigned char*,
+        size_t len
+        );
+
     friend class CMA_ME_Analyzer;
 
     CMA_CType(
             Knowledge::EncodeType type,
-            getByteCount_t getByteCountFun
+            getByteCount_t getByteCountFun,
+            getByteCountN_t getByteCountNFun
             );
 
     /**
@@ -79,6 +91,14 @@ public:
      */
     unsigned int getByteCount(const char* p) const;
 
+    /**
+     * Get the byte count of the first character in the \e len bytes pointed by \e p.
+     * \param p pointer to the character string, which needs not be terminated by '\\0'
+     * \param len the byte count of the string
+     * \return the count of bytes, 0 if \e len is 0 or \e p points to '\\0'.
+     */
+    unsigned int getByteCount(const char* p, size_t len) const;
+
 
     /**
      * Get the character type.
@@ -90,6 +110,15 @@ public:
     CharType getCharType(const char* p, CharType preType,
             const char* nextP) const;
 
+    /**
+     * Whether an ASCII byte is a character by itself in this encoding,
+     * that is, any encoding except UTF-16.
+     */
+    bool isAsciiSingleByte() const
+    {
+        return asciiSingleByte_;
+    }
+
     /**
      * Get the base Character Type of Character P without any rules
      * \param p the input character
@@ -181,15 +210,41 @@ private:
 	VTrie condKeys_;
 	VGenericArray<CharConditions> condValues_;
 
+	/**
+	 * The types of the single-byte ASCII characters, which only depend on the
+	 * ASCII character itself, the previous type and the next ASCII character.
+	 * Each entry is filled once it is matched, 0 for unknown, otherwise the
+	 * type plus 1. See \e getAsciiTypeSlot().
+	 */
+	std::unique_ptr< std::atomic< unsigned char >[] > asciiTypes_;
+
+	/** whether an ASCII byte is a character by itself in this encoding */
+	bool asciiSingleByte_;
+
 	/** Spaces Set */
 	CharValue spaceArray_[SPACE_ARRAY_SIZE];
 
 	/** Sentence Separator Set */
 	set<CharValue> senSepSet_;
 
+	/**
+	 * Get the entry in \e asciiTypes_ of the character \e p
+	 * \return the entry, or -1 if \e p or \e nextP is not a single-byte
+	 * ASCII character
+	 */
+	int getAsciiTypeSlot( const char* p, CharType preType, const char* nextP ) const;
+
+	/** Get the character type by the conditions, see \e getCharType() */
+	CharType matchCharType( const char* p, CharType preType, const char* nextP ) const;
+
+	/** Mark all the types in \e asciiTypes_ as unknown */
+	void clearAsciiTypes();
+
 public:
 	getByteCount_t getByteCountFun_;
 
+	getByteCountN_t getByteCountNFun_;
+
 };
 
 } // namespace cma
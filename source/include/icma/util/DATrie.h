@@ -0,0 +1,123 @@
+/**
+ * \file DATrie.h
+ * \brief The double-array trie of the dictionary words
+ * \date Oct 17, 2026
+ */
+
+#ifndef DATRIE_H_
+#define DATRIE_H_
+
+#include "icma/util/DictTrie.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace cma
+{
+
+class CMA_CType;
+
+/**
+ * \brief The double-array trie over the characters
+ *
+ * Each character of the dictionary words is mapped to a dense ID, the most
+ * frequent characters with the smallest ones, so a transition is a single
+ * probe of the arrays instead of one per byte as in VTrie. The trie is read
+ * only, it is built from all the words of a VTrie, and rebuilt when words
+ * are added.
+ */
+class DATrie : public DictTrie
+{
+public:
+    DATrie();
+
+    /**
+     * Build the trie from all the words of the VTrie.
+     * \param trie the VTrie
+     * \param ctype the character type to split the words into characters,
+     * which must be the one splitting the texts searched
+     */
+    void build( const VTrie& trie, const CMA_CType* ctype );
+
+    /**
+     * Set the data of an existing word, like when it is disabled.
+     * \param key the word
+     * \param value the new data, which is not 0
+     * \return false if the word is not in the trie
+     */
+    bool update( const char* key, int value );
+
+    virtual int search( const char* key, VTrieNode* node ) const;
+
+    virtual size_t walk( const char* text, size_t len, VTrieNode* node ) const;
+
+    virtual size_t memorySize() const;
+
+    /**
+     * Get the count of the distinct characters
+     */
+    size_t alphabetSize() const
+    {
+        return alphabetSize_;
+    }
+
+private:
+    /** a character of the alphabet in the hash table of charIds_ */
+    struct CharSlot
+    {
+        /** the bytes of the character, 0 if the slot is empty */
+        uint32_t code;
+
+        /** the ID of the character */
+        uint32_t id;
+    };
+
+    /** get the ID of the multi-byte character, 0 if unknown */
+    uint32_t charId( uint32_t code ) const
+    {
+        for( size_t i = ( code * 2654435761U ) >> charShift_; ; i = ( i + 1 ) & charMask_ )
+        {
+            const CharSlot& slot = charIds_[ i ];
+            if( slot.code == code )
+                return slot.id;
+            if( !slot.code )
+                return 0;
+        }
+    }
+
+    /** add the character with the ID into charIds_ */
+    void addChar( uint32_t code, uint32_t id );
+
+    /** find a base for the children labeled by \e labels */
+    int32_t findBase( const std::vector< uint32_t >& labels );
+
+    /** the nodes, the children of node s are base_[ s ] + ID */
+    std::vector< int32_t > base_;
+
+    /** the parent of each node, -1 if the slot is free */
+    std::vector< int32_t > check_;
+
+    /** the data of the word ending at each node, 0 if none */
+    std::vector< int32_t > value_;
+
+    /** the IDs of the single-byte characters */
+    uint32_t byteIds_[ 256 ];
+
+    /** the IDs of the other characters by their bytes */
+    std::vector< CharSlot > charIds_;
+
+    size_t charMask_;
+
+    unsigned int charShift_;
+
+    size_t alphabetSize_;
+
+    const CMA_CType* ctype_;
+
+    /** the slots before it are nearly all used, only used in building */
+    size_t nextCheckPos_;
+};
+
+}
+
+#endif /* DATRIE_H_ */
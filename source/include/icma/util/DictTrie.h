@@ -0,0 +1,85 @@
+/**
+ * \file DictTrie.h
+ * \brief The interface of the tries holding the dictionary words
+ * \date Oct 17, 2026
+ */
+
+#ifndef DICTTRIE_H_
+#define DICTTRIE_H_
+
+#include "VTrie.h"
+
+namespace cma
+{
+
+/**
+ * \brief The lookups of the dictionary words, whatever the trie is
+ *
+ * The words are searched with VTrieNode as in VTrie, that is, the data of a
+ * word is negative if it is disabled, and \e moreLong tells whether longer
+ * words with the same prefix exist. The state of a VTrieNode is only valid
+ * for the trie that set it.
+ */
+class DictTrie
+{
+public:
+    virtual ~DictTrie() {}
+
+    /**
+     * Search the whole key, like VTrie::search().
+     * \param key the key
+     * \param node the node to store the information
+     * \return 0 if not found
+     */
+    virtual int search( const char* key, VTrieNode* node ) const = 0;
+
+    /**
+     * Continue the walk from the node through the text, like
+     * VTrie::commonPrefixSearch(), the node is set as the state at the end
+     * of the walk.
+     * \param text the text, which needs not be terminated by '\\0'
+     * \param len the byte count of the text
+     * \param node the state of the walk, a new VTrieNode starts at the root
+     * \return the byte count walked, the walk fails if it is less than \e len
+     */
+    virtual size_t walk( const char* text, size_t len, VTrieNode* node ) const = 0;
+
+    /**
+     * Get the bytes of the memory held by the trie
+     */
+    virtual size_t memorySize() const = 0;
+};
+
+/**
+ * \brief The VTrie as a DictTrie
+ */
+class VTrieDict : public DictTrie
+{
+public:
+    /**
+     * \param pTrie the VTrie, which is not destroyed by VTrieDict
+     */
+    explicit VTrieDict( VTrie* pTrie ) : trie_( pTrie ) {}
+
+    virtual int search( const char* key, VTrieNode* node ) const
+    {
+        return trie_->search( key, node );
+    }
+
+    virtual size_t walk( const char* text, size_t len, VTrieNode* node ) const
+    {
+        return trie_->commonPrefixSearch( text, len, node, []( size_t, int ) {} );
+    }
+
+    virtual size_t memorySize() const
+    {
+        return trie_->size();
+    }
+
+private:
+    VTrie* trie_;
+};
+
+}
+
+#endif /* DICTTRIE_H_ */
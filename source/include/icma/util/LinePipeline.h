@@ -0,0 +1,98 @@
+/*
+ * \file LinePipeline.h
+ * \brief Process the lines of a stream with several threads in order
+ * \date Oct 17, 2026
+ */
+
+#ifndef LINEPIPELINE_H_
+#define LINEPIPELINE_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <functional>
+
+namespace cma
+{
+
+class LineReader;
+
+/**
+ * \brief A batch of consecutive lines in the stream
+ */
+struct LineBatch
+{
+    /** the sequence number of the batch */
+    size_t seq;
+
+    /** number of lines in this batch, \e lines may be larger */
+    size_t size;
+
+    /** the beginning of the lines (without the line break) */
+    std::vector< const char* > lines;
+
+    /** the byte count of the lines */
+    std::vector< size_t > lengths;
+
+    /**
+     * Whether the stream has more content after each line, that is,
+     * the stream does not reach its end when reading that line.
+     */
+    std::vector< char > remains;
+
+    /** the copies of the lines if they are not kept by the reader */
+    std::vector< std::string > buffers;
+
+    /** the output of the whole batch */
+    std::string output;
+};
+
+/**
+ * \brief Process the lines of a stream with several threads in order
+ *
+ * The pipeline has three stages: the calling thread reads the lines into
+ * batches (only the slices if the file is mapped), the workers process the batches, and the writer thread writes
+ * the output of the batches in the original order.
+ *
+ * At most \e maxBatches batches are in the pipeline at the same time, the
+ * reader waits until the writer releases one, so the memory is bounded even
+ * for a very large input. The batches are reused to avoid allocation.
+ */
+class LinePipeline
+{
+public:
+    /**
+     * Process the lines in \e batch and append the result to \e batch.output.
+     */
+    typedef std::function< void( LineBatch& ) > ProcessFunc;
+
+    /**
+     * Create the pipeline
+     * \param workerNum number of the worker threads, 0 for the number of cores
+     * \param batchLines number of lines in one batch
+     * \param maxBatches the most batches in the pipeline, 0 for
+     *        ( 2 * workerNum + 2 )
+     */
+    LinePipeline(
+            unsigned int workerNum,
+            size_t batchLines = 256,
+            size_t maxBatches = 0
+            );
+
+    /**
+     * Read all the lines of \e in, process them with \e func and write the
+     * output into \e out in the order of input.
+     */
+    void run( LineReader& in, std::ostream& out, const ProcessFunc& func );
+
+private:
+    unsigned int workerNum_;
+
+    size_t batchLines_;
+
+    size_t maxBatches_;
+};
+
+}
+
+#endif /* LINEPIPELINE_H_ */
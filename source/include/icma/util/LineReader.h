@@ -0,0 +1,96 @@
+/*
+ * \file LineReader.h
+ * \brief Read the lines of a file without copying them
+ * \date Oct 17, 2026
+ */
+
+#ifndef LINEREADER_H_
+#define LINEREADER_H_
+
+#include <fstream>
+#include <string>
+
+class MmapFile;
+
+namespace cma
+{
+
+/**
+ * \brief Read the lines of a file without copying them
+ *
+ * A regular file is mapped into memory and each line is returned as a
+ * ( pointer, length ) slice of the mapped region. Other files, like pipes,
+ * are read with a buffered stream instead, then the slice points to an
+ * internal buffer and is only valid until the next call of \e next().
+ *
+ * Each slice is followed by a readable '\\n' or '\\0', so the functions
+ * reading a character ahead won't go out of the slice.
+ *
+ * The lines are split like \e std::getline(): the line break is not included,
+ * and the content after the last line break (maybe empty) is the last line.
+ */
+class LineReader
+{
+public:
+    LineReader();
+
+    ~LineReader();
+
+    /**
+     * Open the file
+     * \param fileName the file name
+     * \return false if the file could not be opened
+     */
+    bool open( const char* fileName );
+
+    /**
+     * Close the file, the slices are no longer valid after that.
+     */
+    void close();
+
+    /**
+     * Whether the file is mapped into memory, if true, the slices are valid
+     * until the reader is closed.
+     */
+    bool isMapped() const
+    {
+        return mmap_ != 0;
+    }
+
+    /**
+     * Read the next line
+     * \param line set as the beginning of the line
+     * \param len set as the byte count of the line
+     * \param remains set as whether the file has more content after the line
+     * \return false if all the lines are read
+     */
+    bool next( const char*& line, size_t& len, bool& remains );
+
+private:
+    /** not copyable */
+    LineReader( const LineReader& );
+    LineReader& operator=( const LineReader& );
+
+private:
+    /** the mapped file, 0 if the file is read with \e in_ */
+    MmapFile* mmap_;
+
+    /** the current position in the mapped region */
+    const char* cur_;
+
+    /** the end of the mapped region */
+    const char* end_;
+
+    /** the stream if the file is not mapped */
+    std::ifstream in_;
+
+    /** the line read from \e in_, or the last line of the mapped region */
+    std::string buf_;
+
+    /** whether more lines can be read */
+    bool hasMore_;
+};
+
+}
+
+#endif /* LINEREADER_H_ */
@@ -0,0 +1,305 @@
+/*
+ * \file ResultCache.h
+ * \brief A bounded LRU cache of the analysis results keyed by the input
+ * \date Oct 17, 2026
+ */
+
+#ifndef RESULTCACHE_H_
+#define RESULTCACHE_H_
+
+#include <atomic>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cma
+{
+
+/**
+ * \brief A bounded LRU cache of the analysis results keyed by the input
+ *
+ * The key is the input bytes together with a \e tag, which packs the
+ * options affecting the result. The entries are spread over several shards
+ * by the hash of the key, each shard has its own lock and LRU list, so the
+ * threads sharing one analyzer seldom wait for each other.
+ *
+ * Each lookup and insertion carries the version of the dictionary, once the
+ * version changes, the stale entries are dropped.
+ *
+ * The values are shared as \e std::shared_ptr, so a hit only copies a
+ * pointer in the lock, and an entry evicted by another thread is still valid
+ * for the thread using it.
+ */
+template< typename ValueT >
+class ResultCache
+{
+public:
+    typedef std::shared_ptr< const ValueT > ValuePtr;
+
+    /**
+     * Create the cache
+     * \param capacity the most entries in the cache, 0 to disable it
+     */
+    explicit ResultCache( size_t capacity = 0 )
+        : capacity_( 0 ), hits_( 0 ), misses_( 0 )
+    {
+        setCapacity( capacity );
+    }
+
+    ~ResultCache()
+    {
+        deleteShards();
+    }
+
+    /**
+     * Set the most entries in the cache, all the entries are removed.
+     * \attention it should not be called during the analysis.
+     */
+    void setCapacity( size_t capacity )
+    {
+        deleteShards();
+        capacity_ = capacity;
+        if( capacity_ == 0 )
+            return;
+
+        // a small cache is not worth splitting
+        size_t shardNum = capacity_ < MIN_SHARD_ENTRIES * MAX_SHARD_NUM ?
+                ( capacity_ + MIN_SHARD_ENTRIES - 1 ) / MIN_SHARD_ENTRIES : MAX_SHARD_NUM;
+        size_t shardCapacity = ( capacity_ + shardNum - 1 ) / shardNum;
+        shards_.reserve( shardNum );
+        for( size_t i = 0; i < shardNum; ++i )
+            shards_.push_back( new Shard( shardCapacity ) );
+    }
+
+    /**
+     * Get the most entries in the cache, 0 if the cache is disabled
+     */
+    size_t capacity() const
+    {
+        return capacity_;
+    }
+
+    /**
+     * Find the value of the key, and mark it as the most recently used.
+     * \param tag the options of the analysis
+     * \param str the input
+     * \param len the byte count of the input
+     * \param version the version of the dictionary
+     * \return the value, null if not found
+     */
+    ValuePtr find( unsigned long long tag, const char* str, size_t len, unsigned long version )
+    {
+        ValuePtr ret;
+        if( capacity_ == 0 )
+            return ret;
+
+        size_t hash = hashKey( tag, str, len );
+        Shard& shard = *shards_[ hash % shards_.size() ];
+        {
+            std::lock_guard< std::mutex > guard( shard.lock );
+            shard.checkVersion( version );
+            typename Shard::Map::iterator itr = shard.map.find( hash );
+            if( itr != shard.map.end() && itr->second->match( tag, str, len ) )
+            {
+                shard.lru.splice( shard.lru.begin(), shard.lru, itr->second );
+                ret = itr->second->value;
+            }
+        }
+
+        if( ret )
+            ++hits_;
+        else
+            ++misses_;
+        return ret;
+    }
+
+    /**
+     * Insert the value of the key as the most recently used, and remove the
+     * least recently used one if the shard is full.
+     * \param tag the options of the analysis
+     * \param str the input
+     * \param len the byte count of the input
+     * \param version the version of the dictionary when the value is created
+     * \param value the value
+     */
+    void insert( unsigned long long tag, const char* str, size_t len,
+            unsigned long version, const ValuePtr& value )
+    {
+        if( capacity_ == 0 )
+            return;
+
+        size_t hash = hashKey( tag, str, len );
+        Shard& shard = *shards_[ hash % shards_.size() ];
+        std::lock_guard< std::mutex > guard( shard.lock );
+        shard.checkVersion( version );
+        // the dictionary is changed during the analysis
+        if( shard.version != version )
+            return;
+
+        typename Shard::Map::iterator itr = shard.map.find( hash );
+        if( itr != shard.map.end() )
+        {
+            // replace the entry of the same hash, which may be another key
+            Entry& entry = *itr->second;
+            entry.tag = tag;
+            entry.key.assign( str, len );
+            entry.value = value;
+            shard.lru.splice( shard.lru.begin(), shard.lru, itr->second );
+            return;
+        }
+
+        if( shard.map.size() >= shard.capacity )
+        {
+            shard.map.erase( shard.lru.back().hash );
+            shard.lru.pop_back();
+        }
+        shard.lru.push_front( Entry() );
+        Entry& entry = shard.lru.front();
+        entry.hash = hash;
+        entry.tag = tag;
+        entry.key.assign( str, len );
+        entry.value = value;
+        shard.map[ hash ] = shard.lru.begin();
+    }
+
+    /**
+     * Remove all the entries and forget the version of the dictionary, like
+     * when another dictionary is used. The counters are kept.
+     */
+    void clear()
+    {
+        for( size_t i = 0; i < shards_.size(); ++i )
+        {
+            std::lock_guard< std::mutex > guard( shards_[ i ]->lock );
+            shards_[ i ]->clear();
+            shards_[ i ]->version = 0;
+        }
+    }
+
+    /**
+     * Get the counters of the cache
+     * \param hits set as the number of lookups found the value
+     * \param misses set as the number of lookups not found the value
+     * \param size set as the number of entries in the cache
+     */
+    void getStatistics( size_t& hits, size_t& misses, size_t& size ) const
+    {
+        hits = hits_;
+        misses = misses_;
+        size = 0;
+        for( size_t i = 0; i < shards_.size(); ++i )
+        {
+            std::lock_guard< std::mutex > guard( shards_[ i ]->lock );
+            size += shards_[ i ]->map.size();
+        }
+    }
+
+    /**
+     * Reset the hit and miss counters
+     */
+    void resetStatistics()
+    {
+        hits_ = 0;
+        misses_ = 0;
+    }
+
+private:
+    /** not copyable */
+    ResultCache( const ResultCache& );
+    ResultCache& operator=( const ResultCache& );
+
+    enum
+    {
+        MAX_SHARD_NUM = 16, ///< the most shards
+        MIN_SHARD_ENTRIES = 64 ///< the least entries in a shard if split
+    };
+
+    struct Entry
+    {
+        size_t hash;
+        unsigned long long tag;
+        std::string key;
+        ValuePtr value;
+
+        bool match( unsigned long long t, const char* str, size_t len ) const
+        {
+            return tag == t && key.size() == len && memcmp( key.data(), str, len ) == 0;
+        }
+    };
+
+    struct Shard
+    {
+        typedef std::list< Entry > List;
+        typedef std::unordered_map< size_t, typename List::iterator > Map;
+
+        mutable std::mutex lock;
+
+        /** the entries, the most recently used first */
+        List lru;
+
+        /** the entries by the hash of their keys */
+        Map map;
+
+        size_t capacity;
+
+        /** the version of the dictionary for the entries */
+        unsigned long version;
+
+        explicit Shard( size_t cap ) : capacity( cap ), version( 0 ) {}
+
+        void clear()
+        {
+            map.clear();
+            lru.clear();
+        }
+
+        void checkVersion( unsigned long ver )
+        {
+            // only the newer version replaces the entries, a lookup started
+            // before the change won't drop the new ones
+            if( ver > version )
+            {
+                clear();
+                version = ver;
+            }
+        }
+    };
+
+    /**
+     * FNV-1a hash of the tag and the input
+     */
+    static size_t hashKey( unsigned long long tag, const char* str, size_t len )
+    {
+        unsigned long long h = 14695981039346656037ULL;
+        for( size_t i = 0; i < sizeof( tag ); ++i, tag >>= 8 )
+            h = ( h ^ ( tag & 0xff ) ) * 1099511628211ULL;
+        const unsigned char* p = (const unsigned char*)str;
+        for( size_t i = 0; i < len; ++i )
+            h = ( h ^ p[ i ] ) * 1099511628211ULL;
+        return (size_t)h;
+    }
+
+    void deleteShards()
+    {
+        for( size_t i = 0; i < shards_.size(); ++i )
+            delete shards_[ i ];
+        shards_.clear();
+    }
+
+private:
+    size_t capacity_;
+
+    std::vector< Shard* > shards_;
+
+    std::atomic< size_t > hits_;
+
+    std::atomic< size_t > misses_;
+};
+
+}
+
+#endif /* RESULTCACHE_H_ */
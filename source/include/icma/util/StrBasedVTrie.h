@@ -9,6 +9,8 @@
 #define STRBASEDVTRIE_H_
 
 #include "VTrie.h"
+#include "icma/cmacconfig.h"
+#include "icma/util/DictTrie.h"
 
 #include <vector>
 #include <string>
@@ -32,9 +34,9 @@ public:
     /**
      * Create an instance
      *
-     * \param pTrie the VTrie
+     * \param pTrie the dictionary trie
      */
-    StrBasedVTrie( VTrie* pTrie );
+    StrBasedVTrie( const DictTrie* pTrie );
 
     /**
      * Reset all the status
@@ -65,9 +67,9 @@ public:
 
 public:
     /**
-     * The VTrie
+     * The dictionary trie
      */
-    VTrie* trie;
+    const DictTrie* trie;
 
     /**
      * The VTrieNode
@@ -80,5 +82,99 @@ public:
     bool completeSearch;
 };
 
+/**
+ * \brief All the dictionary words in a range of characters
+ *
+ * The words starting at each character are found by a single walk of the
+ * trie, so the callers look up the words starting anywhere without searching
+ * the trie again. The lengths are counted in characters.
+ */
+class VTrieDAG
+{
+public:
+    /**
+     * A word found in the dictionary
+     */
+    struct Match
+    {
+        /** the character index after the word */
+        size_t end;
+
+        /** the data of the word in the trie, which is negative if no POS */
+        int value;
+
+        /** whether longer words with the word as their prefix exist */
+        bool moreLong;
+    };
+
+    VTrieDAG();
+
+    /**
+     * Find the words starting at each character in [begin, end), the words
+     * beyond \e end are not found.
+     *
+     * \param trie the dictionary trie
+     * \param chars the characters
+     * \param begin the first character
+     * \param end the character index after the last one
+     */
+    void build( const DictTrie* trie, const StringVectorType& chars, size_t begin, size_t end );
+
+    /**
+     * Remove all the words
+     */
+    void clear();
+
+    /**
+     * Whether the words starting at \e start were found
+     */
+    bool contains( size_t start ) const
+    {
+        return start >= begin_ && start < end_;
+    }
+
+    /**
+     * Get the first word starting at \e start, the words are in the order of
+     * their lengths.
+     * \pre contains( start )
+     */
+    const Match* matchBegin( size_t start ) const
+    {
+        return matches_.data() + offsets_[ start - begin_ ];
+    }
+
+    /**
+     * Get the end of the words starting at \e start
+     * \pre contains( start )
+     */
+    const Match* matchEnd( size_t start ) const
+    {
+        return matches_.data() + offsets_[ start - begin_ + 1 ];
+    }
+
+    /**
+     * Get the character index after the longest prefix starting at \e start
+     * which could be searched by StrBasedVTrie, that is, the characters up to
+     * it are either a word or the prefix of a word. It is \e start if none.
+     * \pre contains( start )
+     */
+    size_t reach( size_t start ) const
+    {
+        return reaches_[ start - begin_ ];
+    }
+
+private:
+    size_t begin_;
+
+    size_t end_;
+
+    /** the words starting at begin_ + i are [offsets_[i], offsets_[i + 1]) */
+    vector<size_t> offsets_;
+
+    vector<Match> matches_;
+
+    vector<size_t> reaches_;
+};
+
 }
 #endif /* STRBASEDVTRIE_H_ */
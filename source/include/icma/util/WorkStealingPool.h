@@ -0,0 +1,120 @@
+/*
+ * \file WorkStealingPool.h
+ * \brief Run a batch of weighted tasks with several threads
+ * \date Oct 17, 2026
+ */
+
+#ifndef WORKSTEALINGPOOL_H_
+#define WORKSTEALINGPOOL_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cma
+{
+
+/**
+ * \brief Run a batch of weighted tasks with several threads
+ *
+ * The tasks are first dealt to the workers by their weights (the heaviest
+ * task goes to the lightest worker), each worker then takes the tasks from
+ * the front of its own queue. When a worker becomes idle, it steals tasks from
+ * the back of the queue with the most remaining weight, so a few long tasks
+ * won't keep the other threads waiting.
+ *
+ * The calling thread works as the worker 0, the other workers are started
+ * by the first run() which needs them, and kept waiting for the next run()
+ * until the pool is destroyed.
+ */
+class WorkStealingPool
+{
+public:
+    /**
+     * The task function, the parameters are the task index and the worker
+     * index in [ 0, threadNum ).
+     */
+    typedef std::function< void( std::size_t, unsigned int ) > TaskFunc;
+
+    /**
+     * Create a pool
+     * \param threadNum number of workers, 0 means the number of cores
+     */
+    WorkStealingPool( unsigned int threadNum = 0 );
+
+    /**
+     * Stop and join the workers
+     */
+    ~WorkStealingPool();
+
+    /**
+     * Get the number of workers
+     */
+    unsigned int getThreadNum() const
+    {
+        return threadNum_;
+    }
+
+    /**
+     * Run the tasks [ 0, weights.size() ), each task is run exactly once.
+     * Return until all the tasks are finished. If a task throws, the
+     * remaining tasks are skipped and the first exception is thrown again
+     * here. The runs of the different threads are done one by one.
+     *
+     * \param weights the weight of each task, like the length of the input
+     * \param func the task function
+     */
+    void run( const std::vector< std::size_t >& weights, const TaskFunc& func );
+
+    /**
+     * Get the number of the hardware threads, at least 1
+     */
+    static unsigned int hardwareThreadNum();
+
+private:
+    /** not copyable */
+    WorkStealingPool( const WorkStealingPool& );
+    WorkStealingPool& operator=( const WorkStealingPool& );
+
+    /** wait for the batches and work on them, for the worker \e self */
+    void workerLoop( unsigned int self );
+
+private:
+    struct Batch;
+
+    unsigned int threadNum_;
+
+    /** the workers 1 to threadNum_ - 1 */
+    std::vector< std::thread > workers_;
+
+    /** the lock of run(), so only one batch runs at a time */
+    std::mutex runLock_;
+
+    /** the lock of the members below */
+    std::mutex lock_;
+
+    /** notified when a batch starts or the pool stops */
+    std::condition_variable wake_;
+
+    /** notified when a worker finishes the batch */
+    std::condition_variable done_;
+
+    /** the running batch */
+    Batch* batch_;
+
+    /** increased by each batch, so the workers know a new one is started */
+    unsigned long generation_;
+
+    /** the number of the workers still on the batch */
+    unsigned int busy_;
+
+    /** whether the workers should exit */
+    bool stop_;
+};
+
+}
+
+#endif /* WORKSTEALINGPOOL_H_ */
@@ -0,0 +1,215 @@
+/*
+ * vi:ts=4:shiftwidth=4:expandtab
+ *
+ * flatmodel.cpp  -  the memory mapped binary format of a compiled MaxentModel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ */
+
+#include "flatmodel.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "mmapfile.h"
+
+namespace maxent {
+namespace me {
+
+namespace {
+
+const char FLAT_MAGIC[16] = "#flat,maxent";
+
+// the version is increased only if the old files could not be read any more
+const unsigned int FLAT_VERSION = 1;
+
+const unsigned int FLAT_BYTE_ORDER = 0x01020304;
+
+// the alignment of each section, a cache line
+const size_t FLAT_ALIGN = 64;
+
+struct FileHeader {
+    char magic[16];
+    unsigned int version;
+    unsigned int byte_order;
+
+    /** the number of the sections in the table after the header */
+    unsigned int section_num;
+    unsigned int reserved;
+
+    unsigned long long file_size;
+};
+
+struct SectionEntry {
+    unsigned long long offset;
+    unsigned long long size;
+};
+
+size_t align(size_t n) {
+    return (n + FLAT_ALIGN - 1) / FLAT_ALIGN * FLAT_ALIGN;
+}
+
+}
+
+FlatNames::FlatNames(const FlatModelReader& reader, FlatSection names,
+        FlatSection offsets) {
+    refer_section(reader, names, m_chars);
+    refer_section(reader, offsets, m_offsets);
+    if (!m_offsets.empty() && m_offsets[m_offsets.size() - 1] != m_chars.size())
+        throw std::runtime_error("broken names in flat model file");
+}
+
+void FlatNames::save(FlatModelWriter& writer, FlatSection names,
+        FlatSection offsets) const {
+    writer.add(names, m_chars.data(), m_chars.size());
+    writer.add(offsets, m_offsets.data(), m_offsets.size());
+}
+
+FlatModelWriter::FlatModelWriter() : m_sections(SECTION_NUM) {}
+
+void FlatModelWriter::save(const std::string& file) const {
+    std::vector<SectionEntry> table(SECTION_NUM);
+    size_t offset = align(sizeof(FileHeader) + sizeof(SectionEntry) * SECTION_NUM);
+    for (size_t i = 0; i < SECTION_NUM; ++i) {
+        table[i].offset = offset;
+        table[i].size = m_sections[i].size();
+        offset = align(offset + m_sections[i].size());
+    }
+
+    FileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FLAT_MAGIC, sizeof(header.magic));
+    header.version = FLAT_VERSION;
+    header.byte_order = FLAT_BYTE_ORDER;
+    header.section_num = SECTION_NUM;
+    header.file_size = offset;
+
+    std::ofstream f(file.c_str(), std::ios::binary);
+    if (!f)
+        throw std::runtime_error("unable to open model file to write");
+
+    f.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    f.write(reinterpret_cast<const char*>(&table[0]), sizeof(SectionEntry) * SECTION_NUM);
+    size_t pos = sizeof(header) + sizeof(SectionEntry) * SECTION_NUM;
+    const std::vector<char> padding(FLAT_ALIGN, 0);
+    for (size_t i = 0; i < SECTION_NUM; ++i) {
+        f.write(&padding[0], table[i].offset - pos);
+        if (!m_sections[i].empty())
+            f.write(&m_sections[i][0], m_sections[i].size());
+        pos = table[i].offset + m_sections[i].size();
+    }
+    f.write(&padding[0], offset - pos);
+
+    if (!f)
+        throw std::runtime_error("fail to write model file");
+}
+
+struct FlatModelReader::Impl {
+    const char* addr;
+    size_t size;
+
+    std::vector<SectionEntry> sections;
+
+#if defined(HAVE_SYSTEM_MMAP)
+    mmap_info mi;
+#else
+    // the whole file, as doubles to be aligned for any section
+    std::vector<double> buf;
+#endif
+
+    void unmap() {
+#if defined(HAVE_SYSTEM_MMAP)
+        if (addr)
+            mmap_close(&mi);
+#endif
+        addr = 0;
+    }
+};
+
+FlatModelReader::FlatModelReader(const std::string& file) : m_impl(new Impl) {
+    m_impl->addr = 0;
+    m_impl->size = 0;
+
+    if (!check(file)) {
+        delete m_impl;
+        throw std::runtime_error("not a flat model file");
+    }
+
+#if defined(HAVE_SYSTEM_MMAP)
+    if (mmap_open(&m_impl->mi, file.c_str(), "r", 0)) {
+        delete m_impl;
+        throw std::runtime_error("fail to map model file");
+    }
+    m_impl->addr = static_cast<const char*>(m_impl->mi.addr);
+    m_impl->size = m_impl->mi.size;
+#else
+    std::ifstream f(file.c_str(), std::ios::binary);
+    f.seekg(0, std::ios::end);
+    m_impl->size = f.tellg();
+    f.seekg(0, std::ios::beg);
+    m_impl->buf.resize(m_impl->size / sizeof(double) + 1);
+    m_impl->addr = reinterpret_cast<const char*>(&m_impl->buf[0]);
+    f.read(reinterpret_cast<char*>(&m_impl->buf[0]), m_impl->size);
+#endif
+
+    const char* error = 0;
+    FileHeader header;
+    if (m_impl->size < sizeof(header)) {
+        error = "broken flat model file";
+    } else {
+        memcpy(&header, m_impl->addr, sizeof(header));
+        if (header.byte_order != FLAT_BYTE_ORDER)
+            error = "flat model file of another byte order";
+        else if (header.version != FLAT_VERSION)
+            error = "unsupported version of flat model file";
+        else if (header.file_size != m_impl->size ||
+                sizeof(header) + sizeof(SectionEntry) * header.section_num > m_impl->size)
+            error = "broken flat model file";
+    }
+
+    if (!error) {
+        // the sections unknown to the file are left empty
+        m_impl->sections.resize(SECTION_NUM);
+        memset(&m_impl->sections[0], 0, sizeof(SectionEntry) * SECTION_NUM);
+        memcpy(&m_impl->sections[0], m_impl->addr + sizeof(header),
+                sizeof(SectionEntry) * std::min<size_t>(header.section_num, SECTION_NUM));
+        for (size_t i = 0; i < SECTION_NUM && !error; ++i) {
+            const SectionEntry& s = m_impl->sections[i];
+            if (s.offset % FLAT_ALIGN != 0 || s.offset > m_impl->size ||
+                    s.size > m_impl->size - s.offset)
+                error = "broken section in flat model file";
+        }
+    }
+
+    if (error) {
+        m_impl->unmap();
+        delete m_impl;
+        throw std::runtime_error(error);
+    }
+}
+
+FlatModelReader::~FlatModelReader() {
+    m_impl->unmap();
+    delete m_impl;
+}
+
+bool FlatModelReader::check(const std::string& file) {
+    std::ifstream f(file.c_str(), std::ios::binary);
+    char magic[sizeof(FLAT_MAGIC)];
+    if (!f.read(magic, sizeof(magic)))
+        return false;
+    return memcmp(magic, FLAT_MAGIC, sizeof(magic)) == 0;
+}
+
+const char* FlatModelReader::section_data(FlatSection section, size_t& bytes) const {
+    const SectionEntry& s = m_impl->sections[section];
+    bytes = s.size;
+    return m_impl->addr + s.offset;
+}
+
+} // namespace me
+} // namespace maxent
@@ -0,0 +1,226 @@
+/*
+ * vi:ts=4:shiftwidth=4:expandtab
+ *
+ * flatmodel.hpp  -  the memory mapped binary format of a compiled MaxentModel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ */
+
+#ifndef FLATMODEL_H
+#define FLATMODEL_H
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <boost/utility.hpp>
+
+namespace maxent {
+namespace me {
+
+/**
+ * The sections of a flat model file, each of them is an array of one type.
+ * The new sections are appended, so the files of an older version are still
+ * readable, an absent section has no element.
+ */
+enum FlatSection {
+    SECTION_OUTCOME_NAMES,    // char, the outcome names one after another
+    SECTION_OUTCOME_OFFSETS,  // unsigned int, n_outcome + 1 offsets of the names
+    SECTION_PRED_NAMES,       // char, the predicate names one after another
+    SECTION_PRED_OFFSETS,     // unsigned int, n_pred + 1 offsets of the names
+    SECTION_PARAMS_INFO,      // FlatParams::Info
+    SECTION_WEIGHTS,          // double, FlatParams::m_weights
+    SECTION_ROW_START,        // unsigned int, FlatParams::m_row_start
+    SECTION_OUTCOMES,         // unsigned int, FlatParams::m_outcomes
+    SECTION_DIFFS,            // double, FlatParams::m_diffs
+    SECTION_HASH_DISPLACES,   // PredHash::Displace
+    SECTION_HASH_SLOTS,       // PredHash::Slot
+    SECTION_HASH_NAMES,       // char, PredHash::m_names
+    SECTION_HASH_FALLBACK,    // unsigned int, the ids of PredHash::m_fallback
+    SECTION_NUM
+};
+
+/**
+ * An array which either owns its elements, or refers to the elements in a
+ * mapped file, so the compiled model is used the same way whether it is
+ * built in memory or mapped from a file.
+ */
+template <typename T>
+class FlatArray : boost::noncopyable {
+    public:
+        FlatArray() : m_data(0), m_size(0) {}
+
+        /**
+         * Take the elements of a vector, which is left empty.
+         */
+        void assign(std::vector<T>& v) {
+            m_own.swap(v);
+            v.clear();
+            m_data = m_own.empty() ? 0 : &m_own[0];
+            m_size = m_own.size();
+        }
+
+        /**
+         * Refer to the elements owned by someone else, such as a mapped file.
+         */
+        void refer(const T* data, size_t size) {
+            std::vector<T>().swap(m_own);
+            m_data = data;
+            m_size = size;
+        }
+
+        const T& operator[](size_t i) const { return m_data[i]; }
+        const T* data() const { return m_data; }
+        size_t size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+
+    private:
+        const T* m_data;
+        size_t m_size;
+        std::vector<T> m_own;
+};
+
+class FlatModelWriter;
+class FlatModelReader;
+
+/**
+ * A list of names stored in one buffer, the name i is
+ * [offsets[i], offsets[i + 1]) of the buffer.
+ */
+class FlatNames : boost::noncopyable {
+    public:
+        FlatNames() {}
+
+        /**
+         * Copy the names, names[i] is the name i.
+         */
+        template <typename Names>
+        explicit FlatNames(const Names& names) {
+            std::vector<char> buf;
+            std::vector<unsigned int> offsets(1, 0);
+            for (size_t i = 0; i < names.size(); ++i) {
+                buf.insert(buf.end(), names[i].begin(), names[i].end());
+                offsets.push_back((unsigned int)buf.size());
+            }
+            m_chars.assign(buf);
+            m_offsets.assign(offsets);
+        }
+
+        /**
+         * Refer to the names in a mapped file.
+         */
+        FlatNames(const FlatModelReader& reader, FlatSection names,
+                FlatSection offsets);
+
+        void save(FlatModelWriter& writer, FlatSection names,
+                FlatSection offsets) const;
+
+        std::string operator[](size_t i) const {
+            return std::string(m_chars.data() + m_offsets[i],
+                    m_offsets[i + 1] - m_offsets[i]);
+        }
+
+        size_t size() const {
+            return m_offsets.empty() ? 0 : m_offsets.size() - 1;
+        }
+
+    private:
+        FlatArray<char> m_chars;
+        FlatArray<unsigned int> m_offsets;
+};
+
+/**
+ * Write a flat model file.
+ *
+ * The file starts with a header of the magic string, the version, a byte
+ * order mark and the (offset, size) of each section, and each section is
+ * aligned to FLAT_ALIGN bytes, so the arrays could be used in place once the
+ * file is mapped. The numbers are in the byte order of the machine writing
+ * the file, a file of another byte order is rejected by the reader.
+ */
+class FlatModelWriter : boost::noncopyable {
+    public:
+        FlatModelWriter();
+
+        /**
+         * Set the elements of a section, the data is copied.
+         */
+        template <typename T>
+        void add(FlatSection section, const T* data, size_t n) {
+            const char* p = reinterpret_cast<const char*>(data);
+            m_sections[section].assign(p, p + n * sizeof(T));
+        }
+
+        /**
+         * Write all the sections into a file.
+         */
+        void save(const std::string& file) const;
+
+    private:
+        std::vector<std::vector<char> > m_sections;
+};
+
+/**
+ * Map a flat model file into memory.
+ *
+ * Nothing is parsed or copied, the loading only validates the header, and
+ * the pages are read in by the OS when they are first used, and shared by
+ * all the processes mapping the same file. The arrays returned by get() are
+ * valid as long as the reader lives.
+ */
+class FlatModelReader : boost::noncopyable {
+    public:
+        /**
+         * Map the file and validate its header.
+         * @throw runtime_error if it is not a valid flat model file.
+         */
+        explicit FlatModelReader(const std::string& file);
+
+        ~FlatModelReader();
+
+        /**
+         * Whether a file is in the flat model format, by its magic string.
+         */
+        static bool check(const std::string& file);
+
+        /**
+         * Get the elements of a section.
+         * @param section The section.
+         * @param n Set as the number of the elements.
+         * @throw runtime_error if the size of the section is not a multiple
+         *        of sizeof(T).
+         */
+        template <typename T>
+        const T* get(FlatSection section, size_t& n) const {
+            size_t bytes = 0;
+            const char* p = section_data(section, bytes);
+            if (bytes % sizeof(T) != 0)
+                throw std::runtime_error("broken section in flat model file");
+            n = bytes / sizeof(T);
+            return reinterpret_cast<const T*>(p);
+        }
+
+    private:
+        const char* section_data(FlatSection section, size_t& bytes) const;
+
+        struct Impl;
+        Impl* m_impl;
+};
+
+/**
+ * Refer the elements of a section by a FlatArray.
+ */
+template <typename T>
+void refer_section(const FlatModelReader& reader, FlatSection section,
+        FlatArray<T>& array) {
+    size_t n = 0;
+    const T* data = reader.get<T>(section, n);
+    array.refer(data, n);
+}
+
+} // namespace me
+} // namespace maxent
+
+#endif /* ifndef FLATMODEL_H */
@@ -0,0 +1,193 @@
+/*
+ * vi:ts=4:shiftwidth=4:expandtab
+ *
+ * flatparams.cpp  -  the flat read-only parameters of a loaded MaxentModel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ */
+
+#include "flatparams.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace maxent {
+namespace me {
+
+FlatParams::FlatParams(const ParamsType& params, const double* theta,
+        size_t n_outcome) : m_n_outcome(n_outcome), m_max_abs_weight(0.0),
+    m_weight_type(WEIGHT_DOUBLE) {
+    size_t n_pred = params.size();
+    size_t n_feature = 0;
+    for (size_t i = 0; i < n_pred; ++i) {
+        n_feature += params[i].size();
+        for (size_t j = 0; j < params[i].size(); ++j)
+            m_max_abs_weight = std::max(m_max_abs_weight,
+                    std::fabs(theta[params[i][j].second]));
+    }
+
+    if (n_outcome == 2) {
+        std::vector<double> diffs(n_pred, 0.0);
+        for (size_t i = 0; i < n_pred; ++i) {
+            const std::vector<pair<size_t, size_t> >& param = params[i];
+            for (size_t j = 0; j < param.size(); ++j) {
+                double w = theta[param[j].second];
+                diffs[i] += param[j].first == 1 ? w : -w;
+            }
+        }
+        m_diffs.assign(diffs);
+    }
+
+    // the dense rows are used if they are not much larger than the features
+    m_dense = n_outcome <= MAX_DENSE_OUTCOMES && n_pred * n_outcome <= 2 * n_feature;
+
+    std::vector<double> weights;
+    if (m_dense) {
+        weights.assign(n_pred * n_outcome, 0.0);
+        for (size_t i = 0; i < n_pred; ++i) {
+            const std::vector<pair<size_t, size_t> >& param = params[i];
+            for (size_t j = 0; j < param.size(); ++j)
+                weights[i * n_outcome + param[j].first] = theta[param[j].second];
+        }
+        m_weights.assign(weights);
+        return;
+    }
+
+    std::vector<unsigned int> row_start;
+    std::vector<unsigned int> outcomes;
+    weights.reserve(n_feature);
+    outcomes.reserve(n_feature);
+    row_start.reserve(n_pred + 1);
+    for (size_t i = 0; i < n_pred; ++i) {
+        row_start.push_back((unsigned int)weights.size());
+        const std::vector<pair<size_t, size_t> >& param = params[i];
+        for (size_t j = 0; j < param.size(); ++j) {
+            outcomes.push_back((unsigned int)param[j].first);
+            weights.push_back(theta[param[j].second]);
+        }
+    }
+    row_start.push_back((unsigned int)weights.size());
+    m_weights.assign(weights);
+    m_row_start.assign(row_start);
+    m_outcomes.assign(outcomes);
+}
+
+FlatParams::FlatParams(const FlatModelReader& reader, size_t n_pred,
+        size_t n_outcome) : m_weight_type(WEIGHT_DOUBLE) {
+    size_t n = 0;
+    const Info* info = reader.get<Info>(SECTION_PARAMS_INFO, n);
+    if (n != 1 || info->n_outcome != n_outcome)
+        throw std::runtime_error("broken parameters in flat model file");
+    m_n_outcome = info->n_outcome;
+    m_dense = info->dense != 0;
+    m_max_abs_weight = info->max_abs_weight;
+
+    refer_section(reader, SECTION_WEIGHTS, m_weights);
+    refer_section(reader, SECTION_ROW_START, m_row_start);
+    refer_section(reader, SECTION_OUTCOMES, m_outcomes);
+    refer_section(reader, SECTION_DIFFS, m_diffs);
+
+    // the rows are read without any check, so the sizes must be right
+    bool valid;
+    if (m_dense) {
+        valid = m_weights.size() == n_pred * m_n_outcome;
+    } else {
+        valid = m_row_start.size() == n_pred + 1 &&
+            m_outcomes.size() == m_weights.size() &&
+            m_row_start[n_pred] == m_weights.size();
+        for (size_t i = 0; valid && i < n_pred; ++i)
+            valid = m_row_start[i] <= m_row_start[i + 1];
+        for (size_t i = 0; valid && i < m_outcomes.size(); ++i)
+            valid = m_outcomes[i] < m_n_outcome;
+    }
+    if (binary())
+        valid = valid && m_diffs.size() == n_pred;
+    if (!valid)
+        throw std::runtime_error("broken parameters in flat model file");
+}
+
+void FlatParams::save(FlatModelWriter& writer) const {
+    if (m_weight_type != WEIGHT_DOUBLE)
+        throw std::runtime_error("unable to save the quantized weights");
+    Info info;
+    memset(&info, 0, sizeof(info));
+    info.n_outcome = (unsigned int)m_n_outcome;
+    info.dense = m_dense;
+    info.max_abs_weight = m_max_abs_weight;
+    writer.add(SECTION_PARAMS_INFO, &info, 1);
+    writer.add(SECTION_WEIGHTS, m_weights.data(), m_weights.size());
+    writer.add(SECTION_ROW_START, m_row_start.data(), m_row_start.size());
+    writer.add(SECTION_OUTCOMES, m_outcomes.data(), m_outcomes.size());
+    writer.add(SECTION_DIFFS, m_diffs.data(), m_diffs.size());
+}
+
+void FlatParams::add_dense(const double* row, double* scores) const {
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 2 <= m_n_outcome; i += 2)
+        _mm_storeu_pd(scores + i,
+                _mm_add_pd(_mm_loadu_pd(scores + i), _mm_loadu_pd(row + i)));
+#endif
+    for (; i < m_n_outcome; ++i)
+        scores[i] += row[i];
+}
+
+void FlatParams::add(size_t pid, double fval, double* scores) const {
+    if (m_weight_type != WEIGHT_DOUBLE) {
+        add_quantized(pid, fval, scores);
+    } else if (m_dense) {
+        const double* row = &m_weights[pid * m_n_outcome];
+        // a missing feature adds 0 * fval, which changes no score as the
+        // values are finite
+        for (size_t i = 0; i < m_n_outcome; ++i)
+            scores[i] += row[i] * fval;
+    } else {
+        for (size_t i = m_row_start[pid]; i < m_row_start[pid + 1]; ++i)
+            scores[m_outcomes[i]] += m_weights[i] * fval;
+    }
+}
+
+void FlatParams::add_quantized(size_t pid, double fval, double* scores) const {
+    if (m_dense) {
+        size_t row = pid * m_n_outcome;
+        for (size_t i = 0; i < m_n_outcome; ++i)
+            scores[i] += m_qweights[row + i] * fval;
+    } else {
+        for (size_t i = m_row_start[pid]; i < m_row_start[pid + 1]; ++i)
+            scores[m_outcomes[i]] += m_qweights[i] * fval;
+    }
+}
+
+void FlatParams::quantize(WeightType type) {
+    if (type == WEIGHT_DOUBLE || m_weight_type != WEIGHT_DOUBLE)
+        return;
+
+    m_qweights.assign(m_weights.data(), m_weights.size(), type);
+    m_qdiffs.assign(m_diffs.data(), m_diffs.size(), type);
+    std::vector<double> none;
+    m_weights.assign(none);
+    m_diffs.assign(none);
+    m_weight_type = type;
+
+    // the bound of the scores is kept for the quantized weights
+    m_max_abs_weight = 0.0;
+    for (size_t i = 0; i < m_qweights.size(); ++i)
+        m_max_abs_weight = std::max(m_max_abs_weight, std::fabs(m_qweights[i]));
+}
+
+size_t FlatParams::weight_bytes() const {
+    if (m_weight_type != WEIGHT_DOUBLE)
+        return m_qweights.bytes() + m_qdiffs.bytes();
+    return (m_weights.size() + m_diffs.size()) * sizeof(double);
+}
+
+} // namespace me
+} // namespace maxent
@@ -0,0 +1,181 @@
+/*
+ * vi:ts=4:shiftwidth=4:expandtab
+ *
+ * flatparams.hpp  -  the flat read-only parameters of a loaded MaxentModel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ */
+
+#ifndef FLATPARAMS_H
+#define FLATPARAMS_H
+
+#include <vector>
+
+#include "meevent.hpp"
+#include "flatmodel.hpp"
+#include "quantarray.hpp"
+
+namespace maxent {
+namespace me {
+
+/**
+ * The parameters of a model compiled for the evaluation.
+ *
+ * ParamsType keeps a vector of (outcome id, feature id) pairs for each
+ * predicate, and the weight of a feature is in another array, so adding the
+ * weights of a predicate reads three places. FlatParams keeps the weights of
+ * all the predicates in one array instead:
+ *
+ * - dense rows: if there are only a few outcomes, each predicate has a row of
+ *   the weights of all the outcomes (0 if the predicate has no such feature),
+ *   so the row could be added to the scores in a vector register.
+ * - CSR rows: otherwise, each predicate has a row of its own (outcome id,
+ *   weight) pairs, the rows are stored one after another.
+ *
+ * The weights are added in the same order as ParamsType, so the scores are
+ * exactly the same.
+ *
+ * For a model of two outcomes, the difference of the two weights of each
+ * predicate is kept as well, so the difference of the two scores is added
+ * up from one weight per predicate.
+ *
+ * The arrays could be saved into a flat model file and used in place once
+ * the file is mapped.
+ *
+ * The weights could be quantized to save the memory, then the doubles are
+ * dropped and the scores are added up from the quantized weights.
+ */
+class FlatParams : boost::noncopyable {
+    public:
+        /**
+         * Compile the parameters.
+         * @param params The parameters of each predicate.
+         * @param theta The weights of the features.
+         * @param n_outcome The number of the outcomes.
+         */
+        FlatParams(const ParamsType& params, const double* theta,
+                size_t n_outcome);
+
+        /**
+         * Refer to the parameters in a mapped file.
+         * @param reader The mapped file.
+         * @param n_pred The number of the predicates to check the rows.
+         * @param n_outcome The number of the outcomes to check the rows.
+         * @throw runtime_error if the sections are broken.
+         */
+        FlatParams(const FlatModelReader& reader, size_t n_pred,
+                size_t n_outcome);
+
+        /**
+         * Add the parameters to a flat model file.
+         */
+        void save(FlatModelWriter& writer) const;
+
+        /**
+         * Add the weights of a predicate to the scores of the outcomes.
+         * @param pid The id of the predicate.
+         * @param scores The scores indexed by the outcome id.
+         */
+        void add(size_t pid, double* scores) const {
+            if (m_weight_type != WEIGHT_DOUBLE)
+                add_quantized(pid, 1.0, scores);
+            else if (m_dense)
+                add_dense(&m_weights[pid * m_n_outcome], scores);
+            else {
+                for (size_t i = m_row_start[pid]; i < m_row_start[pid + 1]; ++i)
+                    scores[m_outcomes[i]] += m_weights[i];
+            }
+        }
+
+        /**
+         * Add the weights of a predicate multiplied by its value.
+         */
+        void add(size_t pid, double fval, double* scores) const;
+
+        /**
+         * Whether the rows are dense.
+         */
+        bool dense() const { return m_dense; }
+
+        /**
+         * Whether the model has two outcomes, so diff() is available.
+         */
+        bool binary() const { return m_n_outcome == 2; }
+
+        /**
+         * Get the weight of the outcome 1 minus the weight of the outcome 0
+         * of a predicate, only for the binary model.
+         */
+        double diff(size_t pid) const {
+            return m_weight_type == WEIGHT_DOUBLE ? m_diffs[pid] : m_qdiffs[pid];
+        }
+
+        /**
+         * Get the largest absolute value of the weights.
+         */
+        double max_abs_weight() const { return m_max_abs_weight; }
+
+        /**
+         * Quantize the weights and drop the doubles, the parameters could
+         * not be saved any more.
+         * @param type The storage of the weights, WEIGHT_DOUBLE does nothing.
+         */
+        void quantize(WeightType type);
+
+        /**
+         * Get how the weights are stored.
+         */
+        WeightType weight_type() const { return m_weight_type; }
+
+        /**
+         * Get the bytes of the weights, including the differences of the
+         * binary model.
+         */
+        size_t weight_bytes() const;
+
+    private:
+        /** the numbers of SECTION_PARAMS_INFO */
+        struct Info {
+            unsigned int n_outcome;
+            unsigned int dense;
+            double max_abs_weight;
+        };
+
+        void add_dense(const double* row, double* scores) const;
+
+        void add_quantized(size_t pid, double fval, double* scores) const;
+
+        /** the most outcomes to use the dense rows */
+        enum { MAX_DENSE_OUTCOMES = 8 };
+
+        size_t m_n_outcome;
+        bool m_dense;
+
+        /** the weights of the rows */
+        FlatArray<double> m_weights;
+
+        /** the CSR rows: the row of pid is [m_row_start[pid], m_row_start[pid + 1]) */
+        FlatArray<unsigned int> m_row_start;
+
+        /** the CSR rows: the outcome id of each weight */
+        FlatArray<unsigned int> m_outcomes;
+
+        /** the weight differences of the binary model by the predicate */
+        FlatArray<double> m_diffs;
+
+        double m_max_abs_weight;
+
+        WeightType m_weight_type;
+
+        /** m_weights and m_diffs if they are quantized */
+        QuantizedArray m_qweights;
+        QuantizedArray m_qdiffs;
+};
+
+} // namespace me
+} // namespace maxent
+
+#endif /* ifndef FLATPARAMS_H */
@@ -88,6 +88,10 @@ void MaxentModel::begin_add_event() {
     m_outcome_map = m_es->outcome_map();
     m_heldout_es.reset(new MEEventSpace(m_pred_map, m_outcome_map));
     m_params.reset(new ParamsType);
+    m_flat.reset();
+    m_pred_hash.reset();
+    m_pred_names.reset();
+    m_mapped.reset();
     m_timer.reset(new boost::timer());
 }
 
@@ -328,7 +332,7 @@ double MaxentModel::build_params2(shared_ptr<ParamsType>& params,
 void MaxentModel::eval_all(const context_type& context,
         std::vector<pair<outcome_type, double> >& outcomes,
         bool sort_result) const {
-    assert(m_params);
+    assert(m_params || m_flat);
 
     //static vector<double> probs; //REMIND remove static here
     vector<double> probs;
@@ -338,12 +342,9 @@ void MaxentModel::eval_all(const context_type& context,
 
     size_t pid;
     for (size_t i = 0; i < context.size(); ++i) {
-        pid = m_pred_map->id(context[i].first);
-        if (pid != m_pred_map->null_id) {
-            std::vector<pair<size_t, size_t> >& param = (*m_params)[pid];
-            float fval = context[i].second;
-            for(size_t j = 0;j < param.size(); ++j)
-                probs[param[j].first] += m_theta[param[j].second] * fval;
+        pid = find_pred(context[i].first);
+        if (pid != me::PredMapType::null_id) {
+            add_pred(pid, context[i].second, &probs[0]);
         } else {
             //#warning how to deal with unseen predicts?
             //m_debug.debug(0,"Predict id %d not found.",i);
@@ -402,12 +403,9 @@ double MaxentModel::eval(const context_type& context,
 
     size_t pid;
     for (size_t i = 0; i < context.size(); ++i) {
-        pid = m_pred_map->id(context[i].first);
-        if (pid != m_pred_map->null_id) {
-            std::vector<pair<size_t, size_t> >& param = (*m_params)[pid];
-            float fval = context[i].second;
-            for(size_t j = 0;j < param.size(); ++j)
-                probs[param[j].first] += m_theta[param[j].second] * fval;
+        pid = find_pred(context[i].first);
+        if (pid != me::PredMapType::null_id) {
+            add_pred(pid, context[i].second, &probs[0]);
         } else {
             //#warning how to deal with unseen predicts?
             //m_debug.debug(0,"Predict id %d not found.",i);
@@ -455,14 +453,95 @@ MaxentModel::outcome_type MaxentModel::predict(const context_type& context) cons
 /**
  * Load a MaxentModel from a file.
  *
+ * The flat model file saved by save_flat() is mapped instead of being read,
+ * see load_flat().
+ *
  * @param model The name of the model to load
  */
 void MaxentModel::load(const string& model) {
+    if (me::FlatModelReader::check(model)) {
+        load_flat(model);
+        return;
+    }
+
     MaxentModelFile f;
     f.load(model);
     m_pred_map = f.pred_map();
     m_outcome_map = f.outcome_map();
     f.params(m_params, m_n_theta, m_theta);
+    m_pred_names.reset();
+    m_mapped.reset();
+    compile_params();
+}
+
+/**
+ * Map a flat model file saved by save_flat().
+ *
+ * The compiled parameters and the predicate hash are used in place, so
+ * nothing is parsed or hashed, and only the outcome names are copied. The
+ * mapped model could be evaluated and saved by save_flat() again, but not
+ * trained or saved by save(), as the original parameters are not kept.
+ *
+ * @param model The name of the model to load
+ */
+void MaxentModel::load_flat(const string& model) {
+    shared_ptr<me::FlatModelReader> mapped(new me::FlatModelReader(model));
+
+    me::FlatNames outcomes(*mapped, me::SECTION_OUTCOME_NAMES, me::SECTION_OUTCOME_OFFSETS);
+    shared_ptr<me::OutcomeMapType> outcome_map(new me::OutcomeMapType);
+    for (size_t i = 0; i < outcomes.size(); ++i)
+        outcome_map->add(outcomes[i]);
+
+    shared_ptr<me::FlatNames> pred_names(new me::FlatNames(*mapped,
+                me::SECTION_PRED_NAMES, me::SECTION_PRED_OFFSETS));
+    shared_ptr<me::FlatParams> flat(new me::FlatParams(*mapped,
+                pred_names->size(), outcome_map->size()));
+    shared_ptr<me::PredHash> pred_hash(new me::PredHash(*mapped, *pred_names));
+
+    m_es.reset();
+    m_heldout_es.reset();
+    m_pred_map.reset();
+    m_params.reset();
+    m_theta.reset();
+    m_n_theta = 0;
+    m_outcome_map = outcome_map;
+    m_mapped = mapped;
+    m_pred_names = pred_names;
+    m_flat = flat;
+    m_pred_hash = pred_hash;
+}
+
+/**
+ * Compile the parameters into the flat layout used by the evaluation, and
+ * the predicates into the perfect hash used by the lookup, it should be
+ * called once the parameters are loaded or trained.
+ */
+void MaxentModel::compile_params() {
+    m_flat.reset(new FlatParams(*m_params, m_theta.get(), m_outcome_map->size()));
+    m_pred_hash.reset(new PredHash(*m_pred_map));
+}
+
+/**
+ * Get the id of a predicate name, or null_id if it is not in the model.
+ */
+size_t MaxentModel::find_pred(const feature_type& pred) const {
+    if (m_pred_hash)
+        return m_pred_hash->id(pred);
+    return m_pred_map->id(pred);
+}
+
+/**
+ * Add the weights of a predicate multiplied by its value to the scores of
+ * the outcomes.
+ */
+void MaxentModel::add_pred(size_t pid, float fval, double* probs) const {
+    if (m_flat) {
+        m_flat->add(pid, fval, probs);
+        return;
+    }
+    std::vector<pair<size_t, size_t> >& param = (*m_params)[pid];
+    for(size_t j = 0;j < param.size(); ++j)
+        probs[param[j].first] += m_theta[param[j].second] * fval;
 }
 
 /**
@@ -473,6 +552,10 @@ void MaxentModel::load(const string& model) {
  * smaller (if compiled with libz) and much faster to load.
  */
 void MaxentModel::save(const string& model, bool binary) const {
+    if (weight_type() != me::WEIGHT_DOUBLE)
+        throw runtime_error("unable to save a quantized model");
+    if (m_mapped)
+        throw runtime_error("a mapped model could only be saved by save_flat()");
     if (!m_params)
         throw runtime_error("no model to save (empty model)");
     MaxentModelFile f;
@@ -482,6 +565,36 @@ void MaxentModel::save(const string& model, bool binary) const {
     f.save(model, binary);
 }
 
+/**
+ * Save a MaxentModel to a flat model file, which is mapped by load() and
+ * used without parsing.
+ *
+ * The file keeps the parameters compiled for the evaluation, aligned so
+ * that they are used in place, so it is larger than the binary file of
+ * save(), and the byte order and the version of the format must match the
+ * machine loading it.
+ *
+ * @param model The name of the model to save.
+ */
+void MaxentModel::save_flat(const string& model) const {
+    if (!m_flat || !m_pred_hash)
+        throw runtime_error("no model to save (empty model)");
+    if (weight_type() != me::WEIGHT_DOUBLE)
+        throw runtime_error("unable to save a quantized model");
+
+    me::FlatModelWriter w;
+    me::FlatNames(*m_outcome_map).save(w, me::SECTION_OUTCOME_NAMES,
+            me::SECTION_OUTCOME_OFFSETS);
+    if (m_pred_names)
+        m_pred_names->save(w, me::SECTION_PRED_NAMES, me::SECTION_PRED_OFFSETS);
+    else
+        me::FlatNames(*m_pred_map).save(w, me::SECTION_PRED_NAMES,
+                me::SECTION_PRED_OFFSETS);
+    m_flat->save(w);
+    m_pred_hash->save(w);
+    w.save(model);
+}
+
 /**
  * Train a ME model using selected training method.
  *
@@ -531,6 +644,7 @@ void MaxentModel::train(size_t iter, const std::string& method,
     t->set_training_data(m_es, m_params, m_n_theta,
             m_theta, gaussian, m_outcome_map->size(), m_heldout_es);
     t->train(iter, tol);
+    compile_params();
 }
 
 // The following functions are wrapper call for the corresponding functions
@@ -571,6 +685,399 @@ void MaxentModel::eval_all(const vector<string>& context,
     eval_all(c, outcomes, sort_result);
 }
 
+const MaxentModel::pred_id_type MaxentModel::null_pred_id = me::PredMapType::null_id;
+
+/**
+ * Get the id of a binary contextual predicate.
+ *
+ * @param pred The name of the contextual predicate.
+ * @return The id of the predicate, or null_pred_id if it is not in the model.
+ */
+MaxentModel::pred_id_type MaxentModel::pred_id(const feature_type& pred) const {
+    assert(m_pred_map || m_pred_hash);
+    return find_pred(pred);
+}
+
+/**
+ * Get the number of the contextual predicates, the ids are in [0, size).
+ */
+size_t MaxentModel::pred_size() const {
+    if (m_pred_names)
+        return m_pred_names->size();
+    assert(m_pred_map);
+    return m_pred_map->size();
+}
+
+/**
+ * Get the name of the contextual predicate of the given id.
+ */
+MaxentModel::feature_type MaxentModel::pred_name(pred_id_type pid) const {
+    if (m_pred_names)
+        return (*m_pred_names)[pid];
+    assert(m_pred_map);
+    return (*m_pred_map)[pid];
+}
+
+/**
+ * Evaluates a context given by the ids of its binary contextual predicates.
+ *
+ * The result is the same as eval_all() with the names of the predicates, as
+ * the value of each binary predicate is 1.0, but no string is hashed.
+ *
+ * @param pids The ids of the contextual predicates, null_pred_id is ignored
+ *        like an unknown predicate name.
+ * @param n The number of the ids.
+ * @param outcomes an array of the outcomes paired with it's probability
+ *        predicted by the model (the conditional distribution).
+ * @param sort_result  Whether or not the returned outcome array is sorted
+ *                     (larger probability first). Default is true.
+ *
+ * \sa eval_ids()
+ */
+void MaxentModel::eval_all(const pred_id_type* pids, size_t n,
+        std::vector<pair<outcome_type, double> >& outcomes,
+        bool sort_result) const {
+    vector<double> probs(outcome_size());
+    eval_ids(pids, n, &probs[0]);
+
+    outcomes.resize(probs.size());
+    for (size_t i = 0;i < outcomes.size(); ++i) {
+        outcomes[i].first = (*m_outcome_map)[i];
+        outcomes[i].second = probs[i];
+    }
+
+    if (sort_result)
+        sort(outcomes.begin(),outcomes.end(), cmp_outcome());
+}
+
+const MaxentModel::outcome_id_type MaxentModel::null_outcome_id = me::OutcomeMapType::null_id;
+
+/**
+ * Get the id of an outcome, so that the result of eval_ids() could be read
+ * without comparing the outcome names.
+ *
+ * @return The id of the outcome, or null_outcome_id if it is not in the model.
+ */
+MaxentModel::outcome_id_type MaxentModel::outcome_id(const outcome_type& outcome) const {
+    assert(m_outcome_map);
+    return m_outcome_map->id(outcome);
+}
+
+/**
+ * Get the number of the outcomes, the ids are in [0, size).
+ */
+size_t MaxentModel::outcome_size() const {
+    assert(m_outcome_map);
+    return m_outcome_map->size();
+}
+
+/**
+ * Get the name of the outcome of the given id.
+ */
+const MaxentModel::outcome_type& MaxentModel::outcome_name(outcome_id_type oid) const {
+    assert(m_outcome_map);
+    return (*m_outcome_map)[oid];
+}
+
+/**
+ * Evaluates a context given by the ids of its binary contextual predicates,
+ * and write the conditional probability of each outcome into a buffer of the
+ * caller, so that nothing is allocated.
+ *
+ * @param pids The ids of the contextual predicates, null_pred_id is ignored
+ *        like an unknown predicate name.
+ * @param n The number of the ids.
+ * @param probs The buffer of outcome_size() elements, probs[oid] is set as
+ *        the probability of the outcome oid, the same as eval_all().
+ *
+ * \sa eval_all()
+ */
+void MaxentModel::eval_ids(const pred_id_type* pids, size_t n, double* probs) const {
+    assert(m_params || m_flat);
+
+    fill(probs, probs + m_outcome_map->size(), 0.0);
+    add_scores(pids, n, probs);
+    normalize_scores(probs);
+}
+
+/**
+ * Add the weights of the binary contextual predicates to the scores of the
+ * outcomes, without resetting the scores first. The scores of the predicates
+ * shared by several contexts could be added once, copied, and completed by
+ * the predicates of each context, then normalize_scores() gives the same
+ * probabilities as eval_ids() if the predicates are added in the same order.
+ *
+ * @param pids The ids of the contextual predicates, null_pred_id is ignored.
+ * @param n The number of the ids.
+ * @param scores The buffer of outcome_size() elements.
+ *
+ * \sa eval_ids()
+ */
+void MaxentModel::add_scores(const pred_id_type* pids, size_t n, double* scores) const {
+    assert(m_params || m_flat);
+
+    for (size_t i = 0; i < n; ++i) {
+        if (pids[i] == null_pred_id)
+            continue;
+        if (m_flat) {
+            m_flat->add(pids[i], scores);
+            continue;
+        }
+        std::vector<pair<size_t, size_t> >& param = (*m_params)[pids[i]];
+        for(size_t j = 0;j < param.size(); ++j)
+            scores[param[j].first] += m_theta[param[j].second];
+    }
+}
+
+/**
+ * Turn the scores added by add_scores() into the conditional probabilities
+ * of the outcomes in place.
+ *
+ * @param scores The buffer of outcome_size() elements.
+ */
+void MaxentModel::normalize_scores(double* scores) const {
+    size_t n_outcome = m_outcome_map->size();
+    double sum = 0.0;
+    for (size_t i = 0; i < n_outcome; ++i) {
+        scores[i] = exp(scores[i]);
+        sum += scores[i];
+    }
+
+    for (size_t i = 0; i < n_outcome; ++i) {
+        scores[i] /= sum;
+    }
+}
+
+/**
+ * Evaluates several contexts given by the ids of their binary contextual
+ * predicates at once, such as the contexts of all the characters of a
+ * sentence.
+ *
+ * The scores of all the contexts are added up first, then exp() is applied
+ * to the whole buffer in one loop and each context is normalized, so the
+ * loops run over a flat buffer instead of one small array per context. The
+ * probabilities are exactly the same as eval_ids() of each context.
+ *
+ * @param pids The ids of the predicates of all the contexts one after
+ *        another, null_pred_id is ignored.
+ * @param offsets The n_context + 1 offsets in pids, the context k is
+ *        [offsets[k], offsets[k + 1]).
+ * @param n_context The number of the contexts.
+ * @param probs The buffer of n_context * outcome_size() elements,
+ *        probs[k * outcome_size() + oid] is set as the probability of the
+ *        outcome oid of the context k.
+ *
+ * \sa eval_ids()
+ */
+void MaxentModel::eval_batch(const pred_id_type* pids, const size_t* offsets,
+        size_t n_context, double* probs) const {
+    assert(m_params || m_flat);
+
+    size_t n_outcome = m_outcome_map->size();
+    size_t n_prob = n_context * n_outcome;
+    fill(probs, probs + n_prob, 0.0);
+
+    for (size_t k = 0; k < n_context; ++k) {
+        double* scores = probs + k * n_outcome;
+        for (size_t i = offsets[k]; i < offsets[k + 1]; ++i) {
+            if (pids[i] == null_pred_id)
+                continue;
+            if (m_flat)
+                m_flat->add(pids[i], scores);
+            else
+                add_pred(pids[i], 1.0f, scores);
+        }
+    }
+
+    for (size_t i = 0; i < n_prob; ++i)
+        probs[i] = exp(probs[i]);
+
+    for (size_t k = 0; k < n_context; ++k) {
+        double* p = probs + k * n_outcome;
+        double sum = 0.0;
+        for (size_t i = 0; i < n_outcome; ++i)
+            sum += p[i];
+        for (size_t i = 0; i < n_outcome; ++i)
+            p[i] /= sum;
+    }
+}
+
+/**
+ * Whether the model has exactly two outcomes, so that logit_diff() and
+ * eval_binary() could be used.
+ */
+bool MaxentModel::is_binary() const {
+    return outcome_size() == 2;
+}
+
+/**
+ * Evaluates a context of a model with two outcomes, return the score of the
+ * outcome 1 minus the score of the outcome 0.
+ *
+ * The probability of the outcome 1 is sigmoid(logit_diff()). Only one
+ * weight is read for each predicate and no exp() is called, so it is the
+ * fastest way to choose the better outcome. The result may differ from the
+ * difference of the two scores of eval_ids() by the rounding of the
+ * additions, which is below 1e-12 for any real model.
+ *
+ * @param pids The ids of the contextual predicates, null_pred_id is ignored.
+ * @param n The number of the ids.
+ * \sa eval_binary()
+ */
+double MaxentModel::logit_diff(const pred_id_type* pids, size_t n) const {
+    assert(is_binary());
+
+    if (m_flat) {
+        double diff = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            if (pids[i] != null_pred_id)
+                diff += m_flat->diff(pids[i]);
+        }
+        return diff;
+    }
+
+    double scores[2] = {0.0, 0.0};
+    for (size_t i = 0; i < n; ++i) {
+        if (pids[i] != null_pred_id)
+            add_pred(pids[i], 1.0f, scores);
+    }
+    return scores[1] - scores[0];
+}
+
+/**
+ * Evaluates several contexts of a model with two outcomes at once, set the
+ * logit_diff() of each of them.
+ *
+ * @param pids The ids of the predicates of all the contexts one after
+ *        another, null_pred_id is ignored.
+ * @param offsets The n_context + 1 offsets in pids, the context k is
+ *        [offsets[k], offsets[k + 1]).
+ * @param n_context The number of the contexts.
+ * @param diffs The buffer of n_context elements to store the results.
+ * \sa eval_batch()
+ */
+void MaxentModel::logit_batch(const pred_id_type* pids, const size_t* offsets,
+        size_t n_context, double* diffs) const {
+    for (size_t k = 0; k < n_context; ++k)
+        diffs[k] = logit_diff(pids + offsets[k], offsets[k + 1] - offsets[k]);
+}
+
+/**
+ * Evaluates a context of a model with two outcomes, return the probability
+ * of the outcome 1.
+ *
+ * @param pids The ids of the contextual predicates, null_pred_id is ignored.
+ * @param n The number of the ids.
+ * @param fast If true, use fast_sigmoid() instead of sigmoid(), whose
+ *        absolute error is below 3e-6.
+ */
+double MaxentModel::eval_binary(const pred_id_type* pids, size_t n,
+        bool fast) const {
+    double diff = logit_diff(pids, n);
+    return fast ? fast_sigmoid(diff) : sigmoid(diff);
+}
+
+/**
+ * Quantize the weights of a loaded model, so that the model takes 4 (float16)
+ * or 8 (int8) times less memory for the weights, and the scores are added up
+ * from the quantized weights, see QuantizedArray for the errors.
+ *
+ * The original parameters are dropped, so the quantized model could only be
+ * evaluated, but not trained or saved.
+ *
+ * @param type The storage of the weights, WEIGHT_DOUBLE does nothing.
+ */
+void MaxentModel::quantize(me::WeightType type) {
+    if (!m_flat)
+        throw runtime_error("unable to quantize an empty model");
+    if (type == me::WEIGHT_DOUBLE || m_flat->weight_type() != me::WEIGHT_DOUBLE)
+        return;
+
+    m_flat->quantize(type);
+    m_es.reset();
+    m_heldout_es.reset();
+    m_params.reset();
+    m_theta.reset();
+    m_n_theta = 0;
+}
+
+/**
+ * Get how the weights are stored.
+ */
+me::WeightType MaxentModel::weight_type() const {
+    return m_flat ? m_flat->weight_type() : me::WEIGHT_DOUBLE;
+}
+
+/**
+ * Get the bytes of the weights used by the evaluation.
+ */
+size_t MaxentModel::weight_bytes() const {
+    return m_flat ? m_flat->weight_bytes() : m_n_theta * sizeof(double);
+}
+
+/**
+ * Get the largest absolute value of the feature weights, so the caller
+ * could bound the scores of a context.
+ */
+double MaxentModel::max_abs_weight() const {
+    if (m_flat)
+        return m_flat->max_abs_weight();
+    double ret = 0.0;
+    for (size_t i = 0; i < m_n_theta; ++i)
+        ret = max(ret, fabs(m_theta[i]));
+    return ret;
+}
+
+/**
+ * The logistic function 1 / (1 + exp(-x)).
+ */
+double MaxentModel::sigmoid(double x) {
+    return 1.0 / (1.0 + exp(-x));
+}
+
+namespace {
+
+// fast_sigmoid() interpolates the table of sigmoid() in
+// [-SIGMOID_RANGE, SIGMOID_RANGE] with the step 1 / SIGMOID_SCALE. The error
+// of the linear interpolation is below step^2 / 8 * max|sigmoid''|, that is
+// (1/64)^2 / 8 * 0.0963 < 3e-6, and the error of clamping the outside values
+// to 0 or 1 is below sigmoid(-16) < 1.2e-7.
+const int SIGMOID_RANGE = 16;
+const int SIGMOID_SCALE = 64;
+const int SIGMOID_TABLE_SIZE = 2 * SIGMOID_RANGE * SIGMOID_SCALE + 1;
+
+struct SigmoidTable {
+    double values[SIGMOID_TABLE_SIZE + 1];
+
+    SigmoidTable() {
+        for (int i = 0; i < SIGMOID_TABLE_SIZE; ++i)
+            values[i] = MaxentModel::sigmoid(
+                    (double)(i - SIGMOID_RANGE * SIGMOID_SCALE) / SIGMOID_SCALE);
+        // so that x == SIGMOID_RANGE could be interpolated
+        values[SIGMOID_TABLE_SIZE] = values[SIGMOID_TABLE_SIZE - 1];
+    }
+};
+
+const SigmoidTable SIGMOID_TABLE;
+
+}
+
+/**
+ * An approximation of sigmoid() by table lookup, whose absolute error is
+ * below 3e-6 for any x.
+ */
+double MaxentModel::fast_sigmoid(double x) {
+    if (!(x > -SIGMOID_RANGE))
+        return x < 0 ? 0.0 : 0.5; // -inf or NaN
+    if (x >= SIGMOID_RANGE)
+        return 1.0;
+    double pos = (x + SIGMOID_RANGE) * SIGMOID_SCALE;
+    int i = (int)pos;
+    double frac = pos - i;
+    return SIGMOID_TABLE.values[i] +
+        (SIGMOID_TABLE.values[i + 1] - SIGMOID_TABLE.values[i]) * frac;
+}
+
 /**
  * Evaluates a context, return the conditional probability p(y|x).
  *
@@ -618,7 +1125,14 @@ MaxentModel::outcome_type MaxentModel::predict(const vector<string>& context) co
 
 // for python __str__() binding
 const char* MaxentModel::__str__() const {
-    if (!m_params)
+    if (!m_params && m_flat) {
+        static char buf[300];
+        sprintf(buf, 
+"Conditional Maximum Entropy Model (C++ version) [%s]\n"
+"Number of context predicates  : %zd\n"
+"Number of outcome             : %zd" ,  m_mapped ? "mapped" : "quantized", pred_size(), outcome_size());
+        return buf;
+    } else if (!m_params)
         return "Conditional Maximum Entropy Model (C++ version) [empty]";
     else {
         size_t n = 0;
@@ -40,6 +40,9 @@
 
 #include "itemmap.hpp"
 #include "meevent.hpp"
+#include "flatparams.hpp"
+#include "predhash.hpp"
+#include "flatmodel.hpp"
 
 namespace boost {
     class timer;
@@ -86,6 +89,8 @@ class MaxentModel /*: TODO: we need copyable? boost::noncopyable*/  {
 
     void save(const string& model, bool binary = false) const;
 
+    void save_flat(const string& model) const;
+
     double eval(const context_type& context, const outcome_type& outcome) const;
 
     void eval_all(const context_type& context,
@@ -122,6 +127,66 @@ class MaxentModel /*: TODO: we need copyable? boost::noncopyable*/  {
 
     outcome_type predict(const vector<string>& context) const;
 
+    // functions for the callers which map the binary contextual predicates
+    // to their ids once, and evaluate the ids without any string work
+    typedef me::PredMapType::id_type pred_id_type;
+
+    static const pred_id_type null_pred_id;
+
+    pred_id_type pred_id(const feature_type& pred) const;
+
+    size_t pred_size() const;
+
+    feature_type pred_name(pred_id_type pid) const;
+
+    void eval_all(const pred_id_type* pids, size_t n,
+            std::vector<pair<outcome_type, double> >& outcomes,
+            bool sort_result = true) const;
+
+    typedef me::OutcomeMapType::id_type outcome_id_type;
+
+    static const outcome_id_type null_outcome_id;
+
+    outcome_id_type outcome_id(const outcome_type& outcome) const;
+
+    size_t outcome_size() const;
+
+    const outcome_type& outcome_name(outcome_id_type oid) const;
+
+    void eval_ids(const pred_id_type* pids, size_t n, double* probs) const;
+
+    void add_scores(const pred_id_type* pids, size_t n, double* scores) const;
+
+    void normalize_scores(double* scores) const;
+
+    void eval_batch(const pred_id_type* pids, const size_t* offsets,
+            size_t n_context, double* probs) const;
+
+    // functions for the models of two outcomes, which only need the
+    // difference of the two scores
+    bool is_binary() const;
+
+    double logit_diff(const pred_id_type* pids, size_t n) const;
+
+    void logit_batch(const pred_id_type* pids, const size_t* offsets,
+            size_t n_context, double* diffs) const;
+
+    double eval_binary(const pred_id_type* pids, size_t n,
+            bool fast = false) const;
+
+    double max_abs_weight() const;
+
+    static double sigmoid(double x);
+
+    static double fast_sigmoid(double x);
+
+    // functions to store the weights of a loaded model in fewer bits
+    void quantize(me::WeightType type);
+
+    me::WeightType weight_type() const;
+
+    size_t weight_bytes() const;
+
     /**
      * Add a set of events indicated by range [begin, end).
      * the value type of Iterator must be pair<context_type, outcome_type>
@@ -157,6 +222,14 @@ class MaxentModel /*: TODO: we need copyable? boost::noncopyable*/  {
     // end py binding }}}
 
     private:
+    void compile_params();
+
+    void load_flat(const string& model);
+
+    void add_pred(size_t pid, float fval, double* probs) const;
+
+    size_t find_pred(const feature_type& pred) const;
+
     double build_params(shared_ptr<me::ParamsType>& params, 
             size_t& n_theta) const;
     double build_params2(shared_ptr<me::ParamsType>& params, 
@@ -207,6 +280,10 @@ class MaxentModel /*: TODO: we need copyable? boost::noncopyable*/  {
     shared_ptr<me::OutcomeMapType> m_outcome_map;
     shared_ptr<me::ParamsType> m_params;
     shared_array<double> m_theta; // feature weights
+    shared_ptr<me::FlatModelReader> m_mapped; // the mapped flat model file
+    shared_ptr<me::FlatNames> m_pred_names; // m_pred_map of a mapped model
+    shared_ptr<me::FlatParams> m_flat; // m_params and m_theta for evaluation
+    shared_ptr<me::PredHash> m_pred_hash; // m_pred_map for lookup
 
     shared_ptr<boost::timer> m_timer;
 
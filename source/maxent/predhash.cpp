@@ -0,0 +1,221 @@
+/*
+ * vi:ts=4:shiftwidth=4:expandtab
+ *
+ * predhash.cpp  -  the minimal perfect hash of the predicates of a loaded
+ *                  MaxentModel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ */
+
+#include "predhash.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace maxent {
+namespace me {
+
+namespace {
+
+inline unsigned long long mix(unsigned long long x) {
+    // the finalizer of splitmix64
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+struct BiggerBucket {
+    const std::vector<std::vector<size_t> >& m_buckets;
+
+    explicit BiggerBucket(const std::vector<std::vector<size_t> >& buckets)
+        : m_buckets(buckets) {}
+
+    bool operator()(size_t lhs, size_t rhs) const {
+        return m_buckets[lhs].size() > m_buckets[rhs].size();
+    }
+};
+
+}
+
+PredHash::PredHash(const PredMapType& preds) {
+    size_t n = preds.size();
+    m_n_slot = n;
+    m_n_bucket = (n + BUCKET_KEYS - 1) / BUCKET_KEYS;
+    Slot empty;
+    memset(&empty, 0, sizeof(empty));
+    empty.pid = EMPTY_SLOT;
+    std::vector<Slot> slots(n, empty);
+    std::vector<Displace> displaces(m_n_bucket);
+    std::vector<char> names;
+
+    std::vector<unsigned long long> hashes(n);
+    std::vector<std::vector<size_t> > buckets(m_n_bucket);
+    for (size_t i = 0; i < n; ++i) {
+        hashes[i] = hash(preds[i].data(), preds[i].size());
+        buckets[bucket(hashes[i])].push_back(i);
+    }
+
+    // the biggest buckets first, while most of the slots are free
+    std::vector<size_t> order(buckets.size());
+    for (size_t b = 0; b < buckets.size(); ++b)
+        order[b] = b;
+    std::stable_sort(order.begin(), order.end(), BiggerBucket(buckets));
+
+    std::vector<bool> taken(n, false);
+    std::vector<size_t> positions;
+    for (size_t i = 0; i < order.size(); ++i) {
+        const std::vector<size_t>& keys = buckets[order[i]];
+        Displace& d = displaces[order[i]];
+        d.d0 = d.d1 = 0;
+        if (keys.empty())
+            break;
+
+        if (keys.size() == 1) {
+            // any free slot could be reached by the second displacement
+            size_t first = slot(hashes[keys[0]], d);
+            size_t pos = first;
+            while (taken[pos])
+                pos = pos + 1 < n ? pos + 1 : 0;
+            d.d1 = (unsigned int)(pos >= first ? pos - first : pos + n - first);
+            positions.assign(1, pos);
+        } else {
+            bool placed = false;
+            for (; d.d0 < MAX_DISPLACE_TRIES && !placed; ++d.d0) {
+                positions.clear();
+                placed = true;
+                for (size_t j = 0; j < keys.size() && placed; ++j) {
+                    size_t pos = slot(hashes[keys[j]], d);
+                    placed = !taken[pos] &&
+                        std::find(positions.begin(), positions.end(), pos) == positions.end();
+                    positions.push_back(pos);
+                }
+            }
+            if (!placed) {
+                d.d0 = d.d1 = 0;
+                for (size_t j = 0; j < keys.size(); ++j)
+                    m_fallback[preds[keys[j]]] = keys[j];
+                continue;
+            }
+            --d.d0;
+        }
+
+        for (size_t j = 0; j < keys.size(); ++j) {
+            size_t pid = keys[j];
+            const string& name = preds[pid];
+            Slot& slot = slots[positions[j]];
+            taken[positions[j]] = true;
+            slot.fingerprint = (unsigned int)hashes[pid];
+            slot.pid = (unsigned int)pid;
+            slot.length = (unsigned int)name.size();
+            if (name.size() <= SHORT_NAME_LEN) {
+                memcpy(slot.name, name.data(), name.size());
+            } else {
+                slot.offset = (unsigned int)names.size();
+                names.insert(names.end(), name.begin(), name.end());
+            }
+        }
+    }
+
+    m_displaces.assign(displaces);
+    m_slots.assign(slots);
+    m_names.assign(names);
+}
+
+PredHash::PredHash(const FlatModelReader& reader, const FlatNames& preds) {
+    m_n_slot = preds.size();
+    m_n_bucket = (m_n_slot + BUCKET_KEYS - 1) / BUCKET_KEYS;
+    refer_section(reader, SECTION_HASH_DISPLACES, m_displaces);
+    refer_section(reader, SECTION_HASH_SLOTS, m_slots);
+    refer_section(reader, SECTION_HASH_NAMES, m_names);
+    // the slots are checked by the lookup, as reading them all here would
+    // page in the whole table
+    if (m_displaces.size() != m_n_bucket || m_slots.size() != m_n_slot)
+        throw std::runtime_error("broken predicate hash in flat model file");
+
+    size_t n = 0;
+    const unsigned int* fallback = reader.get<unsigned int>(SECTION_HASH_FALLBACK, n);
+    for (size_t i = 0; i < n; ++i) {
+        if (fallback[i] >= m_n_slot)
+            throw std::runtime_error("broken predicate hash in flat model file");
+        m_fallback[preds[fallback[i]]] = fallback[i];
+    }
+}
+
+void PredHash::save(FlatModelWriter& writer) const {
+    writer.add(SECTION_HASH_DISPLACES, m_displaces.data(), m_displaces.size());
+    writer.add(SECTION_HASH_SLOTS, m_slots.data(), m_slots.size());
+    writer.add(SECTION_HASH_NAMES, m_names.data(), m_names.size());
+
+    std::vector<unsigned int> fallback;
+    for (std::unordered_map<std::string, size_t>::const_iterator it = m_fallback.begin();
+            it != m_fallback.end(); ++it)
+        fallback.push_back((unsigned int)it->second);
+    std::sort(fallback.begin(), fallback.end());
+    writer.add(SECTION_HASH_FALLBACK, fallback.empty() ? 0 : &fallback[0], fallback.size());
+}
+
+size_t PredHash::id(const char* str, size_t len) const {
+    if (m_n_slot == 0)
+        return PredMapType::null_id;
+
+    unsigned long long h = hash(str, len);
+    const Slot& s = m_slots[slot(h, m_displaces[bucket(h)])];
+    if (s.fingerprint == (unsigned int)h && s.pid < m_n_slot && match(s, str, len))
+        return s.pid;
+    return fallback_id(str, len);
+}
+
+size_t PredHash::fallback_id(const char* str, size_t len) const {
+    if (m_fallback.empty())
+        return PredMapType::null_id;
+    std::unordered_map<std::string, size_t>::const_iterator it =
+        m_fallback.find(std::string(str, len));
+    return it == m_fallback.end() ? PredMapType::null_id : it->second;
+}
+
+unsigned long long PredHash::hash(const char* str, size_t len) {
+    // 8 bytes at a time, the tail is packed into one word
+    unsigned long long h = 0x9e3779b97f4a7c15ULL ^ len;
+    unsigned long long word;
+    for (; len >= 8; str += 8, len -= 8) {
+        memcpy(&word, str, 8);
+        h = mix(h ^ word);
+    }
+    word = 0;
+    memcpy(&word, str, len);
+    return mix(h ^ word);
+}
+
+size_t PredHash::bucket(unsigned long long h) const {
+    // the upper bits of the product instead of the modulo
+    return (size_t)(((h >> 32) * m_n_bucket) >> 32);
+}
+
+size_t PredHash::slot(unsigned long long h, const Displace& d) const {
+    // the slot is f1 + d0 * f2 + d1, where f1 and f2 are another hash of the
+    // key, so the keys of a bucket are moved together by d0, and one key is
+    // moved to any slot by d1
+    unsigned long long g = mix(h);
+    unsigned int f1 = (unsigned int)g;
+    unsigned int f2 = (unsigned int)(g >> 32) | 1;
+    unsigned int x = f1 + d.d0 * f2;
+    size_t n = m_n_slot;
+    size_t pos = (size_t)(((unsigned long long)x * n) >> 32) + d.d1;
+    return pos < n ? pos : pos - n;
+}
+
+bool PredHash::match(const Slot& slot, const char* str, size_t len) const {
+    if (slot.length != len)
+        return false;
+    if (len > SHORT_NAME_LEN &&
+            (len > m_names.size() || slot.offset > m_names.size() - len))
+        return false;
+    const char* name = len <= SHORT_NAME_LEN ? slot.name : m_names.data() + slot.offset;
+    return memcmp(name, str, len) == 0;
+}
+
+} // namespace me
+} // namespace maxent
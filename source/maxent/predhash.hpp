@@ -0,0 +1,149 @@
+/*
+ * vi:ts=4:shiftwidth=4:expandtab
+ *
+ * predhash.hpp  -  the minimal perfect hash of the predicates of a loaded
+ *                  MaxentModel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ */
+
+#ifndef PREDHASH_H
+#define PREDHASH_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "meevent.hpp"
+#include "flatmodel.hpp"
+
+namespace maxent {
+namespace me {
+
+/**
+ * The predicate names of a model compiled for the lookup.
+ *
+ * PredMapType finds a name in a hash_map of strings, which chases the
+ * pointers of the bucket, the node and the string. As the predicates are
+ * fixed once the model is loaded, PredHash builds a minimal perfect hash
+ * over them instead, in the way of CHD (hash, displace and compress): the
+ * keys are hashed into small buckets, and each bucket gets a displacement
+ * which moves all of its keys to the free slots, the biggest buckets first.
+ * There are exactly as many slots as the keys, and a lookup reads the
+ * displacement of its bucket and then one slot, without any branch or
+ * probing. The keys that could not be placed, if any, are kept in a small
+ * hash map.
+ *
+ * Each slot has the id and a 32 bit fingerprint of its predicate, most of
+ * the unknown names are rejected by the fingerprint, and the others by
+ * comparing the name. A short name is kept in the slot itself, so a lookup
+ * reads one slot of 32 bytes after the displacements, the longer names are
+ * stored in one contiguous buffer.
+ *
+ * The tables could be saved into a flat model file and used in place once
+ * the file is mapped.
+ */
+class PredHash : boost::noncopyable {
+    public:
+        /**
+         * Build the hash of the predicates.
+         * @param preds The predicates, the id of preds[i] is i.
+         */
+        explicit PredHash(const PredMapType& preds);
+
+        /**
+         * Refer to the hash in a mapped file.
+         * @param reader The mapped file.
+         * @param preds The predicates in the file, to check the tables and
+         *        to find the keys could not be placed.
+         * @throw runtime_error if the sections are broken.
+         */
+        PredHash(const FlatModelReader& reader, const FlatNames& preds);
+
+        /**
+         * Add the hash to a flat model file.
+         */
+        void save(FlatModelWriter& writer) const;
+
+        /**
+         * Get the id of a predicate.
+         * @return The id, or PredMapType::null_id if it is not a predicate.
+         */
+        size_t id(const char* str, size_t len) const;
+
+        size_t id(const std::string& pred) const {
+            return id(pred.data(), pred.size());
+        }
+
+        /**
+         * Get the number of the predicates.
+         */
+        size_t size() const { return m_n_slot; }
+
+    private:
+        /** the longest name kept in the slot */
+        enum { SHORT_NAME_LEN = 16 };
+
+        /** the average keys of a bucket */
+        enum { BUCKET_KEYS = 4 };
+
+        /** the first displacements to try for a bucket of several keys */
+        enum { MAX_DISPLACE_TRIES = 1 << 20 };
+
+        /** the pid of a slot not used, which is not less than m_n_slot */
+        static const unsigned int EMPTY_SLOT = ~0u;
+
+        struct Slot {
+            unsigned int fingerprint;
+            unsigned int pid;
+
+            /** the length of the name */
+            unsigned int length;
+
+            /** the offset of a long name in m_names */
+            unsigned int offset;
+
+            char name[SHORT_NAME_LEN];
+        };
+
+        /** the displacement of a bucket */
+        struct Displace {
+            unsigned int d0;
+            unsigned int d1;
+        };
+
+        static unsigned long long hash(const char* str, size_t len);
+
+        /** Get the bucket of the hash */
+        size_t bucket(unsigned long long h) const;
+
+        /** Get the slot of the hash displaced by d */
+        size_t slot(unsigned long long h, const Displace& d) const;
+
+        bool match(const Slot& slot, const char* str, size_t len) const;
+
+        size_t fallback_id(const char* str, size_t len) const;
+
+        size_t m_n_bucket;
+        size_t m_n_slot;
+
+        /** the displacement of each bucket */
+        FlatArray<Displace> m_displaces;
+
+        /** the predicate of each slot */
+        FlatArray<Slot> m_slots;
+
+        /** the long names of the predicates one after another */
+        FlatArray<char> m_names;
+
+        /** the keys could not be placed */
+        std::unordered_map<std::string, size_t> m_fallback;
+};
+
+} // namespace me
+} // namespace maxent
+
+#endif /* ifndef PREDHASH_H */
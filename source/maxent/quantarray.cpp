@@ -0,0 +1,81 @@
+/*
+ * vi:ts=4:shiftwidth=4:expandtab
+ *
+ * quantarray.cpp  -  the quantized weights of a loaded MaxentModel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ */
+
+#include "quantarray.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace maxent {
+namespace me {
+
+void QuantizedArray::assign(const double* values, size_t n, WeightType type) {
+    m_type = type;
+    m_size = n;
+    m_half.clear();
+    m_int8.clear();
+    m_scales.clear();
+
+    if (type == WEIGHT_FLOAT16) {
+        m_half.resize(n);
+        for (size_t i = 0; i < n; ++i)
+            m_half[i] = float_to_half((float)values[i]);
+        return;
+    }
+
+    m_int8.resize(n);
+    m_scales.resize((n + BLOCK_SIZE - 1) / BLOCK_SIZE);
+    for (size_t b = 0; b < m_scales.size(); ++b) {
+        size_t begin = b * BLOCK_SIZE;
+        size_t end = std::min(n, begin + BLOCK_SIZE);
+        double max_abs = 0.0;
+        for (size_t i = begin; i < end; ++i)
+            max_abs = std::max(max_abs, std::fabs(values[i]));
+        float scale = (float)(max_abs / 127.0);
+        m_scales[b] = scale;
+        for (size_t i = begin; i < end; ++i) {
+            long q = scale > 0.0f ? std::lround(values[i] / scale) : 0;
+            m_int8[i] = (signed char)std::max(-127L, std::min(127L, q));
+        }
+    }
+}
+
+unsigned short QuantizedArray::float_to_half(float f) {
+    unsigned int x;
+    memcpy(&x, &f, sizeof(x));
+    unsigned short sign = (unsigned short)((x >> 16) & 0x8000);
+    x &= 0x7fffffff;
+
+    // 65520 and above would be rounded to infinity, they are clamped to
+    // the largest half 65504 instead
+    if (x >= 0x477ff000)
+        return sign | 0x7bff;
+
+    if (x < 0x38800000) {
+        // a subnormal half, adding 0.5 leaves the rounded mantissa in the
+        // low bits of the float
+        float a;
+        memcpy(&a, &x, sizeof(a));
+        a += 0.5f;
+        unsigned int y;
+        memcpy(&y, &a, sizeof(y));
+        return sign | (unsigned short)(y - 0x3f000000);
+    }
+
+    // rebias the exponent from 127 to 15, and round the 13 dropped bits to
+    // the nearest even
+    unsigned int odd = (x >> 13) & 1;
+    x += 0xc8000fff + odd;
+    return sign | (unsigned short)(x >> 13);
+}
+
+} // namespace me
+} // namespace maxent
@@ -0,0 +1,101 @@
+/*
+ * vi:ts=4:shiftwidth=4:expandtab
+ *
+ * quantarray.hpp  -  the quantized weights of a loaded MaxentModel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ */
+
+#ifndef QUANTARRAY_H
+#define QUANTARRAY_H
+
+#include <cstring>
+#include <vector>
+#include <boost/utility.hpp>
+
+namespace maxent {
+namespace me {
+
+/**
+ * How the weights of a loaded model are stored.
+ */
+enum WeightType {
+    WEIGHT_DOUBLE,   // 8 bytes per weight, the exact weights
+    WEIGHT_FLOAT16,  // 2 bytes per weight, with 11 significant bits
+    WEIGHT_INT8,     // 1 byte per weight, scaled by the largest of its block
+    WEIGHT_TYPE_NUM
+};
+
+/**
+ * An array of doubles stored in fewer bits, read as doubles again.
+ *
+ * - WEIGHT_FLOAT16: each value is rounded to the nearest IEEE half float,
+ *   the relative error is below 2^-11, and the values beyond 65504 are
+ *   clamped.
+ * - WEIGHT_INT8: the values are split into the blocks of BLOCK_SIZE, each
+ *   block has a float scale of its largest absolute value / 127, and each
+ *   value is rounded to a multiple of the scale, the absolute error is below
+ *   half of the scale.
+ *
+ * A value is decoded by a few instructions when it is read, so the scoring
+ * loop reads the small array and never the doubles.
+ */
+class QuantizedArray : boost::noncopyable {
+    public:
+        /** the values of an int8 block sharing one scale */
+        enum { BLOCK_SIZE = 64 };
+
+        QuantizedArray() : m_type(WEIGHT_DOUBLE), m_size(0) {}
+
+        /**
+         * Quantize the values.
+         * @param values The values.
+         * @param n The number of the values.
+         * @param type WEIGHT_FLOAT16 or WEIGHT_INT8.
+         */
+        void assign(const double* values, size_t n, WeightType type);
+
+        double operator[](size_t i) const {
+            if (m_type == WEIGHT_INT8)
+                return m_int8[i] * (double)m_scales[i / BLOCK_SIZE];
+            return half_to_float(m_half[i]);
+        }
+
+        size_t size() const { return m_size; }
+
+        /**
+         * Get the bytes of the quantized values.
+         */
+        size_t bytes() const {
+            return m_half.size() * sizeof(unsigned short) + m_int8.size()
+                + m_scales.size() * sizeof(float);
+        }
+
+        static unsigned short float_to_half(float f);
+
+        static float half_to_float(unsigned short h) {
+            // move the exponent and the mantissa into a float, then rebias the
+            // exponent by multiplying 2^112, which handles the subnormals too
+            unsigned int bits = (unsigned int)(h & 0x7fff) << 13;
+            float f;
+            memcpy(&f, &bits, sizeof(f));
+            f *= 5.192296858534828e+33f;
+            return (h & 0x8000) ? -f : f;
+        }
+
+    private:
+        WeightType m_type;
+        size_t m_size;
+
+        std::vector<unsigned short> m_half;
+        std::vector<signed char> m_int8;
+        std::vector<float> m_scales;
+};
+
+} // namespace me
+} // namespace maxent
+
+#endif /* ifndef QUANTARRAY_H */
@@ -0,0 +1,47 @@
+/** \file analysis_context.cpp
+ * \brief AnalysisContext holds the scratch buffers used by one analysis call.
+ * \date Oct 17, 2026
+ */
+
+#include "icma/analysis_context.h"
+#include "icma/me/CMAPOCTagger.h"
+#include "icma/me/CMAPOSTagger.h"
+#include "icma/util/StrBasedVTrie.h"
+#include "icma/util/WorkStealingPool.h"
+
+namespace cma
+{
+
+AnalysisContext::AnalysisContext()
+    : threadNum_( 1 ),
+    batch_( false )
+{
+}
+
+AnalysisContext::~AnalysisContext()
+{
+}
+
+AnalysisContext& AnalysisContext::local()
+{
+    static thread_local AnalysisContext context;
+    return context;
+}
+
+void AnalysisContext::release()
+{
+    chars_.initialize();
+    PGenericArray< unsigned char >().swap( typeBuf_ );
+    PGenericArray< size_t >().swap( segment_ );
+    PGenericArray< size_t >().swap( offsets_ );
+    std::string().swap( strBuf_ );
+    sentence_.setString( "" );
+    PGenericArray< Token >().swap( tokens_ );
+    pocBest_.reset();
+    pocLattice_.reset();
+    posBeam_.reset();
+    trieDAG_.reset();
+    pool_.reset();
+}
+
+} // namespace cma
@@ -6,8 +6,12 @@
  */
 
 #include "icma/analyzer.h"
+#include "icma/analysis_context.h"
+#include "icma/sentence.h"
+#include "icma/util/WorkStealingPool.h"
 
 #include <cassert>
+#include <cstring>
 
 namespace
 {
@@ -33,6 +37,8 @@ Analyzer::Analyzer()
 {
     options_[OPTION_TYPE_POS_TAGGING] = 1; // tag part-of-speech tags defaultly
     options_[OPTION_TYPE_NBEST] = 1; // set the default number of candidate results of runWithSentence()
+    options_[OPTION_TYPE_THREAD_NUM] = 1; // analyze the stream in the calling thread defaultly
+    options_[OPTION_TYPE_POS_BEAM_WIDTH] = 1; // tag the best tag of each word in turn defaultly
 }
 
 Analyzer::~Analyzer()
@@ -47,9 +53,73 @@ void Analyzer::setOption(OptionType nOption, double nValue)
         return;
     }
 
+    // check thread number value range
+    if(nOption == OPTION_TYPE_THREAD_NUM && nValue < 0)
+    {
+        return;
+    }
+
+    // check beam width value range
+    if(nOption == OPTION_TYPE_POS_BEAM_WIDTH && nValue < 1)
+    {
+        return;
+    }
+
     options_[nOption] = nValue;
 }
 
+void Analyzer::getCacheStatistics(size_t& hits, size_t& misses, size_t& size) const
+{
+    hits = misses = size = 0;
+}
+
+int Analyzer::runWithSentences(std::vector<Sentence>& sentences, unsigned int threadNum)
+{
+    size_t size = sentences.size();
+    std::vector<size_t> weights(size);
+    for(size_t i = 0; i < size; ++i)
+    {
+        weights[i] = strlen(sentences[i].getString());
+    }
+
+    std::vector<int> results(size, 1);
+
+    std::lock_guard<std::mutex> guard(batchLock_);
+    if(threadNum == 0)
+    {
+        threadNum = WorkStealingPool::hardwareThreadNum();
+    }
+    if(!batchPool_ || batchPool_->getThreadNum() != threadNum)
+    {
+        batchPool_.reset(new WorkStealingPool(threadNum));
+    }
+
+    batchPool_->run(weights, [&](size_t index, unsigned int /*worker*/) {
+        // the sentence is analyzed by this worker alone, no more threads are
+        // started to split it
+        AnalysisContext& context = AnalysisContext::local();
+        bool batch = context.batch_;
+        context.batch_ = true;
+        try
+        {
+            results[index] = runWithSentence(sentences[index], context);
+        }
+        catch(...)
+        {
+            context.batch_ = batch;
+            throw;
+        }
+        context.batch_ = batch;
+    });
+
+    for(size_t i = 0; i < size; ++i)
+    {
+        if(results[i] == 0)
+            return 0;
+    }
+    return 1;
+}
+
 double Analyzer::getOption(OptionType nOption) const
 {
     return options_[nOption];
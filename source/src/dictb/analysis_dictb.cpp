@@ -61,7 +61,7 @@ void DictBString::print( vector<string>* words,  ostream& stream )
 
 void divideNormalString(
         vector< DictBString >& out,
-        VTrie* trie,
+        const DictTrie* trie,
         size_t beginIdx,
         size_t endIdx,
         vector<string>* words
@@ -130,7 +130,7 @@ void divideNormalString(
 
 void addDictBString(
         vector< DictBString >& out,
-        VTrie* trie,
+        const DictTrie* trie,
         size_t beginIdx,
         size_t endIdx,
         vector<string>* words,
@@ -209,7 +209,7 @@ void parseDictBString(
         vector< DictBString >& out,
         vector<string>& words,
         CharType* types,
-        VTrie* trie,
+        const DictTrie* trie,
         size_t beginIdx,
         size_t endIdx
         )
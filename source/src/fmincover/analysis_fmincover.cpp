@@ -49,7 +49,8 @@ const string DefStr;
 
 void divideNormalString(
         FMinCOutType& out,
-        VTrie* trie,
+        const DictTrie* trie,
+        VTrieDAG& dag,
         size_t beginIdx,
         size_t endIdxSt,
         StringVectorType& words,
@@ -62,8 +63,6 @@ void divideNormalString(
     cout << "divideNormalString "<<tmp<<endl;
 */
 
-    StrBasedVTrie strTrie( trie );
-
     if( endIdxSt <= beginIdx )
         return;
     FMSizeType endIdx = (FMSizeType)endIdxSt;
@@ -75,44 +74,31 @@ void divideNormalString(
     FMSizeType maxOffset = endIdx - 1;
     dictLen[ dictLenSize - 1 ] = 1;
 
+    dag.build( trie, words, beginIdx, endIdxSt );
     for( FMSizeType curIdx = beginOffset; curIdx < maxOffset; ++curIdx )
     {
-        const char* curWord = words[ curIdx ];
-        strTrie.firstSearch( curWord );
-        // if non word ( length > 1 ) begin with words[ curIdx ]
-        if( strTrie.completeSearch == false
-                || strTrie.node.moreLong == false )
-        {
-            dictLen[ curIdx - beginOffset ] = 1;
-            continue;
-        }
-
         // try to find words that length > 2, forwards minimum matching
-        FMSizeType advIdx = curIdx + 1; // advanced index to find longer word
-        FMSizeType foundWordLastIdx = 0;
-        for( ; advIdx < endIdx; ++advIdx )
+        FMSizeType foundWordEnd = 0;
+        const VTrieDAG::Match* matchEnd = dag.matchEnd( curIdx );
+        for( const VTrieDAG::Match* match = dag.matchBegin( curIdx ); match < matchEnd; ++match )
         {
-            strTrie.search( words[ advIdx ] );
-            if( strTrie.completeSearch == false )
-                break;
-            if( strTrie.exists() == true )
-            {
-                foundWordLastIdx = advIdx;
+            if( match->value <= 0 || match->end < (size_t)curIdx + 2 )
+                continue;
+            foundWordEnd = (FMSizeType)match->end;
 
-                if (analOption.isMaxMatch)
-                    ;      // maximum match
-                else
-                    break; // minimum match
-            }
+            if (analOption.isMaxMatch)
+                ;      // maximum match
+            else
+                break; // minimum match
         }
 
         // non word ( length > 1 ) begin with words[ curIdx ]
-        if( foundWordLastIdx == 0 )
+        if( foundWordEnd == 0 )
         {
             dictLen[ curIdx - beginOffset ] = 1;
             continue;
         }
-        dictLen[ curIdx - beginOffset ] = foundWordLastIdx - curIdx + 1;
+        dictLen[ curIdx - beginOffset ] = foundWordEnd - curIdx;
     }
 
 
@@ -287,7 +273,8 @@ void divideDigitLetterString(
 
 void addFMinCString(
         FMinCOutType& out,
-        VTrie* trie,
+        const DictTrie* trie,
+        VTrieDAG& dag,
         size_t beginIdx,
         size_t endIdx,
         StringVectorType& words,
@@ -309,7 +296,7 @@ void addFMinCString(
     case CHAR_TYPE_OTHER:
     {
         // divide into smaller normal boundary
-        divideNormalString( out, trie, beginIdx, endIdx, words, analOption );
+        divideNormalString( out, trie, dag, beginIdx, endIdx, words, analOption );
         return;
     }
     case CHAR_TYPE_DIGIT:
@@ -381,7 +368,8 @@ void parseFMinCoverString(
         FMinCOutType& out,
         StringVectorType& words,
         CharType* types,
-        VTrie* trie,
+        const DictTrie* trie,
+        VTrieDAG& dag,
         size_t beginIdx,
         size_t endIdx,
         AnalOption& analOption
@@ -412,7 +400,7 @@ void parseFMinCoverString(
             if( strcmp( words[ curIdx ], words[ curIdx - 1 ] ) != 0 ||
                     strcmp( words[ curIdx ], "." ) != 0 )
             {
-                addFMinCString( out, trie, fsIdx, curIdx, words, types, analOption );
+                addFMinCString( out, trie, dag, fsIdx, curIdx, words, types, analOption );
                 fsIdx = curIdx;
             }
             break;
@@ -420,7 +408,7 @@ void parseFMinCoverString(
 
         case CHAR_TYPE_DATE:
         {
-            addFMinCString( out, trie, fsIdx, curIdx, words, types, analOption );
+            addFMinCString( out, trie, dag, fsIdx, curIdx, words, types, analOption );
             fsIdx = curIdx;
             break;
         }
@@ -430,7 +418,7 @@ void parseFMinCoverString(
         {
             if( t0 != CHAR_TYPE_DATE && t0 != CHAR_TYPE_DIGIT && t0 != CHAR_TYPE_LETTER )
             {
-                addFMinCString( out, trie, fsIdx, curIdx, words, types, analOption );
+                addFMinCString( out, trie, dag, fsIdx, curIdx, words, types, analOption );
                 fsIdx = curIdx;
             }
             break;
@@ -440,7 +428,7 @@ void parseFMinCoverString(
         {
             if( t0 != t_1 )
             {
-                addFMinCString( out, trie, fsIdx, curIdx, words, types, analOption );
+                addFMinCString( out, trie, dag, fsIdx, curIdx, words, types, analOption );
                 fsIdx = curIdx;
             }
             break;
@@ -452,7 +440,7 @@ void parseFMinCoverString(
 
     if( fsIdx < curIdx )
     {
-        addFMinCString( out, trie, fsIdx, curIdx, words, types, analOption );
+        addFMinCString( out, trie, dag, fsIdx, curIdx, words, types, analOption );
     }
 
 }
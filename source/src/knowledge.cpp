@@ -35,7 +35,9 @@ string toLower(const char* s)
 }
 
 Knowledge::Knowledge()
-    : encodeType_(ENCODE_TYPE_GB2312)
+    : encodeType_(ENCODE_TYPE_GB2312),
+      modelWeightType_(MODEL_WEIGHT_DOUBLE),
+      version_(0)
 {
 }
 
@@ -53,6 +55,26 @@ Knowledge::EncodeType Knowledge::getEncodeType() const
     return encodeType_;
 }
 
+void Knowledge::setModelWeightType(ModelWeightType type)
+{
+    modelWeightType_ = type;
+}
+
+Knowledge::ModelWeightType Knowledge::getModelWeightType() const
+{
+    return modelWeightType_;
+}
+
+unsigned long Knowledge::getVersion() const
+{
+    return version_;
+}
+
+void Knowledge::increaseVersion()
+{
+    ++version_;
+}
+
 Knowledge::EncodeType Knowledge::decodeEncodeType(const char* encType)
 {
     string enc = toLower(encType);
@@ -82,6 +104,24 @@ Knowledge::EncodeType Knowledge::decodeEncodeType(const char* encType)
     return Knowledge::ENCODE_TYPE_NUM;
 }
 
+Knowledge::ModelWeightType Knowledge::decodeModelWeightType(const char* weightType)
+{
+    string type = toLower(weightType);
+    if(type == "double")
+    {
+        return Knowledge::MODEL_WEIGHT_DOUBLE;
+    }
+    else if(type == "float16" || type == "fp16")
+    {
+        return Knowledge::MODEL_WEIGHT_FLOAT16;
+    }
+    else if(type == "int8")
+    {
+        return Knowledge::MODEL_WEIGHT_INT8;
+    }
+    return Knowledge::MODEL_WEIGHT_TYPE_NUM;
+}
+
 int Knowledge::loadModel( const char* modelPath, bool toLoadModel )
 {
     string modelPathStr(modelPath);
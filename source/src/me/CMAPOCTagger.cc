@@ -26,6 +26,15 @@ namespace cma{
 
 #define DEFAULT_POC POC_TAG_B
 
+/**
+ * the least score difference of B and E to decide the POC tag by its sign,
+ * far larger than the rounding errors of the scores and probabilities
+ */
+#define POC_LOGIT_MARGIN 1e-6
+
+/** the largest score never overflows exp() */
+#define POC_MAX_SCORE 700.0
+
 const string POC_BOUNDARY = "BoUnD";
 
 string CharTypeArray[CHAR_TYPE_NUM];
@@ -35,7 +44,9 @@ namespace pocinner{
 #define CONTEXT_CHAR_LEN 4
 
 /**
- * Inner function to get the context of the POC, invoked by segmentation method
+ * Inner function to get the context of the POC, invoked by segmentation method.
+ * SegContextMap::getContext() gives the ids of the same predicates, they
+ * should be kept consistent.
  */
 template< class StringVector >
 inline void get_poc_zh_context_seg(
@@ -138,6 +149,51 @@ inline void get_poc_zh_context_seg(
     context[7] = "C-1,1=" + c_1 + "," + c1;
 }
 
+/** the slot of the context "afEnt" in SegTagger::typeContextTags_ */
+#define TYPE_CONTEXT_AFENT 0
+
+/** the slots in SegTagger::typeContextTags_ */
+#define TYPE_CONTEXT_NUM ( 1 + CHAR_TYPE_NUM * CHAR_TYPE_NUM * CHAR_TYPE_NUM * 128 )
+
+/**
+ * Inner function to get the slot of the context made by
+ * \e get_poc_zh_context_seg(), they should be kept consistent.
+ * \return the slot in SegTagger::typeContextTags_, or -1 if the context
+ * contains the characters other than an ASCII next character
+ */
+inline int get_poc_zh_type_context_slot(
+        StringVectorType& words,
+        CharType *types,
+        size_t index,
+        CMA_CType *ctype
+        )
+{
+    CharType t_1 = index > 0 ? types[index - 1] : CHAR_TYPE_INIT;
+    CharType t0 = types[ index ];
+    if( index > 0 && ( t_1 == CHAR_TYPE_DATE || t_1 == CHAR_TYPE_PUNC ||
+            ( t_1 == CHAR_TYPE_OTHER ) != ( t0 == CHAR_TYPE_OTHER ) ) )
+        return TYPE_CONTEXT_AFENT;
+
+    if( t0 == CHAR_TYPE_OTHER )
+        return -1;
+
+    // the feature "C1=" is the same for no next character and an empty one
+    CharType t1;
+    unsigned int c1 = 0;
+    if( (index + 1) < words.size() )
+    {
+        const unsigned char* uc = (const unsigned char*)words[ index + 1 ];
+        if( uc[0] >= 0x80 || ( uc[0] != 0 && uc[1] != 0 ) )
+            return -1;
+        c1 = uc[0];
+        t1 = types[ index + 1 ];
+    }
+    else
+        t1 = ctype->getDefaultEndType( t0 );
+
+    return 1 + ( ( t_1 * CHAR_TYPE_NUM + t0 ) * CHAR_TYPE_NUM + t1 ) * 128 + c1;
+}
+
 /**
  * Inner function to get the context of the POC
  */
@@ -354,8 +410,195 @@ inline void combinePOCToWord(
     seg.push_back( n );
 }
 
+/** the prefixes of the character features in get_poc_zh_context_seg() */
+const char* UNIGRAM_PREFIXES[] = { "C-2=", "C-1=", "C0=", "C1=" };
+
+/** the prefixes of the two-character features in get_poc_zh_context_seg() */
+const char* BIGRAM_PREFIXES[] = { "C-2,-1=", "C-1,0=", "C0,1=", "C-1,1=" };
+
+/**
+ * Inner function to pack the bytes of a character into an integer key
+ * \return false if the character is longer than the key
+ */
+inline bool pack_char( const char* str, size_t len, uint64_t& key )
+{
+    if( len > sizeof( key ) )
+        return false;
+    key = 0;
+    for( size_t i = 0; i < len; ++i )
+        key |= (uint64_t)(unsigned char)str[ i ] << ( i * 8 );
+    return true;
+}
+
 } //end namespace pocinner
 
+const uint32_t SegContextMap::UNKNOWN_CHAR;
+
+void SegContextMap::build(const MaxentModel& me)
+{
+    charIds_.clear();
+    bigrams_.clear();
+    for( int i = 0; i < UNIGRAM_NUM; ++i )
+        unigrams_[ i ].clear();
+    addChar( "", 0 );
+
+    size_t predSize = me.pred_size();
+    for( pred_id_type pid = 0; pid < predSize; ++pid )
+    {
+        const string& pred = me.pred_name( pid );
+        bool found = false;
+        for( int i = 0; i < UNIGRAM_NUM && !found; ++i )
+        {
+            size_t prefixLen = strlen( pocinner::UNIGRAM_PREFIXES[ i ] );
+            if( pred.compare( 0, prefixLen, pocinner::UNIGRAM_PREFIXES[ i ] ) != 0 )
+                continue;
+            found = true;
+            uint32_t c = addChar( pred.data() + prefixLen, pred.size() - prefixLen );
+            if( c == UNKNOWN_CHAR )
+                continue;
+            if( unigrams_[ i ].size() <= c )
+                unigrams_[ i ].resize( c + 1, MaxentModel::null_pred_id );
+            unigrams_[ i ][ c ] = pid;
+        }
+
+        for( int i = 0; i < BIGRAM_NUM && !found; ++i )
+        {
+            size_t prefixLen = strlen( pocinner::BIGRAM_PREFIXES[ i ] );
+            if( pred.compare( 0, prefixLen, pocinner::BIGRAM_PREFIXES[ i ] ) != 0 )
+                continue;
+            found = true;
+            // the character may be ',' as well, so the predicate is kept for
+            // every pair of characters making it
+            const char* value = pred.data() + prefixLen;
+            size_t valueLen = pred.size() - prefixLen;
+            for( size_t sep = 0; sep < valueLen; ++sep )
+            {
+                if( value[ sep ] != ',' )
+                    continue;
+                uint32_t c1 = addChar( value, sep );
+                uint32_t c2 = addChar( value + sep + 1, valueLen - sep - 1 );
+                if( c1 != UNKNOWN_CHAR && c2 != UNKNOWN_CHAR )
+                    bigrams_[ (uint64_t)i << 62 | (uint64_t)c1 << 31 | c2 ] = pid;
+            }
+        }
+    }
+
+    afEnt_ = me.pred_id( "afEnt" );
+    for( int t = 0; t < CHAR_TYPE_NUM; ++t )
+    {
+        typePreds_[ 0 ][ t ] = me.pred_id( "T-1=" + CharTypeArray[ t ] );
+        typePreds_[ 1 ][ t ] = me.pred_id( "T0=" + CharTypeArray[ t ] );
+        typePreds_[ 2 ][ t ] = me.pred_id( "T+1=" + CharTypeArray[ t ] );
+    }
+}
+
+uint32_t SegContextMap::findChar(const char* str, size_t len) const
+{
+    uint64_t key;
+    if( !pocinner::pack_char( str, len, key ) )
+        return UNKNOWN_CHAR;
+    std::unordered_map< uint64_t, uint32_t >::const_iterator itr = charIds_.find( key );
+    return itr != charIds_.end() ? itr->second : UNKNOWN_CHAR;
+}
+
+uint32_t SegContextMap::addChar(const char* str, size_t len)
+{
+    uint64_t key;
+    // the ids are kept below 2^31 to make the keys of bigrams_
+    if( !pocinner::pack_char( str, len, key ) || charIds_.size() >= 0x7FFFFFFF )
+        return UNKNOWN_CHAR;
+    std::unordered_map< uint64_t, uint32_t >::iterator itr = charIds_.find( key );
+    if( itr != charIds_.end() )
+        return itr->second;
+    uint32_t id = (uint32_t)charIds_.size();
+    charIds_[ key ] = id;
+    return id;
+}
+
+SegContextMap::pred_id_type SegContextMap::getBigram(int feature, uint32_t c1, uint32_t c2) const
+{
+    if( c1 == UNKNOWN_CHAR || c2 == UNKNOWN_CHAR )
+        return MaxentModel::null_pred_id;
+    std::unordered_map< uint64_t, pred_id_type >::const_iterator itr =
+            bigrams_.find( (uint64_t)feature << 62 | (uint64_t)c1 << 31 | c2 );
+    return itr != bigrams_.end() ? itr->second : MaxentModel::null_pred_id;
+}
+
+void SegContextMap::getCharIds(
+        StringVectorType& words,
+        size_t beginIdx,
+        size_t endIdx,
+        uint32_t* charIds
+        ) const
+{
+    for( size_t i = beginIdx; i < endIdx; ++i )
+    {
+        const char* c = words[ i ];
+        charIds[ i ] = findChar( c, strlen( c ) );
+    }
+}
+
+size_t SegContextMap::getContext(
+        const uint32_t* charIds,
+        CharType* types,
+        size_t n,
+        size_t index,
+        CMA_CType* ctype,
+        pred_id_type* pids
+        ) const
+{
+    CharType t_1 = index > 0 ? types[index - 1] : CHAR_TYPE_INIT;
+    CharType t0 = types[ index ];
+    if( index > 0 && ( t_1 == CHAR_TYPE_DATE || t_1 == CHAR_TYPE_PUNC ||
+            ( t_1 == CHAR_TYPE_OTHER ) != ( t0 == CHAR_TYPE_OTHER ) ) )
+    {
+        pids[ 0 ] = afEnt_;
+        return 1;
+    }
+
+    // the id of "" is 0
+    uint32_t c1 = (index + 1) < n ? charIds[ index + 1 ] : 0;
+    if( t0 != CHAR_TYPE_OTHER )
+    {
+        CharType t1 = (index + 1) < n ? types[ index + 1 ] : ctype->getDefaultEndType( t0 );
+        pids[ 0 ] = getUnigram( 3, c1 );
+        pids[ 1 ] = typePreds_[ 0 ][ t_1 ];
+        pids[ 2 ] = typePreds_[ 1 ][ t0 ];
+        pids[ 3 ] = typePreds_[ 2 ][ t1 ];
+        return 4;
+    }
+
+    uint32_t c_2 = index > 1 ? charIds[ index - 2 ] : 0;
+    uint32_t c_1 = index > 0 ? charIds[ index - 1 ] : 0;
+    uint32_t c0 = charIds[ index ];
+    pids[ 0 ] = getUnigram( 0, c_2 );
+    pids[ 1 ] = getUnigram( 1, c_1 );
+    pids[ 2 ] = getUnigram( 2, c0 );
+    pids[ 3 ] = getUnigram( 3, c1 );
+    pids[ 4 ] = getBigram( 0, c_2, c_1 );
+    pids[ 5 ] = getBigram( 1, c_1, c0 );
+    pids[ 6 ] = getBigram( 2, c0, c1 );
+    pids[ 7 ] = getBigram( 3, c_1, c1 );
+    return 8;
+}
+
+void SegContextMap::appendContext(
+        const uint32_t* charIds,
+        CharType* types,
+        size_t n,
+        size_t index,
+        CMA_CType* ctype,
+        SegContextBatch& batch
+        ) const
+{
+    size_t offset = batch.pids.size();
+    batch.pids.resize( offset + MAX_CONTEXT_SIZE );
+    size_t size = getContext( charIds, types, n, index, ctype, &batch.pids[ offset ] );
+    batch.pids.resize( offset + size );
+    batch.offsets.push_back( offset + size );
+    batch.indices.push_back( index );
+}
+
 
 
 /**
@@ -383,13 +626,26 @@ void poc_train(const char* file, const string& modelPath, Knowledge::EncodeType
 }
 
 
-SegTagger::SegTagger(const string& cateName, VTrie* posTrie, double eScore)
+SegTagger::SegTagger(const string& cateName, VTrie* posTrie,
+        WeightType weightType, double eScore)
+    : trieDict_(posTrie)
 {
     SegTagger::initialize();
     me.load(cateName + ".model");
-
-    trie_ = posTrie;
+    me.quantize(weightType);
+    contextMap_.build(me);
+    bOutcome_ = me.outcome_id(POC_TAG_B_NAME);
+    eOutcome_ = me.outcome_id(POC_TAG_E_NAME);
+    logitDecision_ = me.is_binary() && bOutcome_ != MaxentModel::null_outcome_id
+            && eOutcome_ != MaxentModel::null_outcome_id
+            && SegContextMap::MAX_CONTEXT_SIZE * me.max_abs_weight() < POC_MAX_SCORE;
+
+    trie_ = &trieDict_;
     setEScore(eScore);
+
+    typeContextTags_.reset( new std::atomic< uint8_t >[ TYPE_CONTEXT_NUM ] );
+    for( int i = 0; i < TYPE_CONTEXT_NUM; ++i )
+        typeContextTags_[ i ].store( POC_TAG_INIT, std::memory_order_relaxed );
 }
 
 SegTagger::~SegTagger()
@@ -397,11 +653,8 @@ SegTagger::~SegTagger()
 }
 
 void SegTagger::tag_word(
-        StringVectorType& words,
-        CharType *types,
-        int index,
+        const double* probs,
         size_t N,
-        uint8_t* tags,
         POCTagUnit* candidates,
         int& lastIndex,
         size_t& canSize,
@@ -409,49 +662,80 @@ void SegTagger::tag_word(
         int candidateNum
         )
 {
-    vector<string> context;
-
-    pocinner::get_poc_zh_context_seg< StringVectorType >(words, types, index, context, ctype_);
-
-    vector<pair<outcome_type, double> > outcomes;
-    me.eval_all(context, outcomes, false);
-
-    size_t outSize = outcomes.size();
+    size_t outSize = me.outcome_size();
     for(size_t i=0; i<outSize; ++i){
-        pair<outcome_type, double>& pair = outcomes[i];
-        double score = pair.second * initScore;
+        double score = probs[i] * initScore;
         if(canSize >= N && score <= candidates[lastIndex].score)
             continue;
-        uint8_t pocCode = (pair.first == POC_TAG_B_NAME) ? POC_TAG_B : POC_TAG_E;
+        uint8_t pocCode = (i == bOutcome_) ? POC_TAG_B : POC_TAG_E;
         pocinner::insertCandidate(pocCode, candidateNum, score, candidates,
                 lastIndex, canSize, N);
     }
 }
 
+bool SegTagger::isTagE(
+        double diff,
+        const SegContextMap::pred_id_type* context,
+        size_t contextSize,
+        double* probs
+        ) const
+{
+    // As the scores are bounded, the probability of E is more than 0.5 if
+    // and only if its score is more than the one of B. Only the contexts
+    // whose scores are too close are evaluated as before, so the tags are
+    // always the same as the probabilities.
+    if( eOutcome_ == 0 )
+        diff = -diff;
+    if( diff > POC_LOGIT_MARGIN )
+        return true;
+    if( diff < -POC_LOGIT_MARGIN )
+        return false;
+
+    me.eval_ids(context, contextSize, probs);
+    double tagEScore = (eOutcome_ == 0) ? probs[0] : ( 1 - probs[0] );
+    return !( tagEScore <= 0.5 );
+}
+
+void SegTagger::gather_contexts(
+        const uint32_t* charIds,
+        CharType* types,
+        size_t n,
+        size_t beginIdx,
+        size_t endIdx,
+        const uint8_t* tags,
+        SegContextBatch& batch
+        ) const
+{
+    for( size_t index = beginIdx; index < endIdx; ++index )
+    {
+        if( tags[ index ] == POC_TAG_INIT )
+            contextMap_.appendContext( charIds, types, n, index, ctype_, batch );
+    }
+}
+
 void SegTagger::preProcess(
         StringVectorType& words,
         CharType* types,
-        uint8_t* tags
+        uint8_t* tags,
+        VTrieDAG& dag
         )
 {
 	CMA_WType wtype(ctype_);
 
 	memset(tags, POC_TAG_INIT, words.size());
 	tags[0] = POC_TAG_B;
-	StrBasedVTrie strTrie(trie_);
 
 	int size = words.size();
+	dag.build( trie_, words, 0, size );
 	int start = 0;
 	while( start < size )
 	{
-		int idx = start;
-		strTrie.firstSearch( words[idx++] );
 		int maxLastIdx = 0; //exclude the maxLastIdx itself
-		while( strTrie.completeSearch && idx < size )
+		const VTrieDAG::Match* matchEnd = dag.matchEnd( start );
+		for( const VTrieDAG::Match* match = dag.matchBegin( start ); match < matchEnd; ++match )
 		{
-			strTrie.search( words[idx++] );
-			if( strTrie.exists() )
-				maxLastIdx = idx;
+			if( match->value > 0 && (int)match->end > start + 1 )
+				maxLastIdx = (int)match->end;
 		}
 
 		#ifdef DEBUG_POC_TAGGER_TRIE
@@ -494,78 +778,71 @@ void SegTagger::seg_sentence(
         size_t N,
         size_t retSize,
         PGenericArray<size_t>& segment,
-        VGenericArray< CandidateMeta >& candMeta
+        VGenericArray< CandidateMeta >& candMeta,
+        POCLattice& lattice
         )
 {
     static CandidateMeta DefCandidateMeta;
     size_t n = words.size();
 
-    //h0, h1 and score don't need to initialize
-    uint8_t** _array1 = new uint8_t*[N];
-    uint8_t** _array2 = new uint8_t*[N];
-    for(size_t i = 0; i < N; i++)
-    {
-        _array1[i] = new uint8_t [n];
-        _array2[i] = new uint8_t [n];
-    }
-
     //pre-process
-    preProcess( words, types, _array1[0] );
-    memcpy(_array2[0], _array1[0], n);
-    //initialize all the array
-    for(size_t i=1; i<N; ++i)
-    {
-    	memcpy(_array1[i], _array1[0], n);
-    	memcpy(_array2[i], _array1[0], n);
-    }
-
-    // TODO : Need to check if following modification is right. (dohyun)
-    uint8_t** h0 = _array1;
-    uint8_t** h1 = _array2;
-
-    uint8_t**hTmp;
-
-    double* scores = new double[N];
-    scores[0] = 1.0;
-    
-    size_t h0Size = 1;
-
-    POCTagUnit* candidates = new POCTagUnit[N];
+    lattice.clear();
+    lattice.initTags.resize( n );
+    preProcess( words, types, &lattice.initTags[0], lattice.dag );
+
+    // the hypotheses only keep their last nodes, the empty one at first
+    std::vector< int >& heads = lattice.heads;
+    std::vector< double >& scores = lattice.scores;
+    heads.assign( 1, -1 );
+    scores.assign( 1, 1.0 );
+
+    // the context of a character doesn't depend on the tags, so each one
+    // is evaluated only once for all the hypotheses
+    std::vector< uint32_t >& charIds = lattice.charIds;
+    charIds.resize( n );
+    contextMap_.getCharIds( words, 0, n, charIds.data() );
+    SegContextBatch& batch = lattice.batch;
+    gather_contexts( charIds.data(), types, n, 0, n, &lattice.initTags[0], batch );
+    size_t outSize = me.outcome_size();
+    batch.scores.resize( batch.size() * outSize );
+    if( batch.size() > 0 )
+        me.eval_batch( &batch.pids[0], &batch.offsets[0], batch.size(), &batch.scores[0] );
+
+    lattice.candidates.resize( N );
+    POCTagUnit* candidates = &lattice.candidates[0];
     //last index of candidates
     int lastIndex;
     //the size of the candidates
     size_t canSize;
 
-    for(size_t i=0; i<n; ++i){
-        if(_array1[0][i] != POC_TAG_INIT )
-        	continue;
+    for(size_t step=0; step<batch.size(); ++step){
     	lastIndex = -1;
         canSize = 0;
         #ifdef EN_ASSERT
-            assert(h0Size <= N);
+            assert(heads.size() <= N);
         #endif
 
-        for(size_t j=0; j<h0Size; ++j){
-            tag_word(words, types, i, N, h0[j], candidates, lastIndex,
-                    canSize, scores[j], j);
+        const double* probs = &batch.scores[ step * outSize ];
+        for(size_t j=0; j<heads.size(); ++j){
+            tag_word(probs, N, candidates, lastIndex, canSize, scores[j], j);
         }
         
-        //generate the N-best
+        //generate the N-best, each one adds a node to its parent
+        lattice.nextHeads.resize( canSize );
+        lattice.nextScores.resize( canSize );
         for(int k=canSize-1; k>=0; --k){
             POCTagUnit& unit = candidates[lastIndex];
             lastIndex = unit.previous;
-            memcpy(h1[k], h0[unit.index], i);            
-            h1[k][i] = unit.pocCode;
-            scores[k] = unit.score;
+            POCLattice::Node node = { heads[unit.index], unit.pocCode };
+            lattice.nextHeads[k] = (int)lattice.nodes.size();
+            lattice.nodes.push_back( node );
+            lattice.nextScores[k] = unit.score;
         }
 
-        //swap h0 and h1
-        hTmp = h0;
-        h0 = h1;
-        h1 = hTmp;
-
-        h0Size = canSize;
+        heads.swap( lattice.nextHeads );
+        scores.swap( lattice.nextScores );
     }
+    size_t h0Size = heads.size();
     if(retSize < h0Size)
         h0Size = retSize;
 
@@ -574,28 +851,20 @@ void SegTagger::seg_sentence(
     segment.clear();
     segment.reserve( h0Size * n * 2 );
 
+    std::vector< uint8_t >& tags = lattice.tags;
     for( size_t k=0; k<h0Size; ++k )
     {
-        uint8_t* tags = h0[k];
+        // follow the nodes back to collect the tags of the steps
+        tags = lattice.initTags;
+        size_t step = batch.size();
+        for( int node = heads[k]; node >= 0; node = lattice.nodes[ node ].parent )
+            tags[ batch.indices[ --step ] ] = lattice.nodes[ node ].pocCode;
+
         candMeta.push_back( DefCandidateMeta );
         candMeta[ k ].score_ = scores[k];
         candMeta[ k ].segOffset_ = segment.size();
-        pocinner::combinePOCToWord(words, types, n, tags, segment );
-    }
-
-
-    for(size_t i = 0; i < N; i++)
-    {
-        delete[] _array1[i];
-        delete[] _array2[i];
-        _array1[i] = 0;
-        _array2[i] = 0;
+        pocinner::combinePOCToWord(words, types, n, &tags[0], segment );
     }
-    delete[] _array1;
-    delete[] _array2;
-    delete[] scores;
-    delete[] candidates;
-    
 }
 
 void SegTagger::tag_file(const char* inFile, const char* outFile,
@@ -678,11 +947,31 @@ void SegTagger::seg_sentence_best(
     #ifdef USE_STRTRIE
         StrBasedVTrie strTrie(trie_);
         int wordLen = 0;
-        preProcess( words, types, pocRet );
+        VTrieDAG dag;
+        preProcess( words, types, pocRet, dag );
     #endif
 
     size_t lastExistIndex = 0;
 
+    // the scores don't depend on the tags before, so the characters not
+    // tagged by the pre-processing are evaluated together
+    vector<uint32_t> charIds( n );
+    contextMap_.getCharIds( words, 0, n, charIds.data() );
+    SegContextBatch batch;
+    gather_contexts( charIds.data(), types, n, 0, n, pocRet, batch );
+
+    size_t outSize = me.outcome_size();
+    batch.scores.resize( batch.size() * outSize );
+    if( batch.size() > 0 )
+        me.eval_batch( &batch.pids[0], &batch.offsets[0], batch.size(), &batch.scores[0] );
+
+    vector<double> eScores( n );
+    for( size_t k = 0; k < batch.size(); ++k )
+    {
+        const double* probs = &batch.scores[ k * outSize ];
+        eScores[ batch.indices[ k ] ] = (eOutcome_ == 0) ? probs[0] : ( 1 - probs[0] );
+    }
+
     for(size_t index=0; index<n; ++index){
 		#ifdef DEBUG_POC_TAGGER
             cout << "Check at " << index << ": " << words[index] << ", type = " <<
@@ -705,22 +994,7 @@ void SegTagger::seg_sentence_best(
             const char* curPtr = words[ index ];
         #endif
             
-        vector<string> context;
-        pocinner::get_poc_zh_context_seg<StringVectorType>(
-                words, types, index, context, ctype_);
-
-        #ifdef DEBUG_POC_TAGGER
-        /*int n = context.size();
-        for(int ii=0; ii<n; ++ii){
-            cout<<"Context "<<ii<<":"<<context[ii]<<endl;
-        }*/
-        #endif
-
-        vector<pair<outcome_type, double> > outcomes;
-        me.eval_all(context, outcomes, false);
-        pair<outcome_type, double>& pair0 = outcomes[0];
-        double tagEScore = (pair0.first == POC_TAG_E_NAME) ?
-              pair0.second : ( 1 - pair0.second );
+        double tagEScore = eScores[ index ];
 
         #ifdef DEBUG_POC_TAGGER
             cout<<"tagEScore "<<tagEScore<<endl;
@@ -800,37 +1074,116 @@ void SegTagger::seg_sentence_best(
 void SegTagger::seg_sentence_best_with_me(
         StringVectorType& words,
         CharType* types,
-        PGenericArray<size_t>& segment
+        PGenericArray<size_t>& segment,
+        POCBest& best
         )
 {
     size_t n = words.size();
-    uint8_t* pocRet = new uint8_t[n];
+    best.tags.resize( n );
+    if( best.buffers.empty() )
+        best.buffers.resize( 1 );
+    uint8_t* pocRet = best.tags.data();
 
-    for(size_t index=0; index<n; ++index){
+    tag_poc_best_with_me( words, types, 0, n, pocRet, best.buffers[0] );
 
-        vector<string> context;
-        pocinner::get_poc_zh_context_seg<StringVectorType>(
-                words, types, index, context, ctype_);
+    pocinner::combinePOCToWord(words, types, n, pocRet, segment);
+}
 
+void SegTagger::tag_poc_best_with_me(
+        StringVectorType& words,
+        CharType* types,
+        size_t beginIdx,
+        size_t endIdx,
+        uint8_t* pocRet,
+        POCBestBuffer& buffer
+        )
+{
+    // the context of a character contains the characters
+    // [ index - 2, index + 1 ]
+    size_t n = words.size();
+    vector<uint32_t>& charIds = buffer.charIds;
+    charIds.resize( n );
+    contextMap_.getCharIds( words, beginIdx > 2 ? beginIdx - 2 : 0,
+            endIdx < n ? endIdx + 1 : n, charIds.data() );
+
+    // the letters, digits and so on mostly have the known contexts, the
+    // other characters are evaluated together, and an unknown type context
+    // is evaluated only once
+    SegContextBatch& batch = buffer.batch;
+    batch.clear();
+    std::unordered_map< int, size_t >& slotIndices = buffer.slotIndices;
+    slotIndices.clear();
+    vector< pair< size_t, size_t > >& copies = buffer.copies;
+    copies.clear();
+    for(size_t index=beginIdx; index<endIdx; ++index){
+        int slot = pocinner::get_poc_zh_type_context_slot( words, types, index, ctype_ );
+        if( slot >= 0 )
+        {
+            uint8_t tag = typeContextTags_[ slot ].load( std::memory_order_relaxed );
+            if( tag != POC_TAG_INIT )
+            {
+                pocRet[index] = tag;
+                continue;
+            }
+            std::pair< std::unordered_map< int, size_t >::iterator, bool > ret =
+                    slotIndices.insert( std::make_pair( slot, index ) );
+            if( ret.second == false )
+            {
+                copies.push_back( std::make_pair( index, ret.first->second ) );
+                continue;
+            }
+        }
+        contextMap_.appendContext( charIds.data(), types, n, index, ctype_, batch );
+    }
 
-        vector<pair<outcome_type, double> > outcomes;
-        me.eval_all(context, outcomes, false);
-        pair<outcome_type, double>& pair0 = outcomes[0];
-        double tagEScore = (pair0.first == POC_TAG_E_NAME) ?
-              pair0.second : ( 1 - pair0.second );
+    size_t batchSize = batch.size();
+    if( batchSize == 0 )
+        return;
 
-        //no check if the POC tag is B
-        if(tagEScore <= 0.5){
-            pocRet[index] = POC_TAG_B;
-            continue;
+    vector<double>& probs = buffer.probs;
+    probs.resize( me.outcome_size() );
+    if( logitDecision_ )
+    {
+        batch.scores.resize( batchSize );
+        me.logit_batch( &batch.pids[0], &batch.offsets[0], batchSize, &batch.scores[0] );
+        for( size_t k = 0; k < batchSize; ++k )
+        {
+            size_t offset = batch.offsets[ k ];
+            bool tagE = isTagE( batch.scores[ k ], &batch.pids[ offset ],
+                    batch.offsets[ k + 1 ] - offset, &probs[0] );
+            pocRet[ batch.indices[ k ] ] = tagE ? POC_TAG_E : POC_TAG_B;
+        }
+    }
+    else
+    {
+        size_t outSize = probs.size();
+        batch.scores.resize( batchSize * outSize );
+        me.eval_batch( &batch.pids[0], &batch.offsets[0], batchSize, &batch.scores[0] );
+        for( size_t k = 0; k < batchSize; ++k )
+        {
+            const double* p = &batch.scores[ k * outSize ];
+            double tagEScore = (eOutcome_ == 0) ? p[0] : ( 1 - p[0] );
+            //no check if the POC tag is B
+            pocRet[ batch.indices[ k ] ] = !( tagEScore <= 0.5 ) ? POC_TAG_E : POC_TAG_B;
         }
+    }
 
-        pocRet[index] = POC_TAG_E;
+    for( size_t i = 0; i < copies.size(); ++i )
+        pocRet[ copies[i].first ] = pocRet[ copies[i].second ];
 
-    }
+    for( std::unordered_map< int, size_t >::iterator itr = slotIndices.begin();
+            itr != slotIndices.end(); ++itr )
+        typeContextTags_[ itr->first ].store( pocRet[ itr->second ], std::memory_order_relaxed );
+}
 
-    pocinner::combinePOCToWord(words, types, n, pocRet, segment);
-    delete[] pocRet;
+void SegTagger::combine_poc_to_word(
+        StringVectorType& words,
+        CharType* types,
+        uint8_t* pocRet,
+        PGenericArray<size_t>& segment
+        )
+{
+    pocinner::combinePOCToWord(words, types, words.size(), pocRet, segment);
 }
 
 #undef BACK_FIX_END_TAG
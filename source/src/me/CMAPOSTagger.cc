@@ -20,6 +20,9 @@ namespace cma{
 string POS_BOUNDARY = "BoUnD";
 const char* POS_BOUNDARY_CSTR = POS_BOUNDARY.c_str();
 
+/** the code of the boundary tag, which is not in the POSTable */
+#define POS_BOUNDARY_CODE -2
+
 namespace posinner{
 
 inline void get_pos_zh_scontext_1(vector<string>& words, string& tag_1,
@@ -133,6 +136,69 @@ inline void get_pos_zh_scontext_postagger(
 
 }
 
+/**
+ * Inner function to evaluate the context without copying the predicate and
+ * outcome names, the probabilities are the same as \e MaxentModel::eval_all()
+ * \param pids the buffer of the predicate ids
+ * \param probs to store the probability of each outcome id
+ */
+inline void eval_pos_context(
+        const MaxentModel& me,
+        const vector<string>& context,
+        vector<MaxentModel::pred_id_type>& pids,
+        double* probs
+        )
+{
+    pids.resize( context.size() );
+    for( size_t i = 0; i < context.size(); ++i )
+        pids[ i ] = me.pred_id( context[ i ] );
+    me.eval_ids( pids.data(), pids.size(), probs );
+}
+
+/**
+ * Inner function to get the ids of the predicates of the word which do not
+ * depend on the tags, in the order of \e get_pos_zh_scontext_postagger(),
+ * so that their scores add up the same.
+ * \param pred the buffer to build the predicate names
+ * \param pids to hold the predicate ids
+ */
+inline void get_pos_word_pids(
+        const MaxentModel& me,
+        StringVectorType& words,
+        int index,
+        int endIdx,
+        string& pred,
+        vector<MaxentModel::pred_id_type>& pids
+        )
+{
+    int n = endIdx;
+    const char* w_2 = index > 1 ? words[index-2] : POS_BOUNDARY_CSTR;
+    const char* w_1 = index > 0 ? words[index-1] : POS_BOUNDARY_CSTR;
+    const char* w0 = words[index];
+    const char* w1 = (index < n - 1) ? words[index+1] : POS_BOUNDARY_CSTR;
+
+    pids.clear();
+    pred.assign( "C-1=" ).append( w_1 );
+    pids.push_back( me.pred_id( pred ) );
+    pred.assign( "CO=" ).append( w0 );
+    pids.push_back( me.pred_id( pred ) );
+    pred.assign( "C1=" ).append( w1 );
+    pids.push_back( me.pred_id( pred ) );
+
+    pred.assign( "C-2,-1=" ).append( w_2 ).append( "," ).append( w_1 );
+    pids.push_back( me.pred_id( pred ) );
+    pred.assign( "C-1,0=" ).append( w_1 ).append( "," ).append( w0 );
+    pids.push_back( me.pred_id( pred ) );
+    pred.assign( "C0,1=" ).append( w0 ).append( "," ).append( w1 );
+    pids.push_back( me.pred_id( pred ) );
+
+    pred.assign( "C-1,1=" ).append( w_1 ).append( "," ).append( w1 );
+    pids.push_back( me.pred_id( pred ) );
+
+    pred.assign( "C-1,0,1=" ).append( w_1 ).append( "," ).append( w0 ).append( "," ).append( w1 );
+    pids.push_back( me.pred_id( pred ) );
+}
+
 } //end namespace posinner
 
 void get_pos_zh_scontext(vector<string>& words, vector<string>& tags, size_t i,
@@ -218,24 +284,32 @@ inline void insertCandidate(string& pos, int index, double score,
     unit.previous = cIndex;
 }
 
-POSTagger::POSTagger(const string& model, VTrie* pTrie, bool loadModel )
-        : isInnerTrie_(false){
+POSTagger::POSTagger(const string& model, VTrie* pTrie, POSTable* posTable,
+        bool loadModel, WeightType weightType )
+        : posTable_(posTable), isInnerPOSTable_(false), trie_(pTrie),
+        isInnerTrie_(false), trieDict_(pTrie), dict_(&trieDict_){
     if( loadModel )
     {
         me.load( model );
+        me.quantize( weightType );
+        map_outcome_codes();
     }
 
     assert(pTrie);
-    trie_ = pTrie;
+    assert(posTable);
     posVec_.reserve( 410000 );
     //reserved the location offset 0
     posVec_.push_back( POSUnitType() );
+    updatePOSCodes();
 }
 
-POSTagger::POSTagger(const string& model, const char* dictFile) : isInnerTrie_(true){
+POSTagger::POSTagger(const string& model, const char* dictFile)
+        : posTable_(new POSTable), isInnerPOSTable_(true), trie_(new VTrie()),
+        isInnerTrie_(true), trieDict_(trie_), dict_(&trieDict_){
     me.load(model);
+    map_outcome_codes();
+    updatePOSCodes();
 
-    trie_ = new VTrie();
     //reserved the location offset 0
     posVec_.push_back( POSUnitType() );
     ifstream in(dictFile);
@@ -251,6 +325,56 @@ POSTagger::POSTagger(const string& model, const char* dictFile) : isInnerTrie_(t
 POSTagger::~POSTagger(){
     if(isInnerTrie_)
         delete trie_;
+    if(isInnerPOSTable_)
+        delete posTable_;
+}
+
+void POSTagger::updatePOSCodes()
+{
+    defaultCode_ = getSpecialCode( defaultPOS );
+    numberCode_ = getSpecialCode( numberPOS );
+    letterCode_ = getSpecialCode( letterPOS );
+    mixedNumberLetterCode_ = getSpecialCode( mixedNumberLetterPOS );
+    puncCode_ = getSpecialCode( puncPOS );
+    dateCode_ = getSpecialCode( datePOS );
+}
+
+void POSTagger::map_outcome_codes()
+{
+    size_t outSize = me.outcome_size();
+    outcomeCodes_.assign( outSize, -1 );
+    for( size_t k = 0; k < outSize; ++k )
+    {
+        int code = posTable_->getCodeFromStr( me.outcome_name( k ) );
+        if( code >= POSUnitType::MAX_CODE )
+        {
+            cerr << "[Warning] the POS " << me.outcome_name( k ) << " is ignored, only "
+                    << POSUnitType::MAX_CODE << " POS tags are supported." << endl;
+            continue;
+        }
+        outcomeCodes_[ k ] = code;
+    }
+}
+
+int POSTagger::getSpecialCode( const string& pos )
+{
+    // a special tag not set yet is output as an empty tag
+    return pos.empty() ? -1 : posTable_->getCodeFromStr( pos );
+}
+
+const char* POSTagger::getTagName( int code ) const
+{
+    return code == POS_BOUNDARY_CODE ? POS_BOUNDARY_CSTR : posTable_->getStrFromCode( code );
+}
+
+void POSTagger::addWordPOS( POSUnitType& posSet, const char* pos )
+{
+    int code = posTable_->getCodeFromStr( pos );
+    if( posSet.insert( code ) == false )
+    {
+        cerr << "[Warning] the POS " << pos << " is ignored, only "
+                << POSUnitType::MAX_CODE << " POS tags are supported." << endl;
+    }
 }
 
 void POSTagger::tag_word(vector<string>& words, int index, size_t N,
@@ -259,7 +383,7 @@ void POSTagger::tag_word(vector<string>& words, int index, size_t N,
     vector<string> context;
 
     VTrieNode node;
-    trie_->search( words[index].data(), &node );
+    dict_->search( words[index].data(), &node );
 
     bool exists = node.data > 0;
     string& tag_1 = index > 0 ? tags[index-1] : POS_BOUNDARY;
@@ -275,7 +399,7 @@ void POSTagger::tag_word(vector<string>& words, int index, size_t N,
         for(size_t i=0; i<outSize; ++i){
             pair<outcome_type, double>& pair = outcomes[i];
             //whether exists such pos
-            if( posSet.contains( pair.first.c_str() ) == true )
+            if( posSet.contains( outcomeCodes_[ i ] ) == true )
                 continue;
             double score = pair.second * initScore;
             if(canSize >= N && score <= candidates[lastIndex].score)
@@ -435,17 +559,44 @@ void POSTagger::tag_sentence_best(
         size_t wordBeginIdx,
         size_t wordEngIdx,
         size_t seqStartIdx,
-        PGenericArray< const char* >& posRet
+        PGenericArray< int >& posRet
+        )
+{
+    tag_words_best( words, segSeq, types, wordBeginIdx, wordEngIdx, seqStartIdx,
+            wordBeginIdx, wordEngIdx, POS_BOUNDARY_CODE, POS_BOUNDARY_CODE, posRet );
+}
+
+int POSTagger::getBoundaryTag()
+{
+    return POS_BOUNDARY_CODE;
+}
+
+size_t POSTagger::tag_words_best(
+        StringVectorType& words,
+        PGenericArray<size_t>& segSeq,
+        CharType* types,
+        size_t wordBeginIdx,
+        size_t wordEngIdx,
+        size_t seqStartIdx,
+        size_t beginIdx,
+        size_t endIdx,
+        int prevTag_2,
+        int prevTag_1,
+        PGenericArray< int >& posRet
         )
 {
     int word2SeqIdxOffset = (int)seqStartIdx - (int)wordBeginIdx * 2;
-    posRet.reserve( posRet.usedLen() + wordEngIdx - wordBeginIdx );
+    // the tag of the word index is kept in posRet[ index + posOffset ]
+    int posOffset = (int)posRet.size() - (int)beginIdx;
+    posRet.reserve( posRet.usedLen() + endIdx - beginIdx );
 
     CMA_WType wtype(ctype_);
     vector<string> context;
-    int posIndex = -1;
+    vector<MaxentModel::pred_id_type> pids;
+    vector<double> probs( me.outcome_size() );
 
-    for( size_t index = wordBeginIdx; index < wordEngIdx; ++index )
+    size_t index = beginIdx;
+    for( ; index < endIdx; ++index )
     {
         size_t seqIdx = index * 2 + word2SeqIdxOffset;
         size_t seqWordBeginIdx = segSeq[ seqIdx ];
@@ -455,79 +606,233 @@ void POSTagger::tag_sentence_best(
         if( seqWordEndIdx <= seqWordBeginIdx )
             break;
 
-        CMA_WType::WordType wordT = wtype.getWordType( types, seqWordBeginIdx, seqWordEndIdx );
-
-        switch(wordT){
-            case CMA_WType::WORD_TYPE_PUNC:
-                posRet.push_back( puncPOS.c_str() );
-                continue;
-            case CMA_WType::WORD_TYPE_NUMBER:
-                posRet.push_back( numberPOS.c_str() );
-                continue;
-            case CMA_WType::WORD_TYPE_LETTER:
-                posRet.push_back( letterPOS.c_str() );
-                continue;
-            case CMA_WType::WORD_TYPE_DATE:
-                posRet.push_back( datePOS.c_str() );
-                continue;
-            default:
-                break;
-        }
-
-        VTrieNode node;
-        trie_->search( words[ index ], &node );
-        if( node.data < 0 )
-        {
-            posRet.push_back( defaultPOS.c_str() );
-            continue;
-        }
-
-        POSUnitType& posSet = posVec_[node.data];
-        if( posSet.empty() == true )
-        {
-            posRet.push_back( defaultPOS.c_str() );
-            continue;
-        }
-        else if( posSet.size() == 1 )
+        int pos = -1;
+        const POSUnitType* posSet = get_fixed_pos( words, types, wtype, index,
+                seqWordBeginIdx, seqWordEndIdx, pos );
+        if( posSet == NULL )
         {
-            posRet.push_back( posSet[ 0 ] );
+            posRet.push_back( pos );
             continue;
         }
 
-        const char* pos = NULL;
         context.clear();
-        const char* tag_1 = index > wordBeginIdx ? posRet[ index - 1 ] : POS_BOUNDARY_CSTR;
-        const char* tag_2 = index > wordBeginIdx + 1 ? posRet[ index - 2 ] : POS_BOUNDARY_CSTR;
+        int tag_1 = index > beginIdx ? posRet[ index - 1 + posOffset ] : prevTag_1;
+        int tag_2 = index > beginIdx + 1 ? posRet[ index - 2 + posOffset ] :
+                ( index > beginIdx ? prevTag_1 : prevTag_2 );
 		
 		
 		//cout << tag_1 << ", ";
 		//cout << tag_2 << endl;
         posinner::get_pos_zh_scontext_postagger(
-                words, tag_1, tag_2, index, wordEngIdx, context );
+                words, getTagName( tag_1 ), getTagName( tag_2 ), index, wordEngIdx, context );
 
-        vector<pair<outcome_type, double> > outcomes;
-        me.eval_all(context, outcomes, false);
+        posinner::eval_pos_context( me, context, pids, &probs[0] );
 
-        //find the best pos
+        //find the best pos among the candidate tags of the word
         double bestScore = -1.0;
-        size_t outSize = outcomes.size();
+        size_t outSize = probs.size();
+        pos = defaultCode_;
 
         for( size_t k=0; k<outSize; ++k )
         {
-            pair<outcome_type, double>& pair = outcomes[k];
-            if( pair.second > bestScore && ( posIndex = posSet.index( pair.first.c_str() ) >= 0 ) )
+            if( probs[k] > bestScore && posSet->contains( outcomeCodes_[ k ] ) )
             {
-                bestScore = pair.second;
-                pos = posSet[ posIndex ];
+                bestScore = probs[k];
+                pos = outcomeCodes_[ k ];
             }
         }
+        posRet.push_back(pos);
+    }
 
-        if( pos == NULL )
+    return index;
+}
+
+const POSTagger::POSUnitType* POSTagger::get_fixed_pos(
+        StringVectorType& words,
+        CharType* types,
+        CMA_WType& wtype,
+        size_t index,
+        size_t seqWordBeginIdx,
+        size_t seqWordEndIdx,
+        int& pos
+        )
+{
+    CMA_WType::WordType wordT = wtype.getWordType( types, seqWordBeginIdx, seqWordEndIdx );
+
+    switch(wordT){
+        case CMA_WType::WORD_TYPE_PUNC:
+            pos = puncCode_;
+            return NULL;
+        case CMA_WType::WORD_TYPE_NUMBER:
+            pos = numberCode_;
+            return NULL;
+        case CMA_WType::WORD_TYPE_LETTER:
+            pos = letterCode_;
+            return NULL;
+        case CMA_WType::WORD_TYPE_DATE:
+            pos = dateCode_;
+            return NULL;
+        default:
+            break;
+    }
+
+    pos = defaultCode_;
+    VTrieNode node;
+    dict_->search( words[ index ], &node );
+    if( node.data < 0 )
+        return NULL;
+
+    const POSUnitType* posSet = &posVec_[node.data];
+    if( posSet->empty() == true )
+        return NULL;
+    else if( posSet->size() == 1 )
+    {
+        pos = posSet->first();
+        return NULL;
+    }
+    return posSet;
+}
+
+void POSTagger::tag_sentence_beam(
+        StringVectorType& words,
+        PGenericArray<size_t>& segSeq,
+        CharType* types,
+        size_t wordBeginIdx,
+        size_t wordEngIdx,
+        size_t seqStartIdx,
+        size_t beamWidth,
+        POSBeam& beam,
+        PGenericArray< int >& posRet
+        )
+{
+    int word2SeqIdxOffset = (int)seqStartIdx - (int)wordBeginIdx * 2;
+    CMA_WType wtype(ctype_);
+    size_t outSize = me.outcome_size();
+    beam.wordScores.resize( outSize );
+    beam.probs.resize( outSize );
+
+    // the root node is the boundary before the sentence
+    POSBeam::Node root = { POS_BOUNDARY_CODE, -1, 0.0 };
+    beam.nodes.clear();
+    beam.nodes.push_back( root );
+    beam.hyps.clear();
+    beam.hyps.push_back( 0 );
+
+    for( size_t index = wordBeginIdx; index < wordEngIdx; ++index )
+    {
+        size_t seqIdx = index * 2 + word2SeqIdxOffset;
+        size_t seqWordBeginIdx = segSeq[ seqIdx ];
+        size_t seqWordEndIdx =  segSeq[ seqIdx + 1 ];
+        if( seqWordEndIdx <= seqWordBeginIdx )
+            break;
+
+        beam.nextHyps.clear();
+        int pos = -1;
+        const POSUnitType* posSet = get_fixed_pos( words, types, wtype, index,
+                seqWordBeginIdx, seqWordEndIdx, pos );
+        beam.cands.clear();
+        if( posSet != NULL )
+        {
+            for( size_t k = 0; k < outSize; ++k )
+            {
+                if( posSet->contains( outcomeCodes_[ k ] ) )
+                    beam.cands.push_back( make_pair( k, outcomeCodes_[ k ] ) );
+            }
+        }
+
+        if( beam.cands.empty() )
         {
-            pos = defaultPOS.c_str();
+            for( size_t h = 0; h < beam.hyps.size(); ++h )
+            {
+                int hyp = beam.hyps[ h ];
+                insert_beam_node( beam, beamWidth, pos, hyp, beam.nodes[ hyp ].score );
+            }
+            beam.hyps.swap( beam.nextHyps );
+            continue;
         }
-        posRet.push_back(pos);
+
+        // the scores of the predicates of the words are shared by all the
+        // tag histories, only the tag predicate is added for each of them
+        posinner::get_pos_word_pids( me, words, index, wordEngIdx, beam.pred, beam.pids );
+        fill( beam.wordScores.begin(), beam.wordScores.end(), 0.0 );
+        me.add_scores( &beam.pids[ 0 ], beam.pids.size(), &beam.wordScores[ 0 ] );
+
+        for( size_t h = 0; h < beam.hyps.size(); ++h )
+        {
+            int hyp = beam.hyps[ h ];
+            int tag_1 = beam.nodes[ hyp ].pos;
+            int previous = beam.nodes[ hyp ].previous;
+            int tag_2 = previous >= 0 ? beam.nodes[ previous ].pos : POS_BOUNDARY_CODE;
+            double score = beam.nodes[ hyp ].score;
+
+            beam.pred.assign( "T-2,-1=" ).append( getTagName( tag_2 ) ).append( "," )
+                    .append( getTagName( tag_1 ) );
+            MaxentModel::pred_id_type pid = me.pred_id( beam.pred );
+            copy( beam.wordScores.begin(), beam.wordScores.end(), beam.probs.begin() );
+            me.add_scores( &pid, 1, &beam.probs[ 0 ] );
+            me.normalize_scores( &beam.probs[ 0 ] );
+
+            for( size_t c = 0; c < beam.cands.size(); ++c )
+            {
+                insert_beam_node( beam, beamWidth, beam.cands[ c ].second, hyp,
+                        score + log( beam.probs[ beam.cands[ c ].first ] ) );
+            }
+        }
+        beam.hyps.swap( beam.nextHyps );
+    }
+
+    int best = beam.hyps[ 0 ];
+    for( size_t h = 1; h < beam.hyps.size(); ++h )
+    {
+        if( beam.nodes[ beam.hyps[ h ] ].score > beam.nodes[ best ].score )
+            best = beam.hyps[ h ];
+    }
+
+    beam.path.clear();
+    for( int n = best; n > 0; n = beam.nodes[ n ].previous )
+        beam.path.push_back( beam.nodes[ n ].pos );
+
+    posRet.reserve( posRet.usedLen() + beam.path.size() );
+    for( size_t i = beam.path.size(); i > 0; --i )
+        posRet.push_back( beam.path[ i - 1 ] );
+}
+
+void POSTagger::insert_beam_node(
+        POSBeam& beam,
+        size_t beamWidth,
+        int pos,
+        int previous,
+        double score
+        )
+{
+    vector< int >& hyps = beam.nextHyps;
+    int tag_1 = beam.nodes[ previous ].pos;
+    size_t worst = 0;
+    for( size_t i = 0; i < hyps.size(); ++i )
+    {
+        POSBeam::Node& node = beam.nodes[ hyps[ i ] ];
+        if( node.pos == pos && beam.nodes[ node.previous ].pos == tag_1 )
+        {
+            if( score > node.score )
+            {
+                node.previous = previous;
+                node.score = score;
+            }
+            return;
+        }
+        if( node.score < beam.nodes[ hyps[ worst ] ].score )
+            worst = i;
     }
+
+    if( hyps.size() >= beamWidth && score <= beam.nodes[ hyps[ worst ] ].score )
+        return;
+
+    POSBeam::Node node = { pos, previous, score };
+    beam.nodes.push_back( node );
+    if( hyps.size() >= beamWidth )
+        hyps[ worst ] = (int)beam.nodes.size() - 1;
+    else
+        hyps.push_back( (int)beam.nodes.size() - 1 );
 }
 
 void POSTagger::quick_tag_sentence_best(
@@ -537,7 +842,7 @@ void POSTagger::quick_tag_sentence_best(
         size_t wordBeginIdx,
         size_t wordEngIdx,
         size_t seqStartIdx,
-        PGenericArray< const char* >& posRet,
+        PGenericArray< int >& posRet,
         bool tagLetterNumber
         )
 {
@@ -556,19 +861,19 @@ void POSTagger::quick_tag_sentence_best(
 
         switch(wordT){
             case CMA_WType::WORD_TYPE_PUNC:
-                posRet.push_back( puncPOS.c_str() );
+                posRet.push_back( puncCode_ );
                 continue;
             case CMA_WType::WORD_TYPE_NUMBER:
-                posRet.push_back( numberPOS.c_str() );
+                posRet.push_back( numberCode_ );
                 continue;
             case CMA_WType::WORD_TYPE_LETTER:
                 if (tagLetterNumber && wtype.isLetterMixNumber(types, seqWordBeginIdx, seqWordEndIdx))
-                    posRet.push_back(mixedNumberLetterPOS.c_str());
+                    posRet.push_back( mixedNumberLetterCode_ );
                 else
-                    posRet.push_back( letterPOS.c_str() );
+                    posRet.push_back( letterCode_ );
                 continue;
             case CMA_WType::WORD_TYPE_DATE:
-                posRet.push_back( datePOS.c_str() );
+                posRet.push_back( dateCode_ );
                 continue;
             default:
                 break;
@@ -576,18 +881,18 @@ void POSTagger::quick_tag_sentence_best(
 
         const char* word = words[ index ];
         VTrieNode node;
-        trie_->search( word, &node );
+        dict_->search( word, &node );
         if( node.data > 0 )
         {
             POSUnitType& posSet = posVec_[node.data];
             if( posSet.empty() == false )
             {
-                posRet.push_back( posSet[ 0 ] );
+                posRet.push_back( posSet.first() );
                 continue;
             }
         }
 
-        posRet.push_back( defaultPOS.c_str() );
+        posRet.push_back( defaultCode_ );
     }
 }
 
@@ -623,19 +928,9 @@ bool POSTagger::appendWordPOS(string& line)
         trie_->insert(word.data(), &node);
     }
 
-    if( posSet->empty() == true )
+    for( size_t i = 1; i < n; ++i )
     {
-        tokens.removeHead();
-        posSet->swap( tokens );
-    }
-    else
-    {
-        for( size_t i = 1; i < n; ++i )
-        {
-            const char* str = tokens[ i ];
-            if( posSet->contains( str ) == false )
-                posSet->push_back( tokens[ i ] ) ;
-        }
+        addWordPOS( *posSet, tokens[ i ] );
     }
 
     return true;
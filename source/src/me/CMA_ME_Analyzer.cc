@@ -19,6 +19,9 @@
 #include "icma/util/StrBasedVTrie.h"
 #include "icma/util/CateStrTokenizer.h"
 #include "icma/util/tokenizer.h"
+#include "icma/util/LinePipeline.h"
+#include "icma/util/LineReader.h"
+#include "icma/util/WorkStealingPool.h"
 
 #include "icma/fmincover/analysis_fmincover.h"
 
@@ -42,11 +45,16 @@ inline bool isSameSegment(
     if( sent.getCount( idx1 ) != sent.getCount( idx2 ) )
         return false;
 
+    // compare the bytes in the raw string, so that the strings of the
+    // morphemes are not created if only the spans are kept
+    const char* raw = sent.getString();
     size_t size = sent.getCount( idx1 );
     for( size_t i = 0; i < size; ++i )
     {
-        if( strcmp( sent.getLexicon( idx1, i ),
-                sent.getLexicon( idx2, i ) ) != 0 )
+        size_t len = sent.getByteLength( idx1, i );
+        if( len != sent.getByteLength( idx2, i ) ||
+                memcmp( raw + sent.getByteOffset( idx1, i ),
+                raw + sent.getByteOffset( idx2, i ), len ) != 0 )
             return false;
     }
 
@@ -63,6 +71,79 @@ inline bool isSameSegment(
     return true;
 }
 
+/** the pieces for each thread to split a long input */
+const size_t PIECES_PER_THREAD = 4;
+
+/** the least characters in a piece of a long input */
+const size_t MIN_PIECE_CHARS = 256;
+
+/**
+ * the words tagged before each piece to guess the tags of the two words
+ * before it, which the POS tagging of the piece depends on
+ */
+const size_t POS_WARMUP_WORDS = 8;
+
+/**
+ * Split [ 0, size ) into about \e pieceNum pieces, each piece except the last
+ * one ends after a unit that \e isSeparator( unit ) is true.
+ * \param bounds to keep the boundaries of the pieces, begins with 0 and ends
+ *        with \e size
+ */
+template< typename SeparatorFunc >
+inline void splitPieces(
+        size_t size,
+        size_t pieceNum,
+        size_t minPieceSize,
+        SeparatorFunc isSeparator,
+        std::vector< size_t >& bounds
+        )
+{
+    bounds.clear();
+    bounds.push_back( 0 );
+    size_t pieceSize = pieceNum > 0 ? ( size + pieceNum - 1 ) / pieceNum : size;
+    if( pieceSize < minPieceSize )
+        pieceSize = minPieceSize;
+
+    size_t begin = 0;
+    while( size - begin > pieceSize )
+    {
+        size_t i = begin + pieceSize - 1;
+        while( i < size && isSeparator( i ) == false )
+            ++i;
+        // no more separator, or the last piece
+        if( i + 1 >= size )
+            break;
+        begin = i + 1;
+        bounds.push_back( begin );
+    }
+    bounds.push_back( size );
+}
+
+/**
+ * Copy the elements of a result array into the cached vector
+ */
+template< typename ArrayT, typename T >
+inline void copyArray( const ArrayT& from, std::vector< T >& to )
+{
+    size_t size = from.size();
+    to.reserve( size );
+    for( size_t i = 0; i < size; ++i )
+        to.push_back( from[ i ] );
+}
+
+/**
+ * Copy the elements of a cached vector into the result array
+ */
+template< typename T, typename ArrayT >
+inline void copyArray( const std::vector< T >& from, ArrayT& to )
+{
+    size_t size = from.size();
+    to.clear();
+    to.reserve( size );
+    for( size_t i = 0; i < size; ++i )
+        to.push_back( from[ i ] );
+}
+
 inline void removeDuplicatedSegment(
         Sentence& sent,
         bool includePOS
@@ -139,6 +220,10 @@ inline void removeDuplicatedSegment(
             else
                 analysis = &CMA_ME_Analyzer::analysis_mmmodel;
         }
+        else if( nOption == OPTION_TYPE_CACHE_SIZE )
+        {
+            cache_.setCapacity( nValue > 0 ? static_cast<size_t>(nValue) : 0 );
+        }
     }
 
     void CMA_ME_Analyzer::setAnalOption(AnalOptionType analOption, bool bValue)
@@ -150,17 +235,25 @@ inline void removeDuplicatedSegment(
     }
 
     int CMA_ME_Analyzer::runWithSentence(Sentence& sentence)
+    {
+        return runWithSentence( sentence, AnalysisContext::local() );
+    }
+
+    int CMA_ME_Analyzer::runWithSentence(Sentence& sentence, AnalysisContext& context)
     {
         static const MorphemeList DefMorphemeList;
         static const Morpheme DefMorp;
-        if( strlen( sentence.getString() ) == 0 )
+        const char* str = sentence.getString();
+        size_t len = strlen( str );
+        if( len == 0 )
         	return 1;
         int N = (int) getOption(OPTION_TYPE_NBEST);
 
         bool printPOS = getOption(OPTION_TYPE_POS_TAGGING) > 0;
 
-
-        (this->*analysis)(analOption_, sentence.getString(), N, sentence, printPOS);
+        // the POS tagger needs the strings
+        sentence.spanOnly_ = printPOS == false && getOption(OPTION_TYPE_SPAN_ONLY) > 0;
+        analyze(context, str, len, N, sentence, printPOS, true);
 
         size_t size = sentence.getListSize();
         sentence.candidates_.reserve( size );
@@ -177,7 +270,7 @@ inline void removeDuplicatedSegment(
                 for ( size_t j = 0; j < posSize; ++j )
                 {
                     Morpheme& morp = list[ j ];
-                    morp.posCode_ = posTable_->getCodeFromStr( sentence.getStrPOS( 0, j ) );
+                    morp.posCode_ = sentence.pos_[ sentence.candMetas_[ 0 ].posOffset_ + j ];
                     morp.isIndexed = posTable_->isIndexPOS( morp.posCode_ );
                 }
 			}
@@ -202,7 +295,7 @@ inline void removeDuplicatedSegment(
                 for ( size_t j = 0; j < posSize; ++j )
                 {
                     Morpheme& morp = list[ j ];
-                    morp.posCode_ = posTable_->getCodeFromStr( sentence.getStrPOS( i, j ) );
+                    morp.posCode_ = sentence.pos_[ sentence.candMetas_[ i ].posOffset_ + j ];
                     morp.isIndexed = posTable_->isIndexPOS( morp.posCode_ );
                 }
             }
@@ -220,13 +313,112 @@ inline void removeDuplicatedSegment(
 
     }
 
+    int CMA_ME_Analyzer::tagTokens(const std::vector<std::string>& tokens, Sentence& sentence)
+    {
+        return tagTokens( tokens, sentence, AnalysisContext::local() );
+    }
+
+    int CMA_ME_Analyzer::tagTokens(const std::vector<std::string>& tokens, Sentence& sentence,
+            AnalysisContext& context)
+    {
+        static const MorphemeList DefMorphemeList;
+        static const Morpheme DefMorp;
+        static CandidateMeta DefCandidateMeta;
+
+        if( knowledge_ == 0 || knowledge_->isSupportPOS() == false )
+            return 0;
+
+        // the tokens joined, and the byte offset where each token ends
+        string& raw = context.strBuf_;
+        raw.clear();
+        PGenericArray<size_t>& tokenEnds = context.offsets_;
+        tokenEnds.clear();
+        tokenEnds.reserve( tokens.size() );
+        for( size_t i = 0; i < tokens.size(); ++i )
+        {
+            if( tokens[ i ].empty() )
+                continue;
+            raw += tokens[ i ];
+            tokenEnds.push_back( raw.size() );
+        }
+        sentence.setString( raw.c_str(), raw.size() );
+        sentence.spanOnly_ = false;
+        sentence.posTable_ = posTable_;
+        if( raw.empty() )
+            return 1;
+
+        // the characters are still needed for their types, which are the
+        // features of the POS model
+        StringVectorType& words = context.chars_;
+        words.clear();
+        size_t charBase = extractCharacter( raw.data(), raw.size(), words );
+        if( words.empty() == true )
+            return 1;
+
+        CharType* types = getTypeBuffer( context, words.size() );
+        setCharType( words, types );
+
+        // each token ends after the character reaching its last byte
+        PGenericArray<size_t>& segment = context.segment_;
+        segment.clear();
+        segment.reserve( tokenEnds.size() * 2 );
+        // like createStringLexicon, each character is copied with a tailing '\0'
+        const char* firstChar = words[ 0 ];
+        size_t wordNum = words.size();
+        size_t wordStart = 0;
+        size_t endNum = tokenEnds.size();
+        size_t endIdx = 0;
+        while( endIdx < endNum && tokenEnds[ endIdx ] <= charBase )
+            ++endIdx;
+        for( size_t i = 0; i < wordNum; ++i )
+        {
+            const char* endChar = i + 1 < wordNum ? words[ i + 1 ] : words.endPtr_;
+            size_t byteEnd = charBase + ( endChar - firstChar ) - ( i + 1 );
+            if( endIdx == endNum || byteEnd < tokenEnds[ endIdx ] )
+                continue;
+            segment.push_back( wordStart );
+            segment.push_back( i + 1 );
+            wordStart = i + 1;
+            while( endIdx < endNum && tokenEnds[ endIdx ] <= byteEnd )
+                ++endIdx;
+        }
+        if( wordStart < wordNum )
+        {
+            segment.push_back( wordStart );
+            segment.push_back( wordNum );
+        }
+
+        VGenericArray< CandidateMeta >& candMeta = sentence.candMetas_;
+        candMeta.push_back( DefCandidateMeta );
+        candMeta[ 0 ].segOffset_ = 0;
+        candMeta[ 0 ].posOffset_ = 0;
+        candMeta[ 0 ].score_ = 1.0;
+        createStringLexicon( words, segment, charBase, sentence, 0, segment.size() );
+
+        size_t posSize = sentence.getCount( 0 );
+        sentence.pos_.reserve( posSize );
+        tagSentence( context, types, segment, sentence, 0, posSize, 0 );
+
+        sentence.addList( DefMorphemeList );
+        MorphemeList& list = *sentence.getMorphemeList( 0 );
+        list.insert( list.end(), posSize, DefMorp );
+        for ( size_t j = 0; j < posSize; ++j )
+        {
+            Morpheme& morp = list[ j ];
+            morp.posCode_ = sentence.pos_[ j ];
+            morp.isIndexed = posTable_->isIndexPOS( morp.posCode_ );
+        }
+
+        return 1;
+    }
+
     int CMA_ME_Analyzer::runWithStream(const char* inFileName, const char* outFileName) {
 
     	assert(inFileName);
     	assert(outFileName);
 
-    	ifstream in(inFileName);
-		if(!in)
+    	LineReader in;
+		if(!in.open(inFileName))
 		{
 			cerr<<"[Error] The input file "<<inFileName<<" not exists!"<<endl;
 			return 0;
@@ -240,59 +432,32 @@ inline void removeDuplicatedSegment(
 		}
 
         bool printPOS = getOption(OPTION_TYPE_POS_TAGGING) > 0;
+        unsigned int threadNum = (unsigned int)getOption(OPTION_TYPE_THREAD_NUM);
 
-        string line;
-        Sentence sent;
-        bool remains = !in.eof();
-        while (remains) {
-            getline(in, line);
-            remains = !in.eof();
-            if (!line.length()) {
-                if( remains )
-					out << endl;
-                continue;
-            }
-            //cout << "#analysis " << line << endl;
-            (this->*analysis)(analOption_, line.data(), 1, sent, printPOS);
-
-            if( sent.getListSize() > 0 )
-            {
-                if (printPOS)
-                {
-                    int maxIndex = sent.getCount( 0 );
-                    for ( int i = 0; i < maxIndex; ++i )
-                    {
-                        const char* lexicon = sent.getLexicon( 0, i );
-                        //if( knowledge_->isStopWord( lexicon ) )
-                        //	continue;
-                        out << lexicon << posDelimiter_ << sent.getStrPOS( 0, i ) << wordDelimiter_;
-                    }
-
-                    if (remains)
-                        out << sentenceDelimiter_ << endl;
-                    else
-                        break;
-                }
-                else
+        if( threadNum != 1 )
+        {
+            // each worker analyzes with the context of its own thread
+            LinePipeline pipeline( threadNum );
+            pipeline.run( in, out, [ this, printPOS ]( LineBatch& batch ) {
+                AnalysisContext& context = AnalysisContext::local();
+                for( size_t i = 0; i < batch.size; ++i )
                 {
-                    int maxIndex = sent.getCount( 0 );
-                    for (int i = 0; i < maxIndex; ++i)
-                    {
-                        const char* lexicon = sent.getLexicon( 0, i );
-                        //if( knowledge_->isStopWord( lexicon) )
-                        //	continue;
-                        out << lexicon << wordDelimiter_;
-                    }
-
-                    if (remains)
-                        out << sentenceDelimiter_ << endl;
-                    else
-                        break;
+                    printStreamLine( batch.lines[ i ], batch.lengths[ i ],
+                            batch.remains[ i ] != 0, printPOS, context, batch.output );
                 }
-            }
-            else if( remains )
-            {
-                out << endl;
+            } );
+        }
+        else
+        {
+            AnalysisContext& context = AnalysisContext::local();
+            const char* line;
+            size_t len;
+            bool remains;
+            string buf;
+            while( in.next( line, len, remains ) ) {
+                buf.clear();
+                printStreamLine( line, len, remains, printPOS, context, buf );
+                out.write( buf.data(), buf.size() );
             }
         }
 
@@ -302,44 +467,214 @@ inline void removeDuplicatedSegment(
         return 1;
     }
 
+    void CMA_ME_Analyzer::printStreamLine(
+            const char* line,
+            size_t len,
+            bool remains,
+            bool printPOS,
+            AnalysisContext& context,
+            string& out
+            )
+    {
+        if( len == 0 )
+        {
+            if( remains )
+                out.push_back( '\n' );
+            return;
+        }
+
+        // the result is printed from the spans in the line directly
+        Sentence& sent = context.sentence_;
+        sent.setString( "" );
+        sent.spanOnly_ = printPOS == false;
+        analyze(context, line, len, 1, sent, printPOS, false);
+
+        if( sent.getListSize() > 0 )
+        {
+            printOneBest( sent, line, printPOS, out );
+            if( remains )
+                out.append( sentenceDelimiter_ ).push_back( '\n' );
+        }
+        else if( remains )
+        {
+            out.push_back( '\n' );
+        }
+    }
+
     const char* CMA_ME_Analyzer::runWithString(const char* inStr) {
-    	strBuf_.clear();
+        return runWithString( inStr, strlen( inStr ), AnalysisContext::local() );
+    }
 
-    	if( strlen( inStr ) == 0 )
-    	      return strBuf_.c_str();
+    const char* CMA_ME_Analyzer::runWithString(const char* inStr, AnalysisContext& context) {
+        return runWithString( inStr, strlen( inStr ), context );
+    }
 
-    	bool printPOS = getOption(OPTION_TYPE_POS_TAGGING) > 0;
-      
-        Sentence sent;
-        (this->*analysis)(analOption_, inStr, 1, sent, printPOS);
+    const char* CMA_ME_Analyzer::runWithString(const char* inStr, size_t len) {
+        return runWithString( inStr, len, AnalysisContext::local() );
+    }
 
-        if( sent.getListSize() > 0 )
+    const char* CMA_ME_Analyzer::runWithString(const char* inStr, size_t len, AnalysisContext& context) {
+        string& strBuf = context.strBuf_;
+        strBuf.clear();
+
+        if( len == 0 )
+            return strBuf.c_str();
+
+        bool printPOS = getOption(OPTION_TYPE_POS_TAGGING) > 0;
+
+        Sentence& sent = context.sentence_;
+        sent.setString( "" );
+        sent.spanOnly_ = printPOS == false;
+        analyze(context, inStr, len, 1, sent, printPOS, true);
+
+        printOneBest( sent, inStr, printPOS, strBuf );
+        return strBuf.c_str();
+    }
+
+    int CMA_ME_Analyzer::analyzeTokens(const char* inStr, size_t len, AnalysisContext& context) {
+        PGenericArray< Token >& tokens = context.tokens_;
+        tokens.clear();
+
+        if( len == 0 )
+            return 1;
+
+        bool printPOS = getOption(OPTION_TYPE_POS_TAGGING) > 0;
+
+        Sentence& sent = context.sentence_;
+        sent.setString( "" );
+        sent.spanOnly_ = printPOS == false;
+        analyze(context, inStr, len, 1, sent, printPOS, true);
+
+        if( sent.getListSize() <= 0 )
+            return 1;
+
+        size_t size = sent.getCount( 0 );
+        tokens.reserve( size );
+        const size_t* span = &sent.spans_[ sent.candMetas_[ 0 ].segOffset_ * 2 ];
+        Token token;
+        token.posCode_ = -1;
+        token.isIndexed_ = false;
+        for ( size_t i = 0; i < size; ++i, span += 2 )
         {
-            if (printPOS)
+            token.begin_ = span[ 0 ];
+            token.length_ = span[ 1 ] - span[ 0 ];
+            token.wordOffset_ = sent.getOffset( 0, i );
+            if( printPOS )
             {
-                size_t size = sent.getCount( 0 );
-                for ( size_t i = 0; i < size; ++i )
-                {
-                    const char* lexicon = sent.getLexicon( 0, i );
-                    //if( knowledge_->isStopWord( lexicon ) )
-                    //	continue;
-                    strBuf_.append( lexicon ).append( posDelimiter_ ).
-                          append( sent.getStrPOS( 0, i ) ).append( wordDelimiter_ );
-                }
+                token.posCode_ = sent.pos_[ sent.candMetas_[ 0 ].posOffset_ + i ];
+                token.isIndexed_ = posTable_->isIndexPOS( token.posCode_ );
             }
-            else
+            tokens.push_back( token );
+        }
+
+        return 1;
+    }
+
+    void CMA_ME_Analyzer::analyze(
+            AnalysisContext& context,
+            const char* sentence,
+            size_t len,
+            int N,
+            Sentence& ret,
+            bool tagPOS,
+            bool split
+            )
+    {
+        ret.posTable_ = posTable_;
+        // only the forwards minimum cover creates the word offsets
+        ret.setIncrementedWordOffset( true );
+        context.threadNum_ = 1;
+        double splitLength = getOption( OPTION_TYPE_SPLIT_LENGTH );
+        if( split && !context.batch_ && splitLength > 0 && len >= splitLength )
+        {
+            unsigned int threadNum = (unsigned int)getOption( OPTION_TYPE_THREAD_NUM );
+            context.threadNum_ = threadNum > 0 ? threadNum : WorkStealingPool::hardwareThreadNum();
+        }
+
+        if( cache_.capacity() == 0 )
+        {
+            (this->*analysis)(analOption_, context, sentence, len, N, ret, tagPOS);
+            return;
+        }
+
+        unsigned long long tag = getCacheTag( N, tagPOS );
+        unsigned long version = knowledge_->getVersion();
+        ResultCache< CachedSentence >::ValuePtr cached =
+                cache_.find( tag, sentence, len, version );
+        if( cached )
+        {
+            // the morpheme strings are created from the spans on demand
+            ret.spanOnly_ = true;
+            ret.segment_.clear();
+            cmainner::copyArray( cached->spans, ret.spans_ );
+            cmainner::copyArray( cached->pos, ret.pos_ );
+            cmainner::copyArray( cached->wordOffsets, ret.wordOffset_ );
+            cmainner::copyArray( cached->candMetas, ret.candMetas_ );
+            ret.setIncrementedWordOffset( cached->incrementedWordOffset );
+            return;
+        }
+
+        (this->*analysis)(analOption_, context, sentence, len, N, ret, tagPOS);
+
+        std::shared_ptr< CachedSentence > result( new CachedSentence );
+        cmainner::copyArray( ret.spans_, result->spans );
+        cmainner::copyArray( ret.pos_, result->pos );
+        cmainner::copyArray( ret.wordOffset_, result->wordOffsets );
+        cmainner::copyArray( ret.candMetas_, result->candMetas );
+        result->incrementedWordOffset = ret.isIncrementedWordOffset();
+        cache_.insert( tag, sentence, len, version, result );
+    }
+
+    unsigned long long CMA_ME_Analyzer::getCacheTag( int N, bool tagPOS ) const
+    {
+        unsigned long long tag = static_cast<unsigned int>( static_cast<int>( getOption( OPTION_ANALYSIS_TYPE ) ) );
+        tag = ( tag << 24 ) | ( static_cast<unsigned int>( N ) & 0xffffff );
+        tag = ( tag << 1 ) | ( tagPOS ? 1 : 0 );
+        tag = ( tag << 1 ) | ( analOption_.isMaxMatch ? 1 : 0 );
+        tag = ( tag << 1 ) | ( analOption_.doUnigram ? 1 : 0 );
+        tag = ( tag << 1 ) | ( analOption_.useMaxOffset ? 1 : 0 );
+        tag = ( tag << 1 ) | ( analOption_.noOverlap ? 1 : 0 );
+        tag = ( tag << 1 ) | ( analOption_.mergeAlphaDigit ? 1 : 0 );
+        tag = ( tag << 16 ) | ( static_cast<unsigned int>( getOption( OPTION_TYPE_POS_BEAM_WIDTH ) ) & 0xffff );
+        return tag;
+    }
+
+    void CMA_ME_Analyzer::getCacheStatistics(size_t& hits, size_t& misses, size_t& size) const
+    {
+        cache_.getStatistics( hits, misses, size );
+    }
+
+    void CMA_ME_Analyzer::clearCache()
+    {
+        cache_.clear();
+    }
+
+    void CMA_ME_Analyzer::printOneBest( Sentence& sent, const char* input, bool printPOS, string& out )
+    {
+        if( sent.getListSize() <= 0 )
+            return;
+
+        size_t size = sent.getCount( 0 );
+        const size_t* span = &sent.spans_[ sent.candMetas_[ 0 ].segOffset_ * 2 ];
+        if (printPOS)
+        {
+            for ( size_t i = 0; i < size; ++i, span += 2 )
             {
-                size_t size = sent.getCount( 0 );
-                for ( size_t i = 0; i < size; ++i )
-                {
-                    const char* lexicon = sent.getLexicon( 0, i );
-                    //if( knowledge_->isStopWord( lexicon ) )
-                    //  continue;
-                    strBuf_.append( lexicon ).append( wordDelimiter_ );
-                }
+                //if( knowledge_->isStopWord( lexicon ) )
+                //	continue;
+                out.append( input + span[ 0 ], span[ 1 ] - span[ 0 ] ).append( posDelimiter_ ).
+                      append( sent.getStrPOS( 0, i ) ).append( wordDelimiter_ );
+            }
+        }
+        else
+        {
+            for ( size_t i = 0; i < size; ++i, span += 2 )
+            {
+                //if( knowledge_->isStopWord( lexicon) )
+                //  continue;
+                out.append( input + span[ 0 ], span[ 1 ] - span[ 0 ] ).append( wordDelimiter_ );
             }
         }
-        return strBuf_.c_str();
     }
 
     void CMA_ME_Analyzer::getNGramResult( const char *inStr, int n, vector<string>& output )
@@ -366,6 +701,8 @@ inline void removeDuplicatedSegment(
         posTable_ = knowledge_->getPOSTable();
         ctype_ = CMA_CType::instance(knowledge_->getEncodeType());
         encodeType_ = knowledge_->getEncodeType();
+        // the cached results belong to the previous knowledge
+        cache_.clear();
         if(knowledge_->getPOSTagger())
             knowledge_->getPOSTagger()->setCType(ctype_);
         if(knowledge_->getSegTagger())
@@ -400,7 +737,7 @@ inline void removeDuplicatedSegment(
             {
                 sentenceStr += p;
 
-                result.setString(sentenceStr.c_str());
+                result.setString(sentenceStr.data(), sentenceStr.size());
                 sentences.push_back(result);
 
                 sentenceStr.clear();
@@ -411,7 +748,7 @@ inline void removeDuplicatedSegment(
             {
                 if(! sentenceStr.empty())
                 {
-                    result.setString(sentenceStr.c_str());
+                    result.setString(sentenceStr.data(), sentenceStr.size());
                     sentences.push_back(result);
 
                     sentenceStr.clear();
@@ -426,7 +763,7 @@ inline void removeDuplicatedSegment(
         // in case the last character is not space or sentence separator
         if(! sentenceStr.empty())
         {
-            result.setString(sentenceStr.c_str());
+            result.setString(sentenceStr.data(), sentenceStr.size());
             sentences.push_back(result);
 
             sentenceStr.clear();
@@ -438,7 +775,7 @@ namespace meanainner{
     /**
      * \param lastWordEnd include that index
      */
-    inline void toCombine(VTrie *trie, CMA_CType* type, vector<string>& src,
+    inline void toCombine(const DictTrie* trie, CMA_CType* type, vector<string>& src,
             int begin, int lastWordEnd, vector<string>& dest){
         if(begin == lastWordEnd){
             string& str = src[begin];
@@ -472,7 +809,7 @@ namespace meanainner{
         }
     }
 
-    void combineRetWithTrie(VTrie *trie, vector<string>& src, 
+    void combineRetWithTrie(const DictTrie* trie, vector<string>& src, 
             vector<string>& dest, CMA_CType* type) {
         
         int begin = -1;
@@ -488,11 +825,7 @@ namespace meanainner{
             #endif
 
             size_t strLen = str.length();
-            size_t j = 0;
-            for (; node.moreLong && j < strLen; ++j) {
-                trie->find(str[j], &node);
-                //cout<<"Ret "<<(int)(unsigned char)str[j]<<","<<node<<endl;
-            }
+            size_t j = trie->walk(str.data(), strLen, &node);
 
             #ifdef DEBUG_TRIE_MATCH
             cout<<"Check str "<<str<<",isEnd:"<<(j == strLen)<<node<<endl;
@@ -602,7 +935,7 @@ namespace meanainner{
     }
 
     void combineRetWithTrie(
-            VTrie* trie,
+            const DictTrie* trie,
             StringVectorType& words,
             CharType* types,
             PGenericArray<size_t>& segment,
@@ -701,9 +1034,147 @@ namespace meanainner{
 
 }
 
+    void CMA_ME_Analyzer::segBestWithME(
+            AnalysisContext& context,
+            StringVectorType& words,
+            CharType* types,
+            PGenericArray<size_t>& segment
+            )
+    {
+        SegTagger* segTagger = knowledge_->getSegTagger();
+        POCBest& best = getPOCBest( context );
+        size_t n = words.size();
+        vector< size_t >& bounds = best.bounds;
+        bounds.clear();
+        if( context.threadNum_ > 1 )
+        {
+            cmainner::splitPieces( n, context.threadNum_ * cmainner::PIECES_PER_THREAD,
+                    cmainner::MIN_PIECE_CHARS,
+                    [ this, &words ]( size_t i ) { return ctype_->isSentenceSeparator( words[ i ] ); },
+                    bounds );
+        }
+
+        if( bounds.size() <= 2 )
+        {
+            segTagger->seg_sentence_best_with_me( words, types, segment, best );
+            return;
+        }
+
+        // the context of each character is taken from the whole sentence,
+        // so the POC tags are the same as tagging in one thread, each worker
+        // uses its own buffers
+        WorkStealingPool& pool = getPool( context );
+        if( best.buffers.size() < pool.getThreadNum() )
+            best.buffers.resize( pool.getThreadNum() );
+        best.tags.resize( n );
+        uint8_t* pocRet = best.tags.data();
+        vector< size_t >& weights = best.weights;
+        weights.resize( bounds.size() - 1 );
+        for( size_t i = 0; i < weights.size(); ++i )
+            weights[ i ] = bounds[ i + 1 ] - bounds[ i ];
+        pool.run( weights, [ & ]( size_t piece, unsigned int worker ) {
+            segTagger->tag_poc_best_with_me( words, types, bounds[ piece ],
+                    bounds[ piece + 1 ], pocRet, best.buffers[ worker ] );
+        } );
+
+        segTagger->combine_poc_to_word( words, types, pocRet, segment );
+    }
+
+    void CMA_ME_Analyzer::tagBest(
+            AnalysisContext& context,
+            CharType* types,
+            PGenericArray<size_t>& segment,
+            Sentence& ret
+            )
+    {
+        StringVectorType& chars = context.chars_;
+        StringVectorType& words = ret.segment_;
+        POSTagger* posTagger = knowledge_->getPOSTagger();
+        PGenericArray< int >& pos = ret.pos_;
+        pos.clear();
+        pos.reserve( words.size() );
+        ret.candMetas_[ 0 ].posOffset_ = 0;
+
+        size_t wordEnd = ret.getCount( 0 );
+        vector< size_t > bounds;
+        if( context.threadNum_ > 1 && getOption( OPTION_TYPE_POS_BEAM_WIDTH ) <= 1 )
+        {
+            // a piece ends after the word ending with a sentence separator
+            cmainner::splitPieces( wordEnd, context.threadNum_ * cmainner::PIECES_PER_THREAD,
+                    cmainner::MIN_PIECE_CHARS / 2,
+                    [ this, &chars, &segment ]( size_t i ) {
+                        return ctype_->isSentenceSeparator( chars[ segment[ i * 2 + 1 ] - 1 ] ); },
+                    bounds );
+        }
+
+        if( bounds.size() <= 2 )
+        {
+            tagSentence( context, types, segment, ret, 0, wordEnd, 0 );
+            return;
+        }
+
+        // the tagging of a word depends on the tags of the two words before
+        // it, so each piece but the first starts from a few words earlier to
+        // guess those tags
+        size_t pieceNum = bounds.size() - 1;
+        int boundary = POSTagger::getBoundaryTag();
+        vector< PGenericArray< int > > pieceTags( pieceNum );
+        vector< size_t > starts( pieceNum ), ends( pieceNum ), weights( pieceNum );
+        for( size_t i = 0; i < pieceNum; ++i )
+        {
+            starts[ i ] = bounds[ i ];
+            if( i > 0 )
+            {
+                starts[ i ] = bounds[ i ] > bounds[ i - 1 ] + cmainner::POS_WARMUP_WORDS ?
+                        bounds[ i ] - cmainner::POS_WARMUP_WORDS : bounds[ i - 1 ];
+            }
+            weights[ i ] = bounds[ i + 1 ] - starts[ i ];
+        }
+
+        getPool( context ).run( weights, [ & ]( size_t piece, unsigned int /*worker*/ ) {
+            ends[ piece ] = posTagger->tag_words_best( words, segment, types, 0, wordEnd, 0,
+                    starts[ piece ], bounds[ piece + 1 ], boundary, boundary, pieceTags[ piece ] );
+        } );
+
+        for( size_t i = 0; i < pieceNum; ++i )
+        {
+            // an empty word stops the tagging
+            if( ends[ i ] != bounds[ i + 1 ] )
+            {
+                pos.clear();
+                posTagger->tag_sentence_best( words, segment, types, 0, wordEnd, 0, pos );
+                return;
+            }
+
+            size_t begin = bounds[ i ];
+            size_t warmup = begin - starts[ i ];
+            PGenericArray< int >& tags = pieceTags[ i ];
+            int tag_1 = begin > 0 ? pos[ begin - 1 ] : boundary;
+            int tag_2 = begin > 1 ? pos[ begin - 2 ] : boundary;
+            // the piece is tagged as if the words before starts[ i ] are out
+            // of the sentence
+            int guess_1 = warmup > 0 ? tags[ warmup - 1 ] : boundary;
+            int guess_2 = warmup > 1 ? tags[ warmup - 2 ] : boundary;
+
+            if( guess_1 == tag_1 && guess_2 == tag_2 )
+            {
+                for( size_t j = warmup; j < tags.size(); ++j )
+                    pos.push_back( tags[ j ] );
+            }
+            else
+            {
+                // tag the piece again with the right tags before it
+                posTagger->tag_words_best( words, segment, types, 0, wordEnd, 0,
+                        begin, bounds[ i + 1 ], tag_2, tag_1, pos );
+            }
+        }
+    }
+
     void CMA_ME_Analyzer::analysis_mmmodel(
     		AnalOption& analOption,
+            AnalysisContext& context,
             const char* sentence,
+            size_t len,
             int N,
             Sentence& ret,
             bool tagPOS
@@ -715,40 +1186,45 @@ namespace meanainner{
             N = 20;
 
         // Initial Step 1: split as Chinese Character based
-        StringVectorType words;
-        extractCharacter( sentence, words );
+        StringVectorType& words = context.chars_;
+        words.clear();
+        size_t charBase = extractCharacter( sentence, len, words );
 
         if( words.empty() == true )
             return;
 
         // Initial Step 2nd: set character types
-        CharType* types = new CharType[ (int)words.size() ];
+        CharType* types = getTypeBuffer( context, words.size() );
         setCharType( words, types );
 
 
         VGenericArray< CandidateMeta >& candMeta = ret.candMetas_;
         candMeta.clear();
-        PGenericArray<size_t> segment;
+        PGenericArray<size_t>& segment = context.segment_;
+        segment.clear();
 
         SegTagger* segTagger = knowledge_->getSegTagger();
         if( N == 1 )
         {
-            segTagger->seg_sentence_best_with_me( words, types, segment );
+            segBestWithME( context, words, types, segment );
             candMeta.push_back( DefCandidateMeta );
             candMeta[ 0 ].segOffset_ = 0;
             candMeta[ 0 ].score_ = 1.0;
         }
         else
         {
-            segTagger->seg_sentence( words, types, N, N, segment, candMeta );
+            segTagger->seg_sentence( words, types, N, N, segment, candMeta,
+                    getPOCLattice( context ) );
             N = candMeta.size();
         }
 
-        size_t* offsetArray = new size_t[ N + 1 ];
-        offsetArray[ 0 ] = 0;
-        offsetArray[ N ] = segment.size();
+        PGenericArray<size_t>& offsetArray = context.offsets_;
+        offsetArray.clear();
+        offsetArray.reserve( N + 1 );
+        offsetArray.push_back( 0 );
         for( int i = 1; i < N; ++i )
-            offsetArray[ i ] = candMeta[ i ].segOffset_;
+            offsetArray.push_back( candMeta[ i ].segOffset_ );
+        offsetArray.push_back( segment.size() );
 
 /*
 {
@@ -771,14 +1247,15 @@ namespace meanainner{
 */
 
         // only combine the first result
-        VTrie *trie = knowledge_->getTrie();
+        const DictTrie* trie = knowledge_->getDictTrie();
         meanainner::combineRetWithTrie( trie, words, types, segment,
                 0, offsetArray[ 1 ] );
         ret.segment_.clear();
+        ret.spans_.clear();
         for( int i = 0; i < N; ++i )
         {
-            candMeta[ i ].segOffset_ = ret.segment_.size();
-            createStringLexicon( words, segment, ret.segment_,
+            candMeta[ i ].segOffset_ = ret.spans_.size() / 2;
+            createStringLexicon( words, segment, charBase, ret,
                     offsetArray[ i ], offsetArray[ i + 1 ] );
         }
 
@@ -803,30 +1280,30 @@ namespace meanainner{
 */
 
         if( tagPOS == false )
+            return;
+
+        if( N == 1 )
         {
-            delete[] types;
-            delete[] offsetArray;
+            tagBest( context, types, segment, ret );
             return;
         }
 
         ret.pos_.clear();
         ret.pos_.reserve( ret.segment_.size() );
-        POSTagger* posTagger = knowledge_->getPOSTagger();       
         for ( int i = 0; i < N; ++i )
         {
             CandidateMeta& cm = candMeta[ i ];
             candMeta[ i ].posOffset_ = ret.pos_.size();
-            posTagger->tag_sentence_best( ret.segment_, segment, types,
-                    cm.segOffset_, cm.segOffset_ + ret.getCount( i ), offsetArray[ i ], ret.pos_ );
+            tagSentence( context, types, segment, ret,
+                    cm.segOffset_, cm.segOffset_ + ret.getCount( i ), offsetArray[ i ] );
         }
-
-        delete[] types;
-        delete[] offsetArray;
     }
 
     void CMA_ME_Analyzer::analysis_pure_mmmodel(
     		AnalOption& analOption,
+            AnalysisContext& context,
             const char* sentence,
+            size_t len,
             int N,
             Sentence& ret,
             bool tagPOS
@@ -835,48 +1312,54 @@ namespace meanainner{
         static CandidateMeta DefCandidateMeta;
 
         // Initial Step 1: split as Chinese Character based
-        StringVectorType words;
-        extractCharacter( sentence, words );
+        StringVectorType& words = context.chars_;
+        words.clear();
+        size_t charBase = extractCharacter( sentence, len, words );
 
         if( words.empty() == true )
             return;
 
         // Initial Step 2nd: set character types
-        CharType* types = new CharType[ (int)words.size() ];
+        CharType* types = getTypeBuffer( context, words.size() );
         setCharType( words, types );
 
 
         VGenericArray< CandidateMeta >& candMeta = ret.candMetas_;
         candMeta.clear();
-        PGenericArray<size_t> segment;
+        PGenericArray<size_t>& segment = context.segment_;
+        segment.clear();
 
         SegTagger* segTagger = knowledge_->getSegTagger();
         if( N == 1 )
         {
-            segTagger->seg_sentence_best_with_me( words, types, segment );
+            segBestWithME( context, words, types, segment );
             candMeta.push_back( DefCandidateMeta );
             candMeta[ 0 ].segOffset_ = 0;
             candMeta[ 0 ].score_ = 1.0;
         }
         else
         {
-            segTagger->seg_sentence( words, types, N, N, segment, candMeta );
+            segTagger->seg_sentence( words, types, N, N, segment, candMeta,
+                    getPOCLattice( context ) );
             N = candMeta.size();
         }
 
-        size_t* offsetArray = new size_t[ N + 1 ];
-        offsetArray[ 0 ] = 0;
-        offsetArray[ N ] = segment.size();
+        PGenericArray<size_t>& offsetArray = context.offsets_;
+        offsetArray.clear();
+        offsetArray.reserve( N + 1 );
+        offsetArray.push_back( 0 );
         for( int i = 1; i < N; ++i )
-            offsetArray[ i ] = candMeta[ i ].segOffset_;
+            offsetArray.push_back( candMeta[ i ].segOffset_ );
+        offsetArray.push_back( segment.size() );
 
 
         // only combine the first result
         ret.segment_.clear();
+        ret.spans_.clear();
         for( int i = 0; i < N; ++i )
         {
-            candMeta[ i ].segOffset_ = ret.segment_.size();
-            createStringLexicon( words, segment, ret.segment_,
+            candMeta[ i ].segOffset_ = ret.spans_.size() / 2;
+            createStringLexicon( words, segment, charBase, ret,
                     offsetArray[ i ], offsetArray[ i + 1 ] );
         }
 
@@ -899,30 +1382,30 @@ namespace meanainner{
 */
 
         if( tagPOS == false )
+            return;
+
+        if( N == 1 )
         {
-            delete[] types;
-            delete[] offsetArray;
+            tagBest( context, types, segment, ret );
             return;
         }
 
         ret.pos_.clear();
         ret.pos_.reserve( ret.segment_.size() );
-        POSTagger* posTagger = knowledge_->getPOSTagger();
         for ( int i = 0; i < N; ++i )
         {
             CandidateMeta& cm = candMeta[ i ];
             candMeta[ i ].posOffset_ = ret.pos_.size();
-            posTagger->tag_sentence_best( ret.segment_, segment, types,
-                    cm.segOffset_, cm.segOffset_ + ret.getCount( i ), offsetArray[ i ], ret.pos_ );
+            tagSentence( context, types, segment, ret,
+                    cm.segOffset_, cm.segOffset_ + ret.getCount( i ), offsetArray[ i ] );
         }
-
-        delete[] types;
-        delete[] offsetArray;
     }
 
     void CMA_ME_Analyzer::analysis_fmm(
     		AnalOption& analOption,
+            AnalysisContext& context,
             const char* sentence,
+            size_t len,
             int N,
             Sentence& ret,
             bool tagPOS
@@ -931,15 +1414,16 @@ namespace meanainner{
         static CandidateMeta DefCandidateMeta;
 
         // Initial Step 1: split as Chinese Character based
-        StringVectorType words;
-        extractCharacter( sentence, words );
+        StringVectorType& words = context.chars_;
+        words.clear();
+        size_t charBase = extractCharacter( sentence, len, words );
 
         if( words.empty() == true )
             return;
 
         size_t wordSize = words.size();
         // Initial Step 2nd: set character types
-        CharType* types = new CharType[ (int)wordSize ];
+        CharType* types = getTypeBuffer( context, wordSize );
         setCharType( words, types );
 
         ret.candMetas_.clear();
@@ -948,7 +1432,8 @@ namespace meanainner{
         ret.candMetas_[ 0 ].score_ = 1.0;
 
 
-        PGenericArray<size_t> bestSegSeq;
+        PGenericArray<size_t>& bestSegSeq = context.segment_;
+        bestSegSeq.clear();
         bestSegSeq.reserve( wordSize * 2 );
         for( size_t i = 0; i < wordSize; ++i )
         {
@@ -957,7 +1442,7 @@ namespace meanainner{
         }
 
 
-        VTrie *trie = knowledge_->getTrie();
+        const DictTrie* trie = knowledge_->getDictTrie();
         meanainner::combineRetWithTrie( trie, words, types,
                 bestSegSeq, 0, bestSegSeq.size() );
 
@@ -970,25 +1455,24 @@ namespace meanainner{
 
         // convert to string lexicon
         ret.segment_.clear();
-        createStringLexicon( words, bestSegSeq, ret.segment_, 0, bestSegSeq.size() );
+        ret.spans_.clear();
+        createStringLexicon( words, bestSegSeq, charBase, ret, 0, bestSegSeq.size() );
 
 
         if( tagPOS == false )
-        {
-            delete[] types;
             return;
-        }
 
         ret.candMetas_[ 0 ].posOffset_ = 0;
         ret.pos_.clear();
         knowledge_->getPOSTagger()->quick_tag_sentence_best(
                 ret.segment_, bestSegSeq, types, 0, ret.segment_.size(), 0, ret.pos_ );
-        delete[] types;
     }
 
     void CMA_ME_Analyzer::analysis_dictb(
     		AnalOption& analOption,
+            AnalysisContext& context,
             const char* sentence,
+            size_t len,
             int N,
             Sentence& ret,
             bool tagPOS
@@ -997,7 +1481,7 @@ namespace meanainner{
 #ifndef ON_DEV
         // Initial Step 1: split as Chinese Character based
         vector<string> words;
-        extractCharacter( sentence, words );
+        extractCharacter( sentence, len, words );
 
         if( words.empty() == true )
             return;
@@ -1017,7 +1501,7 @@ namespace meanainner{
         N = segment.size();
         segRet.resize(N);
 
-        VTrie *trie = knowledge_->getTrie();
+        const DictTrie* trie = knowledge_->getDictTrie();
         //TODO, only combine the first result
         for (int i = 0; i < N; ++i) {
             pair<vector<string>, double>& srcPair = segment[i];
@@ -1053,7 +1537,9 @@ namespace meanainner{
 
     void CMA_ME_Analyzer::analysis_fmincover(
     		AnalOption& analOption,
+            AnalysisContext& context,
             const char* sentence,
+            size_t len,
             int N,
             Sentence& ret,
             bool tagPOS
@@ -1064,14 +1550,15 @@ namespace meanainner{
         ret.setIncrementedWordOffset(false);
 
         // Initial Step 1: split as Chinese Character based
-        StringVectorType words;
-        extractCharacter( sentence, words );
+        StringVectorType& words = context.chars_;
+        words.clear();
+        size_t charBase = extractCharacter( sentence, len, words );
 
         if( words.empty() == true )
             return;
 
         // Initial Step 2nd: set character types
-        CharType* types = new CharType[ (int)words.size() ];
+        CharType* types = getTypeBuffer( context, words.size() );
         setCharType( words, types );
 
         ret.candMetas_.clear();
@@ -1079,34 +1566,31 @@ namespace meanainner{
         ret.candMetas_[ 0 ].segOffset_ = 0;
         ret.candMetas_[ 0 ].score_ = 1.0;
 
-        PGenericArray<size_t> bestSegSeq;
+        PGenericArray<size_t>& bestSegSeq = context.segment_;
+        bestSegSeq.clear();
 
-        VTrie *trie = knowledge_->getTrie();
+        const DictTrie* trie = knowledge_->getDictTrie();
         fmincover::parseFMinCoverString(
-                bestSegSeq, words, types, trie, 0, words.size(), analOption );
+                bestSegSeq, words, types, trie, getTrieDAG( context ), 0, words.size(), analOption );
 
         // convert to string lexicon
         ret.segment_.clear();
-        createStringLexicon( words, bestSegSeq, ret.segment_, 0, bestSegSeq.size() );
+        ret.spans_.clear();
+        createStringLexicon( words, bestSegSeq, charBase, ret, 0, bestSegSeq.size() );
 
         ret.candMetas_[ 0 ].wdOffset_ = 0;
         ret.wordOffset_.clear();
-        ret.wordOffset_.reserve( ret.segment_.size() );
+        ret.wordOffset_.reserve( ret.spans_.size() / 2 );
         createWordOffset( bestSegSeq, 0, bestSegSeq.size(), ret.wordOffset_ );
 
 
         if( tagPOS == false )
-        {
-            delete[] types;
             return;
-        }
 
         ret.candMetas_[ 0 ].posOffset_ = 0;
         ret.pos_.clear();
         knowledge_->getPOSTagger()->quick_tag_sentence_best(
                 ret.segment_, bestSegSeq, types, 0, ret.segment_.size(), 0, ret.pos_, analOption.isMaxMatch );
-
-        delete[] types;
     }
     static inline bool IsPossibleChineseWord(CharType ct)
     {
@@ -1115,7 +1599,9 @@ namespace meanainner{
 
     void CMA_ME_Analyzer::analysis_maxprefix(
     		AnalOption& analOption,
+            AnalysisContext& context,
             const char* sentence,
+            size_t len,
             int N,
             Sentence& ret,
             bool tagPOS
@@ -1124,15 +1610,16 @@ namespace meanainner{
         static CandidateMeta DefCandidateMeta;
 
         // Initial Step 1: split as Chinese Character based
-        StringVectorType words;
-        extractCharacter( sentence, words );
+        StringVectorType& words = context.chars_;
+        words.clear();
+        size_t charBase = extractCharacter( sentence, len, words );
 
         if( words.empty() == true )
             return;
 
         size_t wordSize = words.size();
         // Initial Step 2nd: set character types
-        CharType* types = new CharType[ (int)wordSize ];
+        CharType* types = getTypeBuffer( context, wordSize );
         setCharType( words, types );
 
         ret.candMetas_.clear();
@@ -1140,7 +1627,8 @@ namespace meanainner{
         ret.candMetas_[ 0 ].segOffset_ = 0;
         ret.candMetas_[ 0 ].score_ = 1.0;
 
-        PGenericArray<size_t> bestSegSeq;
+        PGenericArray<size_t>& bestSegSeq = context.segment_;
+        bestSegSeq.clear();
         bestSegSeq.reserve( wordSize * 2 );
         //for( size_t i = 0; i < wordSize; ++i )
         //{
@@ -1148,58 +1636,43 @@ namespace meanainner{
         //    bestSegSeq.push_back( i + 1 );
         //}
 
-        VTrie *trie = knowledge_->getTrie();
+        const DictTrie* trie = knowledge_->getDictTrie();
 
         int begin = 0; 
         int end = begin + 1;
         int n = (int)words.size();
-        VTrieNode node;
+        VTrieDAG& dag = getTrieDAG( context );
+        dag.build( trie, words, 0, n );
         // find the maximum prefix matched segment from the dictionary.
         int dic_segnum = 0;
-        while(end <= n) {
-            string longest_prefix;
-            string longest_prefix_innode;
-            int longest_innode_wordend = end;
-            while(end <= n)
+        int spaceIdx = -1;
+        while(begin < n) {
+            // the segment could not cross a space
+            if(spaceIdx < begin)
             {
-                if(types[end - 1] == CHAR_TYPE_SPACE)
-                    break;
-                size_t i = 0;
-                size_t word_len = strlen(words[end - 1]);
-                int isnode = 0;
-                while(i < word_len)
-                {
-                    isnode = trie->find(words[end - 1][i], &node);
-                    if(node.moreLong || isnode > 0)
-                        ++i;
-                    else
-                        break;
-                }
-                if(i < word_len)
-                    break;
-                longest_prefix += words[end - 1];
-                end++;
-                if(isnode > 0)
-                {
-                    longest_prefix_innode = longest_prefix;
-                    longest_innode_wordend = end;
-                }
+                spaceIdx = begin;
+                while(spaceIdx < n && types[spaceIdx] != CHAR_TYPE_SPACE)
+                    ++spaceIdx;
+            }
+            int longest_innode_wordend = 0;
+            const VTrieDAG::Match* matchEnd = dag.matchEnd(begin);
+            for(const VTrieDAG::Match* match = dag.matchBegin(begin); match < matchEnd; ++match)
+            {
+                if((int)match->end <= spaceIdx)
+                    longest_innode_wordend = (int)match->end;
             }
 
-            if(!longest_prefix_innode.empty())
+            if(longest_innode_wordend > 0)
             {
-                //cout<<"longest prefix match in dictionary: "<< longest_prefix_innode << endl;
                 bestSegSeq.push_back(begin);
-                bestSegSeq.push_back(longest_innode_wordend - 1);
-                begin = longest_innode_wordend - 1;
+                bestSegSeq.push_back(longest_innode_wordend);
+                begin = longest_innode_wordend;
                 ++dic_segnum;
             }
             else
             {
                 begin++;
             }
-            node.init();
-            end = begin + 1;
         }
         // find the non-dictionary word and seperate them by space(Chinese to bigram).
         int non_dictionary_segnum = 0;
@@ -1278,13 +1751,13 @@ namespace meanainner{
 
         // convert to string lexicon
         ret.segment_.clear();
-        createStringLexicon( words, bestSegSeq, ret.segment_, 0, dic_segnum*2);
+        ret.spans_.clear();
+        createStringLexicon( words, bestSegSeq, charBase, ret, 0, dic_segnum*2);
         ret.candMetas_.push_back( DefCandidateMeta );
-        ret.candMetas_[ 1 ].segOffset_ = ret.segment_.size();
+        ret.candMetas_[ 1 ].segOffset_ = ret.spans_.size() / 2;
         ret.candMetas_[ 1 ].score_ = 1.0;
-        createStringLexicon( words, bestSegSeq, ret.segment_, dic_segnum*2, bestSegSeq.size() );
+        createStringLexicon( words, bestSegSeq, charBase, ret, dic_segnum*2, bestSegSeq.size() );
 
-        delete[] types;
         return;
     }
 
@@ -1376,26 +1849,39 @@ namespace meanainner{
     	return posTable_->size();
     }
 
-    void CMA_ME_Analyzer::extractCharacter( const char* sentence, StringVectorType& charOut )
+    size_t CMA_ME_Analyzer::extractCharacter( const char* sentence, size_t len, StringVectorType& charOut )
     {
         static const string DefString;
         //static unsigned char sp[2] = {0,0};
 
+        size_t base = 0;
         if( encodeType_ == Knowledge::ENCODE_TYPE_UTF8 )
         {
             const unsigned char *uc = (const unsigned char *)sentence;
-            if( uc[0] == 0xEF && uc[1] == 0xBB && uc[2] == 0xBF )
+            if( len >= 3 && uc[0] == 0xEF && uc[1] == 0xBB && uc[2] == 0xBF )
+            {
                 sentence += 3;
+                len -= 3;
+                base = 3;
+            }
         }
 
-        CMA_CType::getByteCount_t getByteFunc = ctype_->getByteCountFun_;
-        size_t strLen = strlen(sentence);
-        charOut.reserve( strLen * 2 );
-        charOut.reserveOffsetVec( strLen );
-        unsigned int len;
+        CMA_CType::getByteCountN_t getByteFunc = ctype_->getByteCountNFun_;
+        bool asciiSingleByte = ctype_->isAsciiSingleByte();
+        charOut.reserve( len * 2 );
+        charOut.reserveOffsetVec( len );
+        unsigned int charLen;
         const unsigned char *us = (const unsigned char *)sentence;
-        while( ( len = getByteFunc( us ) ) > 0 )
-        {	/*
+        const unsigned char *end = us + len;
+        while( us < end )
+        {
+            // the ASCII runs are common in the mixed text, no need to call
+            // the encoding function for them
+            if( asciiSingleByte && *us != 0 && *us < 0x80 )
+                charLen = 1;
+            else if( ( charLen = getByteFunc( us, end - us ) ) == 0 )
+                break;
+        	/*
         	cout << "len: " << len << " ";
             for (int i=0; i<len; i ++) {
             	cout << (char)*(us+i);
@@ -1416,9 +1902,11 @@ namespace meanainner{
         		//cout << " => to half-width: " << sp << endl;
         	} */
 
-            charOut.push_back( ( const char* )us, len );
-            us += len;
+            charOut.push_back( ( const char* )us, charLen );
+            us += charLen;
         }
+
+        return base;
     }
 
     void CMA_ME_Analyzer::setCharType( StringVectorType& charIn, CharType* types )
@@ -1437,18 +1925,107 @@ namespace meanainner{
         types[ maxWordOff ] = ctype_->getCharType( curChar, preType, 0 );
     }
 
+    CharType* CMA_ME_Analyzer::getTypeBuffer( AnalysisContext& context, size_t size )
+    {
+        PGenericArray< unsigned char >& buf = context.typeBuf_;
+        buf.reserve( size * sizeof( CharType ) );
+        return reinterpret_cast< CharType* >( buf.data_ );
+    }
+
+    POCBest& CMA_ME_Analyzer::getPOCBest( AnalysisContext& context )
+    {
+        if( !context.pocBest_ )
+            context.pocBest_.reset( new POCBest );
+        return *context.pocBest_;
+    }
+
+    POCLattice& CMA_ME_Analyzer::getPOCLattice( AnalysisContext& context )
+    {
+        if( !context.pocLattice_ )
+            context.pocLattice_.reset( new POCLattice );
+        return *context.pocLattice_;
+    }
+
+    POSBeam& CMA_ME_Analyzer::getPOSBeam( AnalysisContext& context )
+    {
+        if( !context.posBeam_ )
+            context.posBeam_.reset( new POSBeam );
+        return *context.posBeam_;
+    }
+
+    VTrieDAG& CMA_ME_Analyzer::getTrieDAG( AnalysisContext& context )
+    {
+        if( !context.trieDAG_ )
+            context.trieDAG_.reset( new VTrieDAG );
+        return *context.trieDAG_;
+    }
+
+    WorkStealingPool& CMA_ME_Analyzer::getPool( AnalysisContext& context )
+    {
+        if( !context.pool_ || context.pool_->getThreadNum() != context.threadNum_ )
+            context.pool_.reset( new WorkStealingPool( context.threadNum_ ) );
+        return *context.pool_;
+    }
+
+    void CMA_ME_Analyzer::tagSentence(
+            AnalysisContext& context,
+            CharType* types,
+            PGenericArray<size_t>& segment,
+            Sentence& ret,
+            size_t wordBeginIdx,
+            size_t wordEndIdx,
+            size_t seqStartIdx
+            )
+    {
+        POSTagger* posTagger = knowledge_->getPOSTagger();
+        size_t beamWidth = (size_t)getOption( OPTION_TYPE_POS_BEAM_WIDTH );
+        if( beamWidth > 1 )
+        {
+            posTagger->tag_sentence_beam( ret.segment_, segment, types, wordBeginIdx, wordEndIdx,
+                    seqStartIdx, beamWidth, getPOSBeam( context ), ret.pos_ );
+            return;
+        }
+        posTagger->tag_sentence_best( ret.segment_, segment, types, wordBeginIdx, wordEndIdx,
+                seqStartIdx, ret.pos_ );
+    }
+
     void CMA_ME_Analyzer::createStringLexicon(
             StringVectorType& words,
             PGenericArray<size_t>& segSeq,
-            StringVectorType& out,
+            size_t charBase,
+            Sentence& ret,
             size_t beginIdx,
             size_t endIdx
             )
     {
+        // the characters are copied from the input one by one, each with a
+        // tailing '\0', so the byte offsets can be got from their positions
+        PGenericArray<size_t>& spans = ret.spans_;
+        spans.reserve( spans.size() + endIdx - beginIdx );
+        const char* firstChar = words[ 0 ];
+        size_t wordNum = words.size();
+        size_t* segSeqItr = &segSeq[ beginIdx ];
+        for( size_t i = beginIdx; i < endIdx; i += 2 )
+        {
+            size_t seqStartIdx = *segSeqItr;
+            ++segSeqItr;
+            size_t seqEndIdx = *segSeqItr;
+            ++segSeqItr;
+            if( seqStartIdx >= seqEndIdx )
+                break;
+            const char* endChar = seqEndIdx < wordNum ? words[ seqEndIdx ] : words.endPtr_;
+            spans.push_back( charBase + ( words[ seqStartIdx ] - firstChar ) - seqStartIdx );
+            spans.push_back( charBase + ( endChar - firstChar ) - seqEndIdx );
+        }
+
+        if( ret.spanOnly_ )
+            return;
+
+        StringVectorType& out = ret.segment_;
         size_t curFreeLen = out.freeLen();
         size_t segSeqSize = ( endIdx - beginIdx ) / 2;
         size_t minLen = 0;
-        size_t* segSeqItr = &segSeq[ beginIdx ];
+        segSeqItr = &segSeq[ beginIdx ];
         // minLen is used collect character number now
         for( size_t i = beginIdx; i < endIdx; i += 2 )
         {
@@ -30,14 +30,29 @@ inline bool fileExists(const char* path)
 	return false;
 }
 
+WeightType CMA_ME_Knowledge::getWeightType() const
+{
+    switch( getModelWeightType() )
+    {
+    case MODEL_WEIGHT_FLOAT16:
+        return WEIGHT_FLOAT16;
+    case MODEL_WEIGHT_INT8:
+        return WEIGHT_INT8;
+    default:
+        return WEIGHT_DOUBLE;
+    }
+}
+
 CMA_ME_Knowledge::CMA_ME_Knowledge()
-		: segT_(0), posT_(0),vsynC_(0),trie_(new VTrie), posTable_(new POSTable){
+		: segT_(0), posT_(0),vsynC_(0),trie_(new VTrie), trieDict_(trie_), datrie_(0),
+		useDATrie_(false), posTable_(new POSTable){
 }
 
 CMA_ME_Knowledge::~CMA_ME_Knowledge(){
     delete segT_;
     delete posT_;
     delete vsynC_;
+    delete datrie_;
     delete trie_;
     delete posTable_;
     //CMA_CType::clear();
@@ -60,7 +75,8 @@ int CMA_ME_Knowledge::loadPOSModel(const char* cateName, bool loadModel)
     }
 
     assert(!posT_);
-    posT_ = new POSTagger((cateStr + ".model").data(), trie_, loadModel );
+    posT_ = new POSTagger((cateStr + ".model").data(), trie_, posTable_,
+            loadModel, getWeightType() );
 
     map<string, string> configMap;
     loadConfig0((cateStr + ".config").data(), configMap, false);
@@ -81,7 +97,10 @@ int CMA_ME_Knowledge::loadPOSModel(const char* cateName, bool loadModel)
 
     ret = configMap["datePOS"];
     posT_->datePOS = ret.empty() ? "T" : ret;
+    posT_->updatePOSCodes();
+    posT_->setDictTrie( getDictTrie() );
 
+    increaseVersion();
     return 1;
 }
 
@@ -103,7 +122,8 @@ int CMA_ME_Knowledge::loadStatModel(const char* cateName, bool loadModel){
 	if( loadModel )
 	{
         assert(!segT_);
-        segT_ = new SegTagger(cateStr, trie_);
+        segT_ = new SegTagger(cateStr, trie_, getWeightType());
+        segT_->setDictTrie( getDictTrie() );
 	}
 
     //try to load black words here
@@ -124,6 +144,7 @@ int CMA_ME_Knowledge::loadStatModel(const char* cateName, bool loadModel){
 		bwIn.close();
 	}
 
+    increaseVersion();
     return 1;
 }
 
@@ -184,6 +205,12 @@ int CMA_ME_Knowledge::loadSystemDict(const char* binFileName){
     	ret += curRet;
     }
 
+    if( ret )
+    {
+        if( datrie_ )
+            updateDictTrie();
+        increaseVersion();
+    }
     return ret;
 }
 
@@ -218,6 +245,12 @@ int CMA_ME_Knowledge::loadUserDict(const char* fileName){
     	ret += curRet;
     }
 
+    if( ret )
+    {
+        if( datrie_ )
+            updateDictTrie();
+        increaseVersion();
+    }
     return ret;
 }
 
@@ -324,6 +357,7 @@ void CMA_ME_Knowledge::disableWords( const vector< string >& words )
 {
     if( trie_ == NULL )
         return;
+    bool changed = false;
     VTrieNode node;
     for( vector< string >::const_iterator itr = words.begin(); itr != words.end(); ++itr )
     {
@@ -336,7 +370,13 @@ void CMA_ME_Knowledge::disableWords( const vector< string >& words )
 
         node.data = -node.data;
         trie_->insert( itr->c_str(), &node );
+        if( datrie_ )
+            datrie_->update( itr->c_str(), node.data );
+        changed = true;
     }
+
+    if( changed )
+        increaseVersion();
 }
 
 /**
@@ -348,6 +388,7 @@ void CMA_ME_Knowledge::enableWords( const vector< string >& words )
 {
     if( trie_ == NULL )
         return;
+    bool changed = false;
     VTrieNode node;
     for( vector< string >::const_iterator itr = words.begin(); itr != words.end(); ++itr )
     {
@@ -360,7 +401,13 @@ void CMA_ME_Knowledge::enableWords( const vector< string >& words )
 
         node.data = -node.data;
         trie_->insert( itr->c_str(), &node );
+        if( datrie_ )
+            datrie_->update( itr->c_str(), node.data );
+        changed = true;
     }
+
+    if( changed )
+        increaseVersion();
 }
 
 string CMA_ME_Knowledge::readEncryptLine(FILE *in){
@@ -413,9 +460,41 @@ int CMA_ME_Knowledge::loadConfig(const char* fileName)
 {
     bool r = loadConfig0( fileName, sysConfig_, true);
 
+    const string* dictTrie = getSystemProperty( "dictionary_trie" );
+    if( dictTrie )
+    {
+        string type = toLower( *dictTrie );
+        if( type == "datrie" || type == "vtrie" )
+            useDATrie_ = type == "datrie";
+        else
+            cerr << "Unknown dictionary_trie " << *dictTrie << ", only vtrie and datrie are supported" << endl;
+    }
+    if( useDATrie_ != ( datrie_ != 0 ) )
+        updateDictTrie();
+
     return r ? 1 : 0;
 }
 
+void CMA_ME_Knowledge::updateDictTrie()
+{
+    if( useDATrie_ )
+    {
+        if( !datrie_ )
+            datrie_ = new DATrie;
+        datrie_->build( *trie_, CMA_CType::instance( getEncodeType() ) );
+    }
+    else
+    {
+        delete datrie_;
+        datrie_ = 0;
+    }
+
+    if( segT_ )
+        segT_->setDictTrie( getDictTrie() );
+    if( posT_ )
+        posT_->setDictTrie( getDictTrie() );
+}
+
 /*
 bool CMA_ME_Knowledge::appendWordPOS(string& line){
     vector<string> tokens;
@@ -514,19 +593,9 @@ bool CMA_ME_Knowledge::appendWordPOS( string& line )
 
     if( posT_ != NULL )
     {
-        if( posSet->empty() == true )
-        {
-            tokens.removeHead();
-            posSet->swap( tokens );
-        }
-        else
+        for( size_t i = 1; i < n; ++i )
         {
-            for( size_t i = 1; i < n; ++i )
-            {
-                const char* str = tokens[ i ];
-                if( posSet->contains( str ) == false )
-                    posSet->push_back( tokens[ i ] ) ;
-            }
+            posT_->addWordPOS( *posSet, tokens[ i ] );
         }
     }
 
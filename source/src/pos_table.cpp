@@ -48,17 +48,16 @@ POSTable::POSTable()
 
 int POSTable::addPOS(const std::string& pos)
 {
-    const char* str = pos.data();
     // check whether has been added before
-    int ret = posMap_.search( str );
-    if( ret > 0 )
+    POSMap::const_iterator itr = posMap_.find( pos );
+    if( itr != posMap_.end() )
     {
-        return ret;
+        return itr->second;
     }
 
     int index = indexedFlags_.size();
-    posMap_.insert( str, index );
-    posTable_.push_back( str );
+    posMap_.insert( POSMap::value_type( pos, index ) );
+    posTable_.push_back( pos.c_str() );
     indexedFlags_.push_back( true );
 
     return index;
@@ -99,8 +98,8 @@ int POSTable::getCodeFromType(POSType type) const
 bool POSTable::isIndexPOS( int posCode ) const
 {
     // Error POS Index return true by default
-    //if(posCode < 0 || indexedFlags_.size() <= (size_t)posCode )
-    //	return true;
+    if(posCode < 0 || indexedFlags_.size() <= (size_t)posCode )
+    	return true;
     return indexedFlags_[ posCode ];
 }
 
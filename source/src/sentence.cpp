@@ -12,23 +12,34 @@
 
 #include <algorithm>
 #include <cassert>
+#include <mutex>
 
 namespace cma
 {
 
+namespace
+{
+/** the lock of the morpheme strings created from the byte spans */
+std::mutex lexiconLock;
+}
+
 Morpheme::Morpheme()
     : posCode_(-1)
 {
 }
 
 Sentence::Sentence()
-    : incrementedWordOffsetB_(true)
+    : spanOnly_(false),
+      posTable_(0),
+      incrementedWordOffsetB_(true)
 {
     //do nothing
 }
 
 Sentence::Sentence(const char* pString)
     : raw_( pString ),
+      spanOnly_(false),
+      posTable_(0),
       incrementedWordOffsetB_(true)
 {
 }
@@ -38,9 +49,23 @@ void Sentence::setString(const char* pString)
     raw_ = pString;
     candidates_.clear();
     segment_.clear();
+    spans_.clear();
     pos_.clear();
     candMetas_.clear();
     wordOffset_.clear();
+    incrementedWordOffsetB_ = true;
+}
+
+void Sentence::setString(const char* pString, size_t len)
+{
+    raw_.assign( pString, len );
+    candidates_.clear();
+    segment_.clear();
+    spans_.clear();
+    pos_.clear();
+    candMetas_.clear();
+    wordOffset_.clear();
+    incrementedWordOffsetB_ = true;
 }
 
 const char* Sentence::getString(void) const
@@ -57,15 +82,44 @@ int Sentence::getCount(int nPos) const
 {
     int listSize = candMetas_.size();
     return ( nPos + 1 >= listSize ) ?
-           ( segment_.size() - candMetas_[ nPos ].segOffset_ ) :
+           ( spans_.size() / 2 - candMetas_[ nPos ].segOffset_ ) :
            ( candMetas_[ nPos + 1 ].segOffset_ - candMetas_[ nPos ].segOffset_ );
 }
 
 const char* Sentence::getLexicon(int nPos, int nIdx) const
 {
+    if( spanOnly_ )
+    {
+        // the const sentence may be read by several threads
+        std::lock_guard< std::mutex > guard( lexiconLock );
+        if( segment_.size() * 2 < spans_.size() )
+            createLexicons();
+    }
     return segment_[ candMetas_[ nPos ].segOffset_ + nIdx ];
 }
 
+size_t Sentence::getByteOffset(int nPos, int nIdx) const
+{
+    return spans_[ ( candMetas_[ nPos ].segOffset_ + nIdx ) * 2 ];
+}
+
+size_t Sentence::getByteLength(int nPos, int nIdx) const
+{
+    size_t idx = ( candMetas_[ nPos ].segOffset_ + nIdx ) * 2;
+    return spans_[ idx + 1 ] - spans_[ idx ];
+}
+
+void Sentence::createLexicons() const
+{
+    size_t size = spans_.size() / 2;
+    segment_.clear();
+    segment_.reserve( raw_.size() + size + 1 );
+    segment_.reserveOffsetVec( size );
+    const char* raw = raw_.data();
+    for( size_t i = 0; i < size; ++i )
+        segment_.push_back( raw + spans_[ i * 2 ], spans_[ i * 2 + 1 ] - spans_[ i * 2 ] );
+}
+
 bool Sentence::isIndexWord(int nPos, int nIdx) const
 {
     return candidates_[nPos][nIdx].isIndexed;
@@ -78,7 +132,9 @@ int Sentence::getPOS(int nPos, int nIdx) const
 
 const char* Sentence::getStrPOS(int nPos, int nIdx) const
 {
-    return pos_[ candMetas_[ nPos ].posOffset_ + nIdx ];
+    if( posTable_ == 0 )
+        return 0;
+    return posTable_->getStrFromCode( pos_[ candMetas_[ nPos ].posOffset_ + nIdx ] );
 }
 
 size_t Sentence::getOffset(int nPos, int nIdx) const
@@ -196,6 +196,60 @@ unsigned int getByteCountUTF8( const unsigned char* uc )
     */
 }
 
+unsigned int getByteCountNBig5( const unsigned char* uc, size_t len )
+{
+    if( len == 0 || uc[0] == 0 )
+        return 0;
+
+    if( uc[0] < 0x80 || len < 2 )
+        return 1; // encoding in ASCII, or truncated
+
+    return 2; // encoding in Big5
+}
+
+unsigned int getByteCountNGB18030( const unsigned char* uc, size_t len )
+{
+    if( len == 0 || uc[0] == 0 )
+        return 0;
+
+    if( uc[0] <= 0x80 || uc[0] == 0xff || len < 2 )
+        return 1;
+
+    if( uc[1] >= 0x40 && uc[1] <= 0xfe && uc[1] != 0x7f )
+        return 2;
+
+    if( len >= 4 && uc[1] >= 0x30 && uc[1] <= 0x39
+            && uc[2] >= 0x81 && uc[2] <= 0xfe && uc[3] >= 0x30 && uc[3] <= 0x39 )
+        return 4;
+
+    return 1;
+}
+
+unsigned int getByteCountNGB2312( const unsigned char* uc, size_t len )
+{
+    if( len == 0 || uc[0] == 0 )
+        return 0;
+
+    if( uc[0] < 0x80 || len < 2 )
+        return 1; // encoding in ASCII, or truncated
+
+    return 2; // encoding in GB2312
+}
+
+unsigned int getByteCountNUTF16( const unsigned char* uc, size_t len )
+{
+    return len < 2 ? (unsigned int)len : 2;
+}
+
+unsigned int getByteCountNUTF8( const unsigned char* uc, size_t len )
+{
+    if( len == 0 )
+        return 0;
+
+    unsigned int ret = UTF8_LEN_CODE[ *uc ];
+    return ret > len ? (unsigned int)len : ret;
+}
+
 int computeMinMod( set<CharValue> inputSet )
 {
     int inputSize = (int)inputSet.size();
@@ -243,15 +297,31 @@ const string DEFAULT_SPACE = " \t\n\x0B\f\r";
 
 map< Knowledge::EncodeType, boost::shared_ptr<CMA_CType> > CTypeCache;
 
+/** the ASCII characters, and the slot of no next character */
+#define ASCII_CHAR_NUM 128
+
+/** the entries of CMA_CType::asciiTypes_ */
+#define ASCII_TYPE_SLOT_NUM ( ASCII_CHAR_NUM * CHAR_TYPE_NUM * ASCII_CHAR_NUM )
+
 CMA_CType::CMA_CType(
     Knowledge::EncodeType type,
-    getByteCount_t getByteCountFun
+    getByteCount_t getByteCountFun,
+    getByteCountN_t getByteCountNFun
 )
     : type_( type ),
-      getByteCountFun_ ( getByteCountFun )
+      getByteCountFun_ ( getByteCountFun ),
+      getByteCountNFun_ ( getByteCountNFun )
 {
     condValues_.reserve( 260 );
     condValues_.push_back( DefCharConditions ); //reserve offset 0
+
+#ifdef USE_UTF_16
+    asciiSingleByte_ = type_ != Knowledge::ENCODE_TYPE_UTF16;
+#else
+    asciiSingleByte_ = true;
+#endif
+    asciiTypes_.reset( new std::atomic< unsigned char >[ ASCII_TYPE_SLOT_NUM ] );
+    clearAsciiTypes();
 }
 
 void CMA_CType::clear()
@@ -274,24 +344,29 @@ CMA_CType* CMA_CType::instance(Knowledge::EncodeType type)
     switch(type)
     {
     case Knowledge::ENCODE_TYPE_GB2312:
-        ret = new CMA_CType( type, &ctypeinner::getByteCountGB2312 );
+        ret = new CMA_CType( type, &ctypeinner::getByteCountGB2312,
+                &ctypeinner::getByteCountNGB2312 );
         break;
 
     case Knowledge::ENCODE_TYPE_BIG5:
-        ret = new CMA_CType( type, &ctypeinner::getByteCountBig5 );
+        ret = new CMA_CType( type, &ctypeinner::getByteCountBig5,
+                &ctypeinner::getByteCountNBig5 );
         break;
 
     case Knowledge::ENCODE_TYPE_GB18030:
-        ret = new CMA_CType( type, &ctypeinner::getByteCountGB18030 );
+        ret = new CMA_CType( type, &ctypeinner::getByteCountGB18030,
+                &ctypeinner::getByteCountNGB18030 );
         break;
 
     case Knowledge::ENCODE_TYPE_UTF8:
-        ret = new CMA_CType( type, &ctypeinner::getByteCountUTF8 );
+        ret = new CMA_CType( type, &ctypeinner::getByteCountUTF8,
+                &ctypeinner::getByteCountNUTF8 );
         break;
 
 #ifdef USE_UTF_16
     case Knowledge::ENCODE_TYPE_UTF16:
-        ret = new CMA_CType( type, &ctypeinner::getByteCountUTF16 );
+        ret = new CMA_CType( type, &ctypeinner::getByteCountUTF16,
+                &ctypeinner::getByteCountNUTF16 );
         break;
 #endif
 
@@ -340,6 +415,12 @@ unsigned int CMA_CType::getByteCount(const char* p) const
     return getByteCountFun_( uc );
 }
 
+unsigned int CMA_CType::getByteCount(const char* p, size_t len) const
+{
+    const unsigned char* uc = (const unsigned char*)p;
+    return getByteCountNFun_( uc, len );
+}
+
 bool CMA_CType::isPunct(const char* p) const
 {
     return getCharType(p, CHAR_TYPE_INIT, 0) == CHAR_TYPE_PUNC;
@@ -623,10 +704,54 @@ int CMA_CType::loadConfiguration( const char* file )
         loadRule( node, tokenizer, ret );
     }
 
+    // the types are matched by the new conditions from now on
+    clearAsciiTypes();
     return 1;
 }
 
+void CMA_CType::clearAsciiTypes()
+{
+    for( int i = 0; i < ASCII_TYPE_SLOT_NUM; ++i )
+        asciiTypes_[ i ].store( 0, std::memory_order_relaxed );
+}
+
+int CMA_CType::getAsciiTypeSlot( const char* p, CharType preType, const char* nextP ) const
+{
+    const unsigned char* uc = (const unsigned char*)p;
+    if( !asciiSingleByte_ || uc[0] == 0 || uc[0] >= 0x80 || uc[1] != 0
+            || preType < 0 || preType >= CHAR_TYPE_NUM )
+        return -1;
+
+    // no next character is the same as an empty one, the slot 0
+    unsigned int next = 0;
+    if( nextP && nextP[0] != 0 )
+    {
+        const unsigned char* nextUC = (const unsigned char*)nextP;
+        if( nextUC[0] >= 0x80 || nextUC[1] != 0 )
+            return -1;
+        next = nextUC[0];
+    }
+
+    return ( uc[0] * CHAR_TYPE_NUM + preType ) * ASCII_CHAR_NUM + next;
+}
+
 CharType CMA_CType::getCharType(const char* p, CharType preType, const char* nextP) const
+{
+    // the ASCII characters are looked up before matching the conditions
+    int slot = getAsciiTypeSlot( p, preType, nextP );
+    if( slot < 0 )
+        return matchCharType( p, preType, nextP );
+
+    unsigned char known = asciiTypes_[ slot ].load( std::memory_order_relaxed );
+    if( known != 0 )
+        return (CharType)( known - 1 );
+
+    CharType ret = matchCharType( p, preType, nextP );
+    asciiTypes_[ slot ].store( (unsigned char)( ret + 1 ), std::memory_order_relaxed );
+    return ret;
+}
+
+CharType CMA_CType::matchCharType(const char* p, CharType preType, const char* nextP) const
 {
     CharValue curV = getEncodeValue(p);
     if( isSpace( curV ) )
@@ -0,0 +1,339 @@
+/**
+ * \file DATrie.cpp
+ * \brief The double-array trie of the dictionary words
+ * \date Oct 17, 2026
+ */
+
+#include "icma/util/DATrie.h"
+#include "icma/type/cma_ctype.h"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+using namespace std;
+
+namespace cma
+{
+
+namespace
+{
+
+/** the bytes of a character of 2 to 4 bytes as a code */
+inline uint32_t packChar( const unsigned char* p, unsigned int bytes )
+{
+    uint32_t code = 0;
+    for( unsigned int i = 0; i < bytes; ++i )
+        code |= (uint32_t)p[ i ] << ( 8 * i );
+    return code;
+}
+
+/**
+ * The words of a VTrie split into characters, the characters of word i are
+ * chars[ begins[ i ], begins[ i + 1 ] ).
+ */
+struct WordCollector
+{
+    const CMA_CType* ctype;
+    vector< uint32_t > chars;
+    vector< size_t > begins;
+    vector< int > values;
+
+    void operator()( const string& key, int value )
+    {
+        size_t begin = chars.size();
+        const char* p = key.c_str();
+        size_t len = key.size();
+        size_t i = 0;
+        while( i < len )
+        {
+            unsigned int bytes = ctype->getByteCount( p + i, len - i );
+            if( bytes == 0 || bytes > 4 )
+            {
+                // not a word of the texts split by ctype
+                chars.resize( begin );
+                return;
+            }
+            chars.push_back( packChar( (const unsigned char*)p + i, bytes ) );
+            i += bytes;
+        }
+        begins.push_back( begin );
+        values.push_back( value );
+    }
+
+    size_t length( size_t word ) const
+    {
+        return ( word + 1 < begins.size() ? begins[ word + 1 ] : chars.size() ) - begins[ word ];
+    }
+
+    const uint32_t* word( size_t word ) const
+    {
+        return chars.data() + begins[ word ];
+    }
+};
+
+/** the order of the words by their character IDs */
+struct WordLess
+{
+    const WordCollector& words;
+
+    bool operator()( size_t a, size_t b ) const
+    {
+        const uint32_t* pa = words.word( a );
+        const uint32_t* pb = words.word( b );
+        return lexicographical_compare( pa, pa + words.length( a ), pb, pb + words.length( b ) );
+    }
+};
+
+/** the words of a node, which share the first \e depth characters */
+struct NodeRange
+{
+    size_t lo;
+    size_t hi;
+    size_t depth;
+    int32_t node;
+};
+
+}
+
+DATrie::DATrie()
+    : base_( 1, 0 ),
+    check_( 1, 0 ),
+    value_( 1, 0 ),
+    charIds_( 16 ),
+    charMask_( 15 ),
+    charShift_( 28 ),
+    alphabetSize_( 0 ),
+    ctype_( 0 ),
+    nextCheckPos_( 1 )
+{
+    fill( byteIds_, byteIds_ + 256, 0 );
+}
+
+void DATrie::addChar( uint32_t code, uint32_t id )
+{
+    size_t i = ( code * 2654435761U ) >> charShift_;
+    while( charIds_[ i ].code )
+        i = ( i + 1 ) & charMask_;
+    charIds_[ i ].code = code;
+    charIds_[ i ].id = id;
+}
+
+int32_t DATrie::findBase( const vector< uint32_t >& labels )
+{
+    size_t first = labels.front();
+    size_t last = labels.back();
+    size_t pos = max( first + 1, nextCheckPos_ ) - 1;
+    size_t used = 0;
+    bool foundFree = false;
+    size_t begin;
+    while( true )
+    {
+        ++pos;
+        if( pos + last >= check_.size() )
+        {
+            size_t size = max( pos + last + 1, check_.size() + check_.size() / 2 );
+            base_.resize( size, 0 );
+            check_.resize( size, -1 );
+            value_.resize( size, 0 );
+        }
+        if( check_[ pos ] >= 0 )
+        {
+            ++used;
+            continue;
+        }
+        if( !foundFree )
+        {
+            nextCheckPos_ = pos;
+            foundFree = true;
+        }
+
+        begin = pos - first;
+        size_t i = 1;
+        while( i < labels.size() && check_[ begin + labels[ i ] ] < 0 )
+            ++i;
+        if( i == labels.size() )
+            break;
+    }
+
+    // skip the slots nearly all used in the later searches
+    if( used * 20 >= ( pos - nextCheckPos_ + 1 ) * 19 )
+        nextCheckPos_ = pos;
+    return (int32_t)begin;
+}
+
+void DATrie::build( const VTrie& trie, const CMA_CType* ctype )
+{
+    ctype_ = ctype;
+    WordCollector words;
+    words.ctype = ctype;
+    trie.traverse( words );
+
+    // the most frequent characters get the smallest IDs
+    unordered_map< uint32_t, size_t > counts;
+    for( size_t i = 0; i < words.chars.size(); ++i )
+        ++counts[ words.chars[ i ] ];
+    vector< pair< size_t, uint32_t > > alphabet;
+    alphabet.reserve( counts.size() );
+    for( unordered_map< uint32_t, size_t >::const_iterator itr = counts.begin();
+            itr != counts.end(); ++itr )
+        alphabet.push_back( make_pair( itr->second, itr->first ) );
+    sort( alphabet.begin(), alphabet.end(),
+            []( const pair< size_t, uint32_t >& a, const pair< size_t, uint32_t >& b ) {
+                return a.first != b.first ? a.first > b.first : a.second < b.second;
+            } );
+    alphabetSize_ = alphabet.size();
+
+    size_t capacity = 16;
+    charShift_ = 28;
+    while( capacity < alphabetSize_ * 2 )
+    {
+        capacity <<= 1;
+        --charShift_;
+    }
+    charIds_.assign( capacity, CharSlot() );
+    charMask_ = capacity - 1;
+    fill( byteIds_, byteIds_ + 256, 0 );
+    unordered_map< uint32_t, uint32_t > ids;
+    for( size_t i = 0; i < alphabet.size(); ++i )
+    {
+        uint32_t code = alphabet[ i ].second;
+        uint32_t id = (uint32_t)i + 1;
+        if( code < 256 )
+            byteIds_[ code ] = id;
+        else
+            addChar( code, id );
+        ids[ code ] = id;
+    }
+    for( size_t i = 0; i < words.chars.size(); ++i )
+        words.chars[ i ] = ids[ words.chars[ i ] ];
+
+    vector< size_t > order( words.values.size() );
+    for( size_t i = 0; i < order.size(); ++i )
+        order[ i ] = i;
+    WordLess less = { words };
+    sort( order.begin(), order.end(), less );
+
+    base_.assign( 1, 0 );
+    check_.assign( 1, 0 );
+    value_.assign( 1, 0 );
+    nextCheckPos_ = 1;
+    size_t maxNode = 0;
+
+    vector< NodeRange > stack;
+    NodeRange root = { 0, order.size(), 0, 0 };
+    stack.push_back( root );
+    vector< uint32_t > labels;
+    vector< size_t > bounds;
+    while( !stack.empty() )
+    {
+        NodeRange range = stack.back();
+        stack.pop_back();
+
+        // the word ending at the node is the first of the sorted words
+        if( range.lo < range.hi && words.length( order[ range.lo ] ) == range.depth )
+        {
+            value_[ range.node ] = words.values[ order[ range.lo ] ];
+            ++range.lo;
+        }
+        if( range.lo == range.hi )
+            continue;
+
+        labels.clear();
+        bounds.clear();
+        for( size_t i = range.lo; i < range.hi; ++i )
+        {
+            uint32_t label = words.word( order[ i ] )[ range.depth ];
+            if( labels.empty() || labels.back() != label )
+            {
+                labels.push_back( label );
+                bounds.push_back( i );
+            }
+        }
+        bounds.push_back( range.hi );
+
+        int32_t base = findBase( labels );
+        base_[ range.node ] = base;
+        for( size_t i = 0; i < labels.size(); ++i )
+        {
+            int32_t child = base + (int32_t)labels[ i ];
+            check_[ child ] = range.node;
+            maxNode = max( maxNode, (size_t)child );
+            NodeRange childRange = { bounds[ i ], bounds[ i + 1 ], range.depth + 1, child };
+            stack.push_back( childRange );
+        }
+    }
+
+    // the largest child is at the end of the arrays
+    base_.resize( maxNode + 1 );
+    check_.resize( maxNode + 1 );
+    value_.resize( maxNode + 1 );
+    base_.shrink_to_fit();
+    check_.shrink_to_fit();
+    value_.shrink_to_fit();
+}
+
+bool DATrie::update( const char* key, int value )
+{
+    VTrieNode node;
+    size_t len = strlen( key );
+    if( walk( key, len, &node ) < len || !node.data )
+        return false;
+    value_[ node.offset ] = value;
+    return true;
+}
+
+int DATrie::search( const char* key, VTrieNode* node ) const
+{
+    node->init();
+    size_t len = strlen( key );
+    if( !len )
+    {
+        node->data = value_[ 0 ];
+        node->moreLong = base_[ 0 ] != 0;
+    }
+    else if( walk( key, len, node ) < len )
+    {
+        node->data = 0;
+        node->moreLong = false;
+    }
+    return node->data != 0;
+}
+
+size_t DATrie::walk( const char* text, size_t len, VTrieNode* node ) const
+{
+    const unsigned char* p = (const unsigned char*)text;
+    size_t i = 0;
+    while( i < len && node->moreLong )
+    {
+        unsigned int bytes = ctype_ ? ctype_->getByteCount( text + i, len - i ) : 1;
+        uint32_t id = 0;
+        if( bytes == 1 )
+            id = byteIds_[ p[ i ] ];
+        else if( bytes >= 2 && bytes <= 4 )
+            id = charId( packChar( p + i, bytes ) );
+
+        int32_t parent = (int32_t)node->offset;
+        size_t child = (size_t)base_[ parent ] + id;
+        if( !id || child >= check_.size() || check_[ child ] != parent )
+        {
+            node->data = 0;
+            node->moreLong = false;
+            break;
+        }
+        node->offset = (vtptr_t)child;
+        node->data = value_[ child ];
+        node->moreLong = base_[ child ] != 0;
+        i += bytes;
+    }
+    return i;
+}
+
+size_t DATrie::memorySize() const
+{
+    return sizeof( DATrie ) + ( base_.capacity() + check_.capacity() + value_.capacity() ) *
+            sizeof( int32_t ) + charIds_.capacity() * sizeof( CharSlot );
+}
+
+}
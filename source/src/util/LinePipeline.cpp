@@ -0,0 +1,217 @@
+/*
+ * \file LinePipeline.cpp
+ * \brief Process the lines of a stream with several threads in order
+ * \date Oct 17, 2026
+ */
+
+#include "icma/util/LinePipeline.h"
+#include "icma/util/LineReader.h"
+#include "icma/util/WorkStealingPool.h"
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace cma
+{
+
+namespace lpinner
+{
+
+/**
+ * The state shared by the three stages
+ */
+struct PipelineState
+{
+    std::mutex lock;
+
+    /** the reader waits for a free batch */
+    std::condition_variable freeCond;
+
+    /** the workers wait for a batch to process */
+    std::condition_variable workCond;
+
+    /** the writer waits for the next batch in order */
+    std::condition_variable doneCond;
+
+    /** the batches can be reused */
+    std::vector< LineBatch* > freeList;
+
+    /** the batches to process */
+    std::deque< LineBatch* > workQueue;
+
+    /** the processed batches, sorted by the sequence number */
+    std::map< size_t, LineBatch* > doneMap;
+
+    /** number of the batches created */
+    size_t created;
+
+    /** number of the batches read, valid when readEnd is true */
+    size_t totalBatches;
+
+    /** whether the reader reaches the end of the stream */
+    bool readEnd;
+
+    PipelineState() : created( 0 ), totalBatches( 0 ), readEnd( false ) {}
+};
+
+void work(
+        PipelineState* state,
+        const LinePipeline::ProcessFunc* func
+        )
+{
+    while( true )
+    {
+        LineBatch* batch;
+        {
+            std::unique_lock< std::mutex > guard( state->lock );
+            while( state->workQueue.empty() && state->readEnd == false )
+                state->workCond.wait( guard );
+            if( state->workQueue.empty() )
+                return;
+            batch = state->workQueue.front();
+            state->workQueue.pop_front();
+        }
+
+        (*func)( *batch );
+
+        std::lock_guard< std::mutex > guard( state->lock );
+        state->doneMap[ batch->seq ] = batch;
+        state->doneCond.notify_one();
+    }
+}
+
+void write(
+        PipelineState* state,
+        std::ostream* out
+        )
+{
+    size_t next = 0;
+    while( true )
+    {
+        LineBatch* batch;
+        {
+            std::unique_lock< std::mutex > guard( state->lock );
+            while( ( state->readEnd == false || next < state->totalBatches )
+                    && state->doneMap.find( next ) == state->doneMap.end() )
+                state->doneCond.wait( guard );
+            if( state->readEnd == true && next >= state->totalBatches )
+                return;
+            std::map< size_t, LineBatch* >::iterator itr = state->doneMap.find( next );
+            batch = itr->second;
+            state->doneMap.erase( itr );
+        }
+
+        out->write( batch->output.data(), batch->output.size() );
+        ++next;
+
+        std::lock_guard< std::mutex > guard( state->lock );
+        state->freeList.push_back( batch );
+        state->freeCond.notify_one();
+    }
+}
+
+}
+
+LinePipeline::LinePipeline(
+        unsigned int workerNum,
+        size_t batchLines,
+        size_t maxBatches
+        )
+    : workerNum_( workerNum > 0 ? workerNum : WorkStealingPool::hardwareThreadNum() ),
+    batchLines_( batchLines > 0 ? batchLines : 1 ),
+    maxBatches_( maxBatches > 0 ? maxBatches : 2 * workerNum_ + 2 )
+{
+}
+
+void LinePipeline::run(
+        LineReader& in,
+        std::ostream& out,
+        const ProcessFunc& func
+        )
+{
+    lpinner::PipelineState state;
+
+    std::thread writer( lpinner::write, &state, &out );
+    std::vector< std::thread > workers;
+    workers.reserve( workerNum_ );
+    for( unsigned int i = 0; i < workerNum_; ++i )
+        workers.push_back( std::thread( lpinner::work, &state, &func ) );
+
+    size_t seq = 0;
+    bool mapped = in.isMapped();
+    const char* line;
+    size_t len;
+    bool remains = true;
+    while( remains && in.next( line, len, remains ) )
+    {
+        LineBatch* batch;
+        {
+            std::unique_lock< std::mutex > guard( state.lock );
+            while( state.freeList.empty() && state.created >= maxBatches_ )
+                state.freeCond.wait( guard );
+            if( state.freeList.empty() )
+            {
+                // the vectors are never resized, so the buffers are not moved
+                batch = new LineBatch;
+                batch->lines.resize( batchLines_ );
+                batch->lengths.resize( batchLines_ );
+                batch->remains.resize( batchLines_ );
+                if( mapped == false )
+                    batch->buffers.resize( batchLines_ );
+                ++state.created;
+            }
+            else
+            {
+                batch = state.freeList.back();
+                state.freeList.pop_back();
+            }
+        }
+
+        batch->seq = seq++;
+        batch->size = 0;
+        batch->output.clear();
+        while( true )
+        {
+            size_t i = batch->size++;
+            if( mapped )
+            {
+                batch->lines[ i ] = line;
+            }
+            else
+            {
+                batch->buffers[ i ].assign( line, len );
+                batch->lines[ i ] = batch->buffers[ i ].c_str();
+            }
+            batch->lengths[ i ] = len;
+            batch->remains[ i ] = remains;
+
+            if( remains == false || batch->size >= batchLines_
+                    || in.next( line, len, remains ) == false )
+                break;
+        }
+
+        std::lock_guard< std::mutex > guard( state.lock );
+        state.workQueue.push_back( batch );
+        state.workCond.notify_one();
+    }
+
+    {
+        std::lock_guard< std::mutex > guard( state.lock );
+        state.readEnd = true;
+        state.totalBatches = seq;
+        state.workCond.notify_all();
+        state.doneCond.notify_all();
+    }
+
+    for( size_t i = 0; i < workers.size(); ++i )
+        workers[ i ].join();
+    writer.join();
+
+    for( size_t i = 0; i < state.freeList.size(); ++i )
+        delete state.freeList[ i ];
+}
+
+}
@@ -0,0 +1,105 @@
+/*
+ * \file LineReader.cpp
+ * \brief Read the lines of a file without copying them
+ * \date Oct 17, 2026
+ */
+
+#include "icma/util/LineReader.h"
+
+#include <mmapfile.hpp>
+
+#include <cstring>
+#include <sys/stat.h>
+
+namespace cma
+{
+
+LineReader::LineReader()
+    : mmap_( 0 ), cur_( 0 ), end_( 0 ), hasMore_( false )
+{
+}
+
+LineReader::~LineReader()
+{
+    close();
+}
+
+bool LineReader::open( const char* fileName )
+{
+    close();
+
+#if defined(HAVE_SYSTEM_MMAP)
+    // only the regular file could be mapped, an empty file can't be mapped
+    // either, but it has no content to copy
+    struct stat st;
+    if( stat( fileName, &st ) == 0 && S_ISREG( st.st_mode ) && st.st_size > 0 )
+    {
+        MmapFile* file = new MmapFile( fileName );
+        if( file->open() )
+        {
+            mmap_ = file;
+            cur_ = (const char*)file->addr();
+            end_ = cur_ + file->size();
+            hasMore_ = true;
+            return true;
+        }
+        delete file;
+    }
+#endif
+
+    // fall back to the buffered stream
+    in_.clear();
+    in_.open( fileName );
+    if( !in_ )
+        return false;
+    hasMore_ = !in_.eof();
+    return true;
+}
+
+void LineReader::close()
+{
+    if( mmap_ )
+    {
+        delete mmap_;
+        mmap_ = 0;
+        cur_ = end_ = 0;
+    }
+    if( in_.is_open() )
+        in_.close();
+    hasMore_ = false;
+}
+
+bool LineReader::next( const char*& line, size_t& len, bool& remains )
+{
+    if( hasMore_ == false )
+        return false;
+
+    if( mmap_ )
+    {
+        const char* lineEnd = (const char*)memchr( cur_, '\n', end_ - cur_ );
+        if( lineEnd )
+        {
+            line = cur_;
+            len = lineEnd - cur_;
+            remains = true;
+            cur_ = lineEnd + 1;
+            return true;
+        }
+
+        // the last line has no line break after it, copy it to have a '\0'
+        buf_.assign( cur_, end_ - cur_ );
+        cur_ = end_;
+    }
+    else
+    {
+        getline( in_, buf_ );
+    }
+
+    line = buf_.c_str();
+    len = buf_.size();
+    remains = mmap_ ? false : !in_.eof();
+    hasMore_ = remains;
+    return true;
+}
+
+}
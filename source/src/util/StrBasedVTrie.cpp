@@ -22,7 +22,7 @@ bool createVTrie( const vector<string>& words, VTrie& trie )
 }
 
 
-StrBasedVTrie::StrBasedVTrie( VTrie* pTrie )
+StrBasedVTrie::StrBasedVTrie( const DictTrie* pTrie )
     : trie(pTrie),
     completeSearch(false)
 {
@@ -41,15 +41,10 @@ bool StrBasedVTrie::search( const char *p )
     if(!completeSearch)
         return false;
 
-    while(node.moreLong && *p)
-    {
-        trie->find(*p, &node);
-        //cout<<"finding,"<<node<<endl;
-        ++p;
-    }
+    size_t len = strlen(p);
 
     //the node.data can be negative (as no pos tags)
-    completeSearch = !(*p) && (node.data > 0 || node.moreLong);
+    completeSearch = trie->walk(p, len, &node) == len && (node.data > 0 || node.moreLong);
 
     return completeSearch;
 }
@@ -67,4 +62,57 @@ bool StrBasedVTrie::exists()
     return completeSearch && node.data > 0;
 }
 
+
+VTrieDAG::VTrieDAG()
+    : begin_(0),
+    end_(0)
+{
+}
+
+void VTrieDAG::clear()
+{
+    begin_ = end_ = 0;
+    offsets_.clear();
+    matches_.clear();
+    reaches_.clear();
+}
+
+void VTrieDAG::build( const DictTrie* trie, const StringVectorType& chars, size_t begin, size_t end )
+{
+    clear();
+    begin_ = begin;
+    end_ = end > begin ? end : begin;
+    offsets_.reserve( end_ - begin_ + 1 );
+    reaches_.reserve( end_ - begin_ );
+    matches_.reserve( ( end_ - begin_ ) * 2 );
+
+    Match match;
+    for( size_t start = begin_; start < end_; ++start )
+    {
+        offsets_.push_back( matches_.size() );
+        size_t reach = start;
+        VTrieNode node;
+        for( size_t i = start; i < end_ && node.moreLong; ++i )
+        {
+            const char* p = chars[ i ];
+            size_t len = strlen( p );
+            // a word only ends at the end of a character, which is checked
+            // by the node after the walk
+            if( trie->walk( p, len, &node ) < len )
+                break;
+            if( node.data != 0 )
+            {
+                match.end = i + 1;
+                match.value = node.data;
+                match.moreLong = node.moreLong;
+                matches_.push_back( match );
+            }
+            if( node.data > 0 || node.moreLong )
+                reach = i + 1;
+        }
+        reaches_.push_back( reach );
+    }
+    offsets_.push_back( matches_.size() );
+}
+
 }
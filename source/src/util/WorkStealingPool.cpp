@@ -0,0 +1,282 @@
+/*
+ * \file WorkStealingPool.cpp
+ * \brief Run a batch of weighted tasks with several threads
+ * \date Oct 17, 2026
+ */
+
+#include "icma/util/WorkStealingPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <exception>
+
+namespace cma
+{
+
+namespace wspinner
+{
+
+/**
+ * The task queue of one worker
+ */
+struct TaskQueue
+{
+    std::mutex lock;
+
+    std::deque< size_t > tasks;
+
+    /** the total weight of the remaining tasks */
+    size_t weight;
+
+    TaskQueue() : weight( 0 ) {}
+};
+
+/**
+ * Compare the task index by the weight, heaviest first
+ */
+struct HeavierTask
+{
+    const std::vector< size_t >& weights;
+
+    HeavierTask( const std::vector< size_t >& w ) : weights( w ) {}
+
+    bool operator()( size_t a, size_t b ) const
+    {
+        return weights[ a ] > weights[ b ];
+    }
+};
+
+inline bool popFront(
+        TaskQueue& queue,
+        const std::vector< size_t >& weights,
+        size_t& task
+        )
+{
+    std::lock_guard< std::mutex > guard( queue.lock );
+    if( queue.tasks.empty() )
+        return false;
+    task = queue.tasks.front();
+    queue.tasks.pop_front();
+    queue.weight -= weights[ task ];
+    return true;
+}
+
+inline bool popBack(
+        TaskQueue& queue,
+        const std::vector< size_t >& weights,
+        size_t& task
+        )
+{
+    std::lock_guard< std::mutex > guard( queue.lock );
+    if( queue.tasks.empty() )
+        return false;
+    task = queue.tasks.back();
+    queue.tasks.pop_back();
+    queue.weight -= weights[ task ];
+    return true;
+}
+
+/**
+ * Steal a task from the queue with the most remaining weight
+ */
+inline bool steal(
+        std::vector< TaskQueue >& queues,
+        const std::vector< size_t >& weights,
+        size_t self,
+        size_t& task
+        )
+{
+    size_t n = queues.size();
+    while( true )
+    {
+        size_t victim = n;
+        size_t maxWeight = 0;
+        bool hasTask = false;
+        for( size_t i = 0; i < n; ++i )
+        {
+            if( i == self )
+                continue;
+            std::lock_guard< std::mutex > guard( queues[ i ].lock );
+            if( queues[ i ].tasks.empty() )
+                continue;
+            if( hasTask == false || queues[ i ].weight > maxWeight )
+            {
+                victim = i;
+                maxWeight = queues[ i ].weight;
+                hasTask = true;
+            }
+        }
+
+        if( hasTask == false )
+            return false;
+        // the victim may be drained in the meanwhile, try again
+        if( popBack( queues[ victim ], weights, task ) )
+            return true;
+    }
+}
+
+}
+
+/**
+ * A call of run(), shared by the workers
+ */
+struct WorkStealingPool::Batch
+{
+    std::vector< wspinner::TaskQueue > queues;
+
+    const std::vector< size_t >* weights;
+
+    const TaskFunc* func;
+
+    /** set when a task throws, so the remaining tasks are skipped */
+    std::atomic< bool > failed;
+
+    /** the first exception thrown by the tasks */
+    std::exception_ptr error;
+
+    std::mutex errorLock;
+
+    Batch( size_t queueNum, const std::vector< size_t >& w, const TaskFunc& f )
+        : queues( queueNum ), weights( &w ), func( &f ), failed( false ) {}
+
+    void work( unsigned int self )
+    {
+        size_t task;
+        while( !failed.load( std::memory_order_relaxed )
+                && ( wspinner::popFront( queues[ self ], *weights, task )
+                || wspinner::steal( queues, *weights, self, task ) ) )
+        {
+            try
+            {
+                (*func)( task, self );
+            }
+            catch( ... )
+            {
+                std::lock_guard< std::mutex > guard( errorLock );
+                if( !error )
+                    error = std::current_exception();
+                failed = true;
+            }
+        }
+    }
+};
+
+WorkStealingPool::WorkStealingPool( unsigned int threadNum )
+    : threadNum_( threadNum > 0 ? threadNum : hardwareThreadNum() ),
+    batch_( 0 ),
+    generation_( 0 ),
+    busy_( 0 ),
+    stop_( false )
+{
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard< std::mutex > guard( lock_ );
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for( size_t i = 0; i < workers_.size(); ++i )
+        workers_[ i ].join();
+}
+
+void WorkStealingPool::workerLoop( unsigned int self )
+{
+    unsigned long generation = 0;
+    while( true )
+    {
+        Batch* batch;
+        {
+            std::unique_lock< std::mutex > guard( lock_ );
+            wake_.wait( guard, [ & ] { return stop_ || generation_ != generation; } );
+            if( stop_ )
+                return;
+            generation = generation_;
+            batch = batch_;
+        }
+
+        batch->work( self );
+
+        std::lock_guard< std::mutex > guard( lock_ );
+        if( --busy_ == 0 )
+            done_.notify_one();
+    }
+}
+
+void WorkStealingPool::run(
+        const std::vector< size_t >& weights,
+        const TaskFunc& func
+        )
+{
+    size_t taskNum = weights.size();
+    if( taskNum == 0 )
+        return;
+
+    if( threadNum_ <= 1 || taskNum == 1 )
+    {
+        for( size_t i = 0; i < taskNum; ++i )
+            func( i, 0 );
+        return;
+    }
+
+    std::lock_guard< std::mutex > runGuard( runLock_ );
+    unsigned int workerNum = threadNum_;
+    if( workerNum > taskNum )
+        workerNum = (unsigned int)taskNum;
+
+    // deal the heaviest task to the lightest worker, the other workers
+    // start by stealing
+    std::vector< size_t > order( taskNum );
+    for( size_t i = 0; i < taskNum; ++i )
+        order[ i ] = i;
+    std::stable_sort( order.begin(), order.end(), wspinner::HeavierTask( weights ) );
+
+    Batch batch( threadNum_, weights, func );
+    for( size_t i = 0; i < taskNum; ++i )
+    {
+        size_t lightest = 0;
+        for( size_t w = 1; w < workerNum; ++w )
+        {
+            if( batch.queues[ w ].weight < batch.queues[ lightest ].weight )
+                lightest = w;
+        }
+        batch.queues[ lightest ].tasks.push_back( order[ i ] );
+        batch.queues[ lightest ].weight += weights[ order[ i ] ];
+    }
+
+    if( workers_.empty() )
+    {
+        workers_.reserve( threadNum_ - 1 );
+        for( unsigned int w = 1; w < threadNum_; ++w )
+            workers_.push_back( std::thread( &WorkStealingPool::workerLoop, this, w ) );
+    }
+
+    {
+        std::lock_guard< std::mutex > guard( lock_ );
+        batch_ = &batch;
+        busy_ = (unsigned int)workers_.size();
+        ++generation_;
+    }
+    wake_.notify_all();
+
+    batch.work( 0 );
+
+    {
+        std::unique_lock< std::mutex > guard( lock_ );
+        done_.wait( guard, [ this ] { return busy_ == 0; } );
+        batch_ = 0;
+    }
+
+    if( batch.error )
+        std::rethrow_exception( batch.error );
+}
+
+unsigned int WorkStealingPool::hardwareThreadNum()
+{
+    unsigned int num = std::thread::hardware_concurrency();
+    return num > 0 ? num : 1;
+}
+
+}
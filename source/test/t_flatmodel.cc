@@ -0,0 +1,310 @@
+// test the compiled MaxentModel: PredHash, FlatParams, the flat model file
+// and the quantized weights
+#include "minunit.h"
+#include <maxentmodel.hpp>
+#include <predhash.hpp>
+#include <math.h>
+#include <stdio.h>
+#include <stdexcept>
+
+int tests_run = 0;
+
+using namespace std;
+using namespace maxent;
+using namespace me;
+
+/** the data directory beside this file, or the one given on the command line */
+string DATA_DIR;
+
+/** the flat model file written by the tests, in the data directory */
+string FLAT_FILE;
+
+/**
+ * The contexts of the training events, the predicates of the event i are
+ * shared by the events of the same i % 13, i % 17 or i % 5, and some of them
+ * are longer than the names kept in the slots of PredHash.
+ */
+vector<string> make_context(size_t i) {
+    vector<string> c;
+    char name[64];
+    sprintf(name, "a%u", (unsigned int)(i % 13));
+    c.push_back(name);
+    sprintf(name, "a_long_predicate_name_%u", (unsigned int)(i % 17));
+    c.push_back(name);
+    sprintf(name, "b%u", (unsigned int)(i % 5));
+    c.push_back(name);
+    return c;
+}
+
+/**
+ * Train a model of n_outcome outcomes, the rows are dense if n_outcome is
+ * small, otherwise CSR.
+ */
+void train_model(MaxentModel& m, size_t n_outcome) {
+    m.begin_add_event();
+    for (size_t i = 0; i < 200; ++i) {
+        char outcome[16];
+        sprintf(outcome, "O%u", (unsigned int)((i * 7 + i / 13) % n_outcome));
+        m.add_event(make_context(i), outcome, 1 + i % 3);
+    }
+    m.end_add_event();
+    m.train(30, "gis");
+}
+
+/** the contexts to evaluate, with some unknown predicates */
+vector<vector<string> > test_contexts() {
+    vector<vector<string> > contexts;
+    for (size_t i = 0; i < 40; ++i) {
+        vector<string> c = make_context(i * 3);
+        if (i % 4 == 1)
+            c.push_back("unknown");
+        if (i % 4 == 2)
+            c.erase(c.begin());
+        contexts.push_back(c);
+    }
+    contexts.push_back(vector<string>());
+    contexts.push_back(vector<string>(1, "unknown"));
+    return contexts;
+}
+
+/** the probabilities of eval_all(), indexed by the outcome id */
+vector<double> eval_probs(const MaxentModel& m, const vector<string>& context) {
+    vector<pair<MaxentModel::outcome_type, double> > outcomes;
+    m.eval_all(context, outcomes, false);
+    vector<double> probs(outcomes.size());
+    for (size_t i = 0; i < outcomes.size(); ++i)
+        probs[m.outcome_id(outcomes[i].first)] = outcomes[i].second;
+    return probs;
+}
+
+/** whether the two models give the same probabilities within tol */
+bool same_probs(const MaxentModel& m1, const MaxentModel& m2, double tol) {
+    vector<vector<string> > contexts = test_contexts();
+    for (size_t i = 0; i < contexts.size(); ++i) {
+        vector<double> p1 = eval_probs(m1, contexts[i]);
+        vector<double> p2 = eval_probs(m2, contexts[i]);
+        if (p1.size() != p2.size())
+            return false;
+        for (size_t j = 0; j < p1.size(); ++j) {
+            if (fabs(p1[j] - p2[j]) > tol)
+                return false;
+        }
+    }
+    return true;
+}
+
+char* test_pred_hash() {
+    PredMapType preds;
+    char name[64];
+    for (size_t i = 0; i < 5000; ++i) {
+        sprintf(name, i % 2 ? "p%u" : "a_long_predicate_name_%u", (unsigned int)i);
+        preds.add(name);
+    }
+    PredHash hash(preds);
+    mu_assert(hash.size() == preds.size());
+
+    // each predicate gets its own id back
+    for (size_t i = 0; i < preds.size(); ++i)
+        mu_assert(hash.id(preds[i]) == i);
+
+    // the unknown names are rejected, the prefixes and the extended names
+    // get the same ids as in the ItemMap
+    for (size_t i = 0; i < 5000; ++i) {
+        sprintf(name, "q%u", (unsigned int)i);
+        mu_assert(hash.id(name) == PredMapType::null_id);
+        string pred = preds[i];
+        mu_assert(hash.id(pred + "x") == PredMapType::null_id);
+        string prefix = pred.substr(0, pred.size() - 1);
+        mu_assert(hash.id(prefix) == preds.id(prefix));
+    }
+    mu_assert(hash.id("") == PredMapType::null_id);
+
+    PredMapType one;
+    one.add("in");
+    PredHash one_hash(one);
+    mu_assert(one_hash.id("in") == 0u);
+    mu_assert(one_hash.id("out") == PredMapType::null_id);
+    return 0;
+}
+
+char* test_flat_file() {
+    // the text model of the data directory
+    MaxentModel txt;
+    txt.load(DATA_DIR + "me_model.txt");
+    txt.save_flat(FLAT_FILE);
+    MaxentModel flat;
+    flat.load(FLAT_FILE);
+    const char* contexts[][2] = { { "in", 0 }, { "in", "out" }, { "out", 0 }, { "none", 0 } };
+    for (size_t i = 0; i < sizeof(contexts) / sizeof(contexts[0]); ++i) {
+        vector<string> c;
+        for (size_t j = 0; j < 2 && contexts[i][j]; ++j)
+            c.push_back(contexts[i][j]);
+        vector<double> p1 = eval_probs(txt, c);
+        vector<double> p2 = eval_probs(flat, c);
+        mu_assert(p1 == p2);
+    }
+
+    // the dense, CSR and binary rows
+    size_t n_outcomes[] = { 2, 4, 12 };
+    for (size_t k = 0; k < sizeof(n_outcomes) / sizeof(n_outcomes[0]); ++k) {
+        MaxentModel m;
+        train_model(m, n_outcomes[k]);
+        m.save_flat(FLAT_FILE);
+        MaxentModel m2;
+        m2.load(FLAT_FILE);
+        mu_assert(m2.pred_size() == m.pred_size());
+        mu_assert(m2.outcome_size() == m.outcome_size());
+        for (size_t i = 0; i < m.pred_size(); ++i) {
+            mu_assert(m2.pred_name(i) == m.pred_name(i));
+            mu_assert(m2.pred_id(m.pred_name(i)) == i);
+        }
+        for (size_t i = 0; i < m.outcome_size(); ++i)
+            mu_assert(m2.outcome_name(i) == m.outcome_name(i));
+        mu_assert(m2.max_abs_weight() == m.max_abs_weight());
+        mu_assert(same_probs(m, m2, 0.0));
+
+        // the mapped model is saved again
+        m2.save_flat(FLAT_FILE);
+        MaxentModel m3;
+        m3.load(FLAT_FILE);
+        mu_assert(same_probs(m, m3, 0.0));
+    }
+    remove(FLAT_FILE.c_str());
+    return 0;
+}
+
+/**
+ * Check that eval_ids(), eval_batch() and logit_diff() give the results of
+ * eval_all(), the differences of the quantized model are added up from their
+ * own quantized weights, so they are checked within tol.
+ */
+char* check_eval_ids(const MaxentModel& m, double tol = 1e-12) {
+    vector<vector<string> > contexts = test_contexts();
+    size_t n_outcome = m.outcome_size();
+    vector<MaxentModel::pred_id_type> pids;
+    vector<size_t> offsets(1, 0);
+    vector<double> expected;
+    for (size_t i = 0; i < contexts.size(); ++i) {
+        for (size_t j = 0; j < contexts[i].size(); ++j)
+            pids.push_back(m.pred_id(contexts[i][j]));
+        offsets.push_back(pids.size());
+
+        vector<double> probs = eval_probs(m, contexts[i]);
+        vector<double> ids(n_outcome);
+        const MaxentModel::pred_id_type* p = pids.empty() ? 0 : &pids[offsets[i]];
+        m.eval_ids(p, offsets[i + 1] - offsets[i], &ids[0]);
+        mu_assert(ids == probs);
+        expected.insert(expected.end(), probs.begin(), probs.end());
+
+        if (m.is_binary()) {
+            double diff = m.logit_diff(p, offsets[i + 1] - offsets[i]);
+            mu_assert(fabs(MaxentModel::sigmoid(diff) - probs[1]) < tol);
+            mu_assert(fabs(m.eval_binary(p, offsets[i + 1] - offsets[i]) - probs[1]) < tol);
+            mu_assert(fabs(m.eval_binary(p, offsets[i + 1] - offsets[i], true) - probs[1]) < tol + 3e-6);
+        }
+    }
+
+    vector<double> batch(contexts.size() * n_outcome);
+    m.eval_batch(&pids[0], &offsets[0], contexts.size(), &batch[0]);
+    mu_assert(batch == expected);
+
+    if (m.is_binary()) {
+        vector<double> diffs(contexts.size());
+        m.logit_batch(&pids[0], &offsets[0], contexts.size(), &diffs[0]);
+        for (size_t i = 0; i < contexts.size(); ++i)
+            mu_assert(diffs[i] == m.logit_diff(&pids[offsets[i]], offsets[i + 1] - offsets[i]));
+    }
+    return 0;
+}
+
+char* test_eval_ids() {
+    size_t n_outcomes[] = { 2, 4, 12 };
+    for (size_t k = 0; k < sizeof(n_outcomes) / sizeof(n_outcomes[0]); ++k) {
+        MaxentModel m;
+        train_model(m, n_outcomes[k]);
+        mu_assert(m.is_binary() == (n_outcomes[k] == 2));
+        char* ret = check_eval_ids(m);
+        if (ret)
+            return ret;
+
+        m.save_flat(FLAT_FILE);
+        MaxentModel flat;
+        flat.load(FLAT_FILE);
+        ret = check_eval_ids(flat);
+        if (ret)
+            return ret;
+    }
+    remove(FLAT_FILE.c_str());
+    return 0;
+}
+
+char* test_quantize() {
+    WeightType types[] = { WEIGHT_FLOAT16, WEIGHT_INT8 };
+    double tols[] = { 1e-3, 2e-2 };
+    size_t n_outcomes[] = { 2, 4, 12 };
+    for (size_t k = 0; k < sizeof(n_outcomes) / sizeof(n_outcomes[0]); ++k) {
+        MaxentModel m;
+        train_model(m, n_outcomes[k]);
+        m.save_flat(FLAT_FILE);
+        for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); ++t) {
+            // quantize the models just loaded, like the taggers do
+            for (int mapped = 0; mapped <= 1; ++mapped) {
+                MaxentModel q;
+                if (mapped)
+                    q.load(FLAT_FILE);
+                else
+                    train_model(q, n_outcomes[k]);
+                size_t bytes = q.weight_bytes();
+                q.quantize(types[t]);
+                mu_assert(q.weight_type() == types[t]);
+                mu_assert(q.weight_bytes() < bytes);
+                mu_assert(same_probs(m, q, tols[t]));
+                char* ret = check_eval_ids(q, tols[t]);
+                if (ret)
+                    return ret;
+
+                bool thrown = false;
+                try {
+                    q.save_flat(FLAT_FILE + "2");
+                } catch (runtime_error&) {
+                    thrown = true;
+                }
+                mu_assert(thrown);
+            }
+        }
+    }
+    remove(FLAT_FILE.c_str());
+    return 0;
+}
+
+static char * all_tests() {
+    mu_run_test(test_pred_hash);
+    mu_run_test(test_flat_file);
+    mu_run_test(test_eval_ids);
+    mu_run_test(test_quantize);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) {
+        DATA_DIR = argv[1];
+        if (!DATA_DIR.empty() && DATA_DIR[DATA_DIR.size() - 1] != '/')
+            DATA_DIR += '/';
+    } else {
+        DATA_DIR = __FILE__;
+        DATA_DIR = DATA_DIR.substr(0, DATA_DIR.find_last_of('/') + 1) + "data/";
+    }
+    FLAT_FILE = DATA_DIR + "model_flat_temp";
+
+    maxent::verbose = 0;
+    char *result = all_tests();
+    if (result != 0) {
+        printf("%s\n", result);
+    }
+    else {
+        printf("ALL TESTS PASSED\n");
+    }
+    printf("Tests run: %d\n", tests_run);
+
+    return result != 0;
+}
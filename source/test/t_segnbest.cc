@@ -0,0 +1,132 @@
+// test the N-best segmentation decoded over the POC lattice
+#include "minunit.h"
+#include "icma/icma.h"
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+int tests_run = 0;
+
+using namespace std;
+using namespace cma;
+
+// the model of the CTB corpus, whose texts are in GB2312
+const char* modelPath = "../db/ctb/gb2312/";
+
+Knowledge* knowledge = 0;
+Analyzer* analyzer = 0;
+
+const char* inputs[] = {
+    // 我和衣服的故事，衣服的故事？
+    "\xCE\xD2\xBA\xCD\xD2\xC2\xB7\xFE\xB5\xC4\xB9\xCA\xCA\xC2\xA3\xAC"
+    "\xD2\xC2\xB7\xFE\xB5\xC4\xB9\xCA\xCA\xC2\xA3\xBF",
+    // 我和衣服的故事
+    "\xCE\xD2\xBA\xCD\xD2\xC2\xB7\xFE\xB5\xC4\xB9\xCA\xCA\xC2",
+    // abc 123 衣服
+    "abc 123 \xD2\xC2\xB7\xFE",
+    // 衣
+    "\xD2\xC2",
+    // 中华人民共和国成立了
+    "\xD6\xD0\xBB\xAA\xC8\xCB\xC3\xF1\xB9\xB2\xBA\xCD\xB9\xFA\xB3\xC9\xC1\xA2\xC1\xCB"
+};
+const size_t inputNum = sizeof( inputs ) / sizeof( inputs[ 0 ] );
+
+/** the string without the spaces, which are dropped if they are not in words */
+string dropSpaces( const string& str ) {
+    string ret;
+    for ( size_t i = 0; i < str.size(); ++i ) {
+        if ( str[ i ] != ' ' )
+            ret.push_back( str[ i ] );
+    }
+    return ret;
+}
+
+/** the candidates of a sentence as strings, the words split by "/" */
+vector< string > candidates( const Sentence& sent ) {
+    vector< string > ret;
+    for ( int i = 0; i < sent.getListSize(); ++i ) {
+        string cand;
+        for ( int j = 0; j < sent.getCount( i ); ++j )
+            cand.append( sent.getLexicon( i, j ) ).append( "/" );
+        ret.push_back( cand );
+    }
+    return ret;
+}
+
+char* test_candidates() {
+    for ( int N = 2; N <= 8; N *= 2 ) {
+        analyzer->setOption( Analyzer::OPTION_TYPE_NBEST, N );
+        for ( size_t i = 0; i < inputNum; ++i ) {
+            Sentence sent( inputs[ i ] );
+            mu_assert( analyzer->runWithSentence( sent ) == 1 );
+            mu_assert( sent.getListSize() >= 1 && sent.getListSize() <= N );
+
+            for ( int k = 0; k < sent.getListSize(); ++k ) {
+                // the best first, and each candidate covers the whole sentence
+                if ( k > 0 )
+                    mu_assert( sent.getScore( k ) <= sent.getScore( k - 1 ) );
+                string joined;
+                for ( int j = 0; j < sent.getCount( k ); ++j )
+                    joined += sent.getLexicon( k, j );
+                mu_assert( dropSpaces( joined ) == dropSpaces( inputs[ i ] ) );
+            }
+        }
+    }
+    return 0;
+}
+
+char* test_lattice_reuse() {
+    analyzer->setOption( Analyzer::OPTION_TYPE_NBEST, 5 );
+
+    // the lattice of a context is reused by the next sentences
+    AnalysisContext shared;
+    for ( int round = 0; round < 2; ++round ) {
+        for ( size_t i = 0; i < inputNum; ++i ) {
+            AnalysisContext fresh;
+            Sentence expected( inputs[ i ] );
+            mu_assert( analyzer->runWithSentence( expected, fresh ) == 1 );
+            Sentence sent( inputs[ i ] );
+            mu_assert( analyzer->runWithSentence( sent, shared ) == 1 );
+
+            mu_assert( candidates( sent ) == candidates( expected ) );
+            for ( int k = 0; k < sent.getListSize(); ++k )
+                mu_assert( sent.getScore( k ) == expected.getScore( k ) );
+        }
+    }
+    return 0;
+}
+
+static char * all_tests() {
+    mu_run_test(test_candidates);
+    mu_run_test(test_lattice_reuse);
+    return 0;
+}
+
+int main( int argc, char** argv ) {
+    if ( argc > 1 )
+        modelPath = argv[ 1 ];
+
+    CMA_Factory* factory = CMA_Factory::instance();
+    knowledge = factory->createKnowledge();
+    if ( knowledge->loadModel( modelPath, true ) == 0 ) {
+        printf( "fail to load the models in %s\n", modelPath );
+        return 1;
+    }
+    analyzer = factory->createAnalyzer();
+    analyzer->setKnowledge( knowledge );
+    analyzer->setOption( Analyzer::OPTION_ANALYSIS_TYPE, 1 );
+
+    char *result = all_tests();
+    if (result != 0) {
+        printf("%s\n", result);
+    }
+    else {
+        printf("ALL TESTS PASSED\n");
+    }
+    printf("Tests run: %d\n", tests_run);
+
+    delete analyzer;
+    delete knowledge;
+    return result != 0;
+}
@@ -447,7 +447,7 @@ public:
      * \return If following node does not exist, return value is 0,
      * other wise bigger than 0.
      */
-    int find( char ch, VTrieNode* node ){
+    int find( char ch, VTrieNode* node ) const{
         //not has more length any more
         if(!node->moreLong){
             node->data = 0;
@@ -509,6 +509,77 @@ public:
 
     }
 
+    /**
+     * Search all the keys which are the prefixes of the text, in a single
+     * walk from the beginning of the text.
+     * \param text the text, which needs not be terminated by '\\0'
+     * \param len the byte count of the text
+     * \param callback invoked as callback(length, value) for each key found,
+     * from the shortest to the longest, where length is the byte count of
+     * the key and value is its non-zero data
+     * \return the byte count of the longest prefix of the text on the paths
+     * of the trie
+     */
+    template<typename Callback>
+    size_t commonPrefixSearch( const char* text, size_t len, Callback callback ) const{
+        VTrieNode node;
+        return commonPrefixSearch(text, len, &node, callback);
+    }
+
+    /**
+     * Continue the walk of commonPrefixSearch() from a node, so a text split
+     * into pieces could be searched piece by piece.
+     * \param text the next piece of the text
+     * \param len the byte count of the piece
+     * \param node the state of the walk, which is set as the state at the end
+     * of the walk, a new VTrieNode starts at the root
+     * \param callback see commonPrefixSearch(), the lengths are counted from
+     * the beginning of this piece
+     * \return the byte count of the piece walked, the walk fails in this
+     * piece if it is less than \e len
+     */
+    template<typename Callback>
+    size_t commonPrefixSearch( const char* text, size_t len, VTrieNode* node,
+            Callback callback ) const{
+        if(!data_){
+            node->data = 0;
+            node->moreLong = false;
+            return 0;
+        }
+        size_t i = 0;
+        while(i < len && node->moreLong){
+            find(text[i], node);
+            //a node on the path has either a value or a longer key
+            if(!node->data && !node->moreLong)
+                break;
+            ++i;
+            if(node->data)
+                callback(i, node->data);
+        }
+        return i;
+    }
+
+    /**
+     * Visit all the keys with non-zero data, in no particular order.
+     * \param visitor invoked as visitor(key, value), where key is a
+     * std::string and value is the data of the key
+     */
+    template<typename Visitor>
+    void traverse( Visitor& visitor ) const{
+        if(!data_)
+            return;
+        string key;
+        int value = *reinterpret_cast<int*>(data_);
+        if(value)
+            visitor(key, value);
+        for(int i = 0; i < VTKEY_NUM; ++i){
+            vtptr_t childOffset = *reinterpret_cast<vtptr_t*>(data_ + VALUE_L
+                    + VTCHILDS_L + VTPTR_L * i);
+            if(childOffset)
+                traverse(data_ + childOffset, key, visitor);
+        }
+    }
+
     /**
      * Get the size of the structure
      */
@@ -517,6 +588,30 @@ public:
     }
 
 private:
+    /** visit the keys in the node started at dataPtr, see traverse() */
+    template<typename Visitor>
+    void traverse( const uint8_t* dataPtr, string& key, Visitor& visitor ) const{
+        size_t keyLen = key.size();
+        for(uint8_t samePathLen = *dataPtr++; samePathLen; --samePathLen){
+            key.push_back((char)*dataPtr);
+            int value = *reinterpret_cast<const int*>(dataPtr + 1);
+            if(value)
+                visitor(key, value);
+            dataPtr += VTENTRY_L;
+        }
+        //the child status byte
+        if(*dataPtr){
+            int slots = 1 + *dataPtr;
+            for(int i = 0; i < slots; ++i){
+                vtptr_t childOffset = *reinterpret_cast<const vtptr_t*>(dataPtr
+                        + VTCHILDS_L + VTPTR_L * i);
+                if(childOffset)
+                    traverse(data_ + childOffset, key, visitor);
+            }
+        }
+        key.resize(keyLen);
+    }
+
     /** initialize the VTrie and add assert statement*/
     void init(){
         assert(sizeof(int) == VALUE_L);